@@ -0,0 +1,90 @@
+#include "arena.h"
+#include <stdint.h>
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    void *memory;                       // What RL_MALLOC() returned, the block starts aligned inside it
+    size_t size;
+    size_t used;
+};
+
+// Allocations start after the header, rounded up so they stay aligned
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+
+static size_t AlignSize(size_t size) {
+    return (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+}
+
+static ArenaBlock *LoadArenaBlock(Arena *arena, size_t size) {
+    void *memory = RL_MALLOC(ARENA_HEADER_SIZE + size + ARENA_ALIGNMENT - 1);
+    if (memory == NULL) return NULL;
+
+    ArenaBlock *block = (ArenaBlock *)AlignSize((uintptr_t)memory);
+    block->next = arena->blocks;
+    block->memory = memory;
+    block->size = size;
+    block->used = 0;
+
+    arena->blocks = block;
+    arena->blockAllocations++;
+    return block;
+}
+
+static void UnloadArenaBlocks(ArenaBlock *block) {
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        RL_FREE(block->memory);
+        block = next;
+    }
+}
+
+Arena LoadArena(size_t blockSize) {
+    Arena arena = { 0 };
+    arena.blockSize = AlignSize(blockSize);     // The first block is allocated on first use
+    return arena;
+}
+
+void UnloadArena(Arena *arena) {
+    UnloadArenaBlocks(arena->blocks);
+    *arena = (Arena){ 0 };
+}
+
+void *ArenaAlloc(Arena *arena, size_t size) {
+    size = AlignSize(size);
+    ArenaBlock *block = arena->blocks;
+    if ((block == NULL) || (block->used + size > block->size)) {
+        block = LoadArenaBlock(arena, (size > arena->blockSize)? size : arena->blockSize);
+        if (block == NULL) return NULL;
+    }
+
+    void *pointer = (unsigned char *)block + ARENA_HEADER_SIZE + block->used;
+    block->used += size;
+    return pointer;
+}
+
+void ResetArena(Arena *arena) {
+    ArenaBlock *block = arena->blocks;
+    if (block == NULL) return;
+
+    // Everything fitted, start over in the same block
+    if (block->next == NULL) {
+        block->used = 0;
+        return;
+    }
+
+    // Replace the chain with one block that holds all of it
+    size_t used = 0;
+    for (ArenaBlock *b = block; b != NULL; b = b->next) used += b->used;
+    UnloadArenaBlocks(block);
+    arena->blocks = NULL;
+    if (used > arena->blockSize) arena->blockSize = used;
+    LoadArenaBlock(arena, arena->blockSize);
+}
+
+void *MemAllocArena(Arena *arena, size_t size) {
+    return (arena != NULL)? ArenaAlloc(arena, size) : RL_MALLOC(size);
+}
+
+void MemFreeArena(Arena *arena, void *pointer) {
+    if (arena == NULL) RL_FREE(pointer);
+}
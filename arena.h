@@ -0,0 +1,42 @@
+/*******************************************************************************************
+*
+*   arena - Reusable bump allocator for chunk building
+*
+*   Everything a chunk build allocates lives until the chunk is uploaded and is then dropped
+*   all at once, so it is carved out of one block instead of going through malloc piece by
+*   piece. ResetArena() makes the whole block available again without freeing it.
+*
+*   A request that does not fit starts another block. The next reset frees the extra blocks
+*   and grows the arena to everything used since the last reset, so once the arena has seen
+*   the largest chunk, later builds make no heap allocations at all.
+*
+*   An arena is not thread safe. Each worker builds into its own.
+*
+********************************************************************************************/
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "raylib.h"
+#include <stddef.h>
+
+#define ARENA_ALIGNMENT 32              // Every allocation starts on this boundary, enough for AVX loads
+
+typedef struct ArenaBlock ArenaBlock;
+
+typedef struct Arena {
+    ArenaBlock *blocks;                 // Most recent block first
+    size_t blockSize;                   // Size of the next block, grows on reset
+    int blockAllocations;               // Blocks allocated so far, 0 new ones per build once warm
+} Arena;
+
+Arena LoadArena(size_t blockSize);
+void UnloadArena(Arena *arena);
+void *ArenaAlloc(Arena *arena, size_t size);   // Uninitialized memory that lives until the next reset
+void ResetArena(Arena *arena);                 // Drop everything allocated, keep the memory
+
+// For code that builds with or without an arena
+void *MemAllocArena(Arena *arena, size_t size);    // From the arena, or RL_MALLOC() when arena is NULL
+void MemFreeArena(Arena *arena, void *pointer);    // RL_FREE() unless the memory came from an arena
+
+#endif // ARENA_H
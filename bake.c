@@ -0,0 +1,155 @@
+/*******************************************************************************************
+*
+*   bake - Build the chunk archive the game streams from
+*
+*   Runs BuildChunkData() for every chunk of the map, which already gives each ground texture
+*   its mip chain, and writes everything to a chunk archive (see chunkarchive.h). Rerun it whenever the source
+*   images or anything that changes the chunk layout changes, the game refuses archives from
+*   an older version and falls back to the source images.
+*
+*   Usage: bake <heightmap.png> <texture.png> [archive]     Writes CHUNK_ARCHIVE_FILE by default
+*
+********************************************************************************************/
+
+#include "raylib.h"
+#include "chunk.h"
+#include "chunkarchive.h"
+#include "tilecache.h"
+#include "timer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const unsigned char zeroPadding[CHUNK_ARCHIVE_ALIGNMENT] = { 0 };
+
+// Append an array at the next aligned offset, returns its offset
+static uint64_t WriteArray(FILE *file, const void *data, size_t size) {
+    long position = ftell(file);
+    long padding = (CHUNK_ARCHIVE_ALIGNMENT - position % CHUNK_ARCHIVE_ALIGNMENT) % CHUNK_ARCHIVE_ALIGNMENT;
+    fwrite(zeroPadding, 1, padding, file);
+    fwrite(data, 1, size, file);
+    return (uint64_t)(position + padding);
+}
+
+static size_t GetMipChainSize(Image image) {
+    size_t size = 0;
+    int width = image.width, height = image.height;
+    for (int level = 0; level < image.mipmaps; level++) {
+        size += GetPixelDataSize(width, height, image.format);
+        width = (width > 1)? width/2 : 1;
+        height = (height > 1)? height/2 : 1;
+    }
+    return size;
+}
+
+static ChunkArchiveEntry WriteChunk(FILE *file, ChunkData *data) {
+    ChunkArchiveEntry entry = { 0 };
+    if (data->heightfield.heights == NULL) return entry;   // No ground, outside the source map
+
+    Heightfield *heightfield = &data->heightfield;
+    entry.samplesX = heightfield->samplesX;
+    entry.samplesZ = heightfield->samplesZ;
+    entry.origin[0] = heightfield->origin.x;
+    entry.origin[1] = heightfield->origin.y;
+    entry.origin[2] = heightfield->origin.z;
+    entry.cellSizeX = heightfield->cellSizeX;
+    entry.cellSizeZ = heightfield->cellSizeZ;
+    entry.minHeight = heightfield->minHeight;
+    entry.maxHeight = heightfield->maxHeight;
+
+    // The archive stores heights with their apron, the terrain renderer needs it for normals,
+    // and without any gap between rows
+    int apron = (heightfield->apron < CHUNK_APRON)? heightfield->apron : CHUNK_APRON;
+    int rowSamples = heightfield->samplesX + 2*apron;
+    int rows = heightfield->samplesZ + 2*apron;
+    entry.apron = apron;
+    float *heights = (float *)malloc((size_t)rowSamples*rows*sizeof(float));
+    for (int z = 0; z < rows; z++) {
+        memcpy(heights + z*rowSamples, heightfield->heights + (z - apron)*heightfield->stride - apron, rowSamples*sizeof(float));
+    }
+    entry.heightsOffset = WriteArray(file, heights, (size_t)rowSamples*rows*sizeof(float));
+    free(heights);
+
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        Mesh *mesh = &data->groundMeshes[lod];
+        ChunkArchiveMesh *target = &entry.meshes[lod];
+        target->vertexCount = mesh->vertexCount;
+        target->triangleCount = mesh->triangleCount;
+        target->verticesOffset = WriteArray(file, mesh->vertices, mesh->vertexCount*3*sizeof(float));
+        target->normalsOffset = WriteArray(file, mesh->normals, mesh->vertexCount*3*sizeof(float));
+        target->texcoordsOffset = WriteArray(file, mesh->texcoords, mesh->vertexCount*2*sizeof(float));
+        target->indicesOffset = WriteArray(file, mesh->indices, mesh->triangleCount*3*sizeof(unsigned short));
+        entry.lodError[lod] = data->lodError[lod];
+    }
+
+    if (data->groundTexture.data != NULL) {
+        if (data->groundTexture.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) ImageFormat(&data->groundTexture, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);    // Rebuilds the mip chain
+        entry.textureWidth = data->groundTexture.width;
+        entry.textureHeight = data->groundTexture.height;
+        entry.textureMipmaps = data->groundTexture.mipmaps;
+        entry.textureFormat = data->groundTexture.format;
+        entry.textureSize = GetMipChainSize(data->groundTexture);
+        entry.textureOffset = WriteArray(file, data->groundTexture.data, entry.textureSize);
+    }
+
+    return entry;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        printf("Usage: bake <heightmap.png> <texture.png> [archive]\n");
+        return 1;
+    }
+    const char *archiveFile = (argc > 3)? argv[3] : CHUNK_ARCHIVE_FILE;
+
+    TileCache tileCache;
+    InitTileCache(&tileCache, argv[1], argv[2]);
+    ChunkSource source = { &tileCache, NULL };
+
+    FILE *file = fopen(archiveFile, "wb");
+    if (file == NULL) {
+        TraceLog(LOG_ERROR, "BAKE: [%s] Failed to open archive for writing", archiveFile);
+        UnloadTileCache(&tileCache);
+        return 1;
+    }
+
+    ChunkArchiveHeader header = { 0 };
+    header.magic = CHUNK_ARCHIVE_MAGIC;
+    header.version = CHUNK_ARCHIVE_VERSION;
+    header.chunkSize = CHUNK_SIZE;
+    header.lodCount = CHUNK_LOD_COUNT;
+    header.chunkMinX = -(int)(MAP_SIZE/2/CHUNK_SIZE);
+    header.chunkMinZ = -(int)(MAP_SIZE/2/CHUNK_SIZE);
+    header.chunksX = (int)(MAP_SIZE/CHUNK_SIZE);
+    header.chunksZ = (int)(MAP_SIZE/CHUNK_SIZE);
+    fwrite(&header, sizeof(header), 1, file);   // Rewritten once the entries offset is known
+
+    double bakeStart = GetMonotonicTime();
+    int chunkCount = header.chunksX*header.chunksZ;
+    ChunkArchiveEntry *entries = (ChunkArchiveEntry *)calloc(chunkCount, sizeof(ChunkArchiveEntry));
+    for (int x = 0; x < header.chunksX; x++) {
+        for (int z = 0; z < header.chunksZ; z++) {
+            ChunkData data = BuildChunkData((IVector2){ header.chunkMinX + x, header.chunkMinZ + z }, &source, true, NULL);
+            entries[x*header.chunksZ + z] = WriteChunk(file, &data);
+            UnloadChunkData(data);
+        }
+    }
+
+    header.entriesOffset = WriteArray(file, entries, chunkCount*sizeof(ChunkArchiveEntry));
+    fseek(file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, file);
+    bool failed = (ferror(file) != 0);
+    fclose(file);
+    free(entries);
+    UnloadTileCache(&tileCache);
+
+    if (failed) {
+        TraceLog(LOG_ERROR, "BAKE: [%s] Failed to write archive", archiveFile);
+        remove(archiveFile);
+        return 1;
+    }
+
+    TraceLog(LOG_INFO, "BAKE: [%s] Baked %i chunks in %.3f s", archiveFile, chunkCount, GetMonotonicTime() - bakeStart);
+    return 0;
+}
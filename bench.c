@@ -0,0 +1,230 @@
+#include "bench.h"
+#include "chunk.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *phaseNames[BENCH_PHASE_COUNT] = { "chunks", "update", "draw", "present" };
+
+//----------------------------------------------------------------------------------
+// Camera paths
+//----------------------------------------------------------------------------------
+
+CameraPath GenCameraPath(int frameCount, float timestep) {
+    CameraPath path = { 0 };
+
+    // Circle a quarter of the map, crossing chunk seams and turning through every direction
+    // so culling and streaming see a bit of everything
+    const Vector2 center = { MAP_SIZE/4.0f, MAP_SIZE/4.0f };
+    const float radius = MAP_SIZE/5.0f;
+    const float speed = 100.0f;         // Same as walking
+
+    for (int i = 0; i < frameCount; i++) {
+        float angle = i*timestep*speed/radius;
+        Vector3 position = { center.x + radius*cosf(angle), 0.0f, center.y + radius*sinf(angle) };
+        Vector3 forward = { -sinf(angle), 0.0f, cosf(angle) };
+        Camera camera = { 0 };
+        camera.position = position;
+        camera.target = (Vector3){ position.x + forward.x, position.y, position.z + forward.z };
+        AppendCameraPath(&path, camera);
+    }
+
+    return path;
+}
+
+CameraPath LoadCameraPath(const char *fileName) {
+    CameraPath path = { 0 };
+
+    FILE *file = fopen(fileName, "r");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "BENCH: [%s] Failed to open camera path", fileName);
+        return path;
+    }
+
+    Camera camera = { 0 };
+    while (fscanf(file, "%f %f %f %f %f %f", &camera.position.x, &camera.position.y, &camera.position.z,
+                  &camera.target.x, &camera.target.y, &camera.target.z) == 6) {
+        AppendCameraPath(&path, camera);
+    }
+    fclose(file);
+
+    TraceLog(LOG_INFO, "BENCH: [%s] Loaded camera path with %i frames", fileName, path.count);
+    return path;
+}
+
+bool SaveCameraPath(CameraPath path, const char *fileName) {
+    FILE *file = fopen(fileName, "w");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "BENCH: [%s] Failed to save camera path", fileName);
+        return false;
+    }
+
+    for (int i = 0; i < path.count; i++) {
+        fprintf(file, "%.4f %.4f %.4f %.4f %.4f %.4f\n", path.positions[i].x, path.positions[i].y, path.positions[i].z,
+                path.targets[i].x, path.targets[i].y, path.targets[i].z);
+    }
+    fclose(file);
+
+    TraceLog(LOG_INFO, "BENCH: [%s] Saved camera path with %i frames", fileName, path.count);
+    return true;
+}
+
+void AppendCameraPath(CameraPath *path, Camera camera) {
+    if (path->count == path->capacity) {
+        path->capacity = (path->capacity == 0)? 1024 : path->capacity*2;
+        path->positions = (Vector3 *)realloc(path->positions, path->capacity*sizeof(Vector3));
+        path->targets = (Vector3 *)realloc(path->targets, path->capacity*sizeof(Vector3));
+    }
+    path->positions[path->count] = camera.position;
+    path->targets[path->count] = camera.target;
+    path->count++;
+}
+
+void UnloadCameraPath(CameraPath *path) {
+    free(path->positions);
+    free(path->targets);
+    *path = (CameraPath){ 0 };
+}
+
+void GetCameraPathFrame(CameraPath path, int frame, Camera *camera) {
+    if (path.count == 0) return;
+    camera->position = path.positions[frame % path.count];
+    camera->target = path.targets[frame % path.count];
+}
+
+//----------------------------------------------------------------------------------
+// Recorder
+//----------------------------------------------------------------------------------
+
+void InitBenchRecorder(BenchRecorder *recorder, int frameCount) {
+    *recorder = (BenchRecorder){ 0 };
+    recorder->frameCount = frameCount;
+    recorder->frameTimes = (double *)calloc(frameCount, sizeof(double));
+    recorder->phaseTimes = (double *)calloc(frameCount*BENCH_PHASE_COUNT, sizeof(double));
+    recorder->memoryBytes = (size_t *)calloc(frameCount, sizeof(size_t));
+    recorder->phase = -1;
+}
+
+void UnloadBenchRecorder(BenchRecorder *recorder) {
+    free(recorder->frameTimes);
+    free(recorder->phaseTimes);
+    free(recorder->memoryBytes);
+    *recorder = (BenchRecorder){ 0 };
+}
+
+void BeginBenchFrame(BenchRecorder *recorder) {
+    recorder->frameStart = GetTime();
+    recorder->phaseStart = recorder->frameStart;
+    recorder->phase = -1;
+}
+
+void MarkBenchPhase(BenchRecorder *recorder, BenchPhase phase) {
+    double now = GetTime();
+    if ((recorder->phase >= 0) && (recorder->frame < recorder->frameCount)) {
+        recorder->phaseTimes[recorder->frame*BENCH_PHASE_COUNT + recorder->phase] += now - recorder->phaseStart;
+    }
+    recorder->phase = phase;
+    recorder->phaseStart = now;
+}
+
+void EndBenchFrame(BenchRecorder *recorder) {
+    if (recorder->frame >= recorder->frameCount) return;
+
+    double now = GetTime();
+    if (recorder->phase >= 0) recorder->phaseTimes[recorder->frame*BENCH_PHASE_COUNT + recorder->phase] += now - recorder->phaseStart;
+    recorder->frameTimes[recorder->frame] = now - recorder->frameStart;
+    recorder->phase = -1;
+    recorder->frame++;
+}
+
+void SetBenchMemory(BenchRecorder *recorder, size_t bytes) {
+    if (recorder->frame < recorder->frameCount) recorder->memoryBytes[recorder->frame] = bytes;
+}
+
+bool IsBenchFinished(const BenchRecorder *recorder) {
+    return recorder->frame >= recorder->frameCount;
+}
+
+typedef struct BenchSummary {
+    double mean, p50, p95, p99, max;
+} BenchSummary;
+
+static int CompareDoubles(const void *a, const void *b) {
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+// Summary of count samples taken stride apart, nearest rank percentiles
+static BenchSummary GetBenchSummary(const double *samples, int count, int stride) {
+    BenchSummary summary = { 0 };
+    if (count == 0) return summary;
+
+    double *sorted = (double *)malloc(count*sizeof(double));
+    double total = 0.0;
+    for (int i = 0; i < count; i++) {
+        sorted[i] = samples[i*stride];
+        total += sorted[i];
+    }
+    qsort(sorted, count, sizeof(double), CompareDoubles);
+
+    summary.mean = total/count;
+    summary.p50 = sorted[(int)ceil(0.50*count) - 1];
+    summary.p95 = sorted[(int)ceil(0.95*count) - 1];
+    summary.p99 = sorted[(int)ceil(0.99*count) - 1];
+    summary.max = sorted[count - 1];
+
+    free(sorted);
+    return summary;
+}
+
+static void WriteSummary(FILE *file, const char *name, BenchSummary summary, bool last) {
+    fprintf(file, "    \"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n", name,
+            summary.mean*1000.0, summary.p50*1000.0, summary.p95*1000.0, summary.p99*1000.0, summary.max*1000.0, last? "" : ",");
+}
+
+bool SaveBenchResults(const BenchRecorder *recorder, const char *baseName) {
+    int frames = recorder->frame;
+
+    FILE *csv = fopen(TextFormat("%s.csv", baseName), "w");
+    if (csv == NULL) {
+        TraceLog(LOG_WARNING, "BENCH: [%s.csv] Failed to save results", baseName);
+        return false;
+    }
+    fprintf(csv, "frame,frame_ms");
+    for (int p = 0; p < BENCH_PHASE_COUNT; p++) fprintf(csv, ",%s_ms", phaseNames[p]);
+    fprintf(csv, ",memory_mb\n");
+    for (int i = 0; i < frames; i++) {
+        fprintf(csv, "%i,%.4f", i, recorder->frameTimes[i]*1000.0);
+        for (int p = 0; p < BENCH_PHASE_COUNT; p++) fprintf(csv, ",%.4f", recorder->phaseTimes[i*BENCH_PHASE_COUNT + p]*1000.0);
+        fprintf(csv, ",%.2f\n", recorder->memoryBytes[i]/1048576.0);
+    }
+    fclose(csv);
+
+    FILE *json = fopen(TextFormat("%s.json", baseName), "w");
+    if (json == NULL) {
+        TraceLog(LOG_WARNING, "BENCH: [%s.json] Failed to save results", baseName);
+        return false;
+    }
+    BenchSummary frameSummary = GetBenchSummary(recorder->frameTimes, frames, 1);
+    fprintf(json, "{\n");
+    fprintf(json, "  \"frames\": %i,\n", frames);
+    fprintf(json, "  \"timestep_ms\": %.4f,\n", BENCH_TIMESTEP*1000.0);
+    fprintf(json, "  \"load_ms\": %.4f,\n", recorder->loadTime*1000.0);
+    fprintf(json, "  \"frame_ms\": {\n");
+    WriteSummary(json, "total", frameSummary, false);
+    for (int p = 0; p < BENCH_PHASE_COUNT; p++) {
+        WriteSummary(json, phaseNames[p], GetBenchSummary(recorder->phaseTimes + p, frames, BENCH_PHASE_COUNT), p == BENCH_PHASE_COUNT - 1);
+    }
+    fprintf(json, "  },\n");
+    size_t largest = 0;
+    for (int i = 0; i < frames; i++) largest = (recorder->memoryBytes[i] > largest)? recorder->memoryBytes[i] : largest;
+    fprintf(json, "  \"memory_mb\": { \"first\": %.2f, \"last\": %.2f, \"max\": %.2f }\n", (frames > 0)? recorder->memoryBytes[0]/1048576.0 : 0.0,
+            (frames > 0)? recorder->memoryBytes[frames - 1]/1048576.0 : 0.0, largest/1048576.0);
+    fprintf(json, "}\n");
+    fclose(json);
+
+    TraceLog(LOG_INFO, "BENCH: %i frames, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms", frames,
+             frameSummary.p50*1000.0, frameSummary.p95*1000.0, frameSummary.p99*1000.0, frameSummary.max*1000.0);
+    TraceLog(LOG_INFO, "BENCH: Saved results to %s.csv and %s.json", baseName, baseName);
+    return true;
+}
@@ -0,0 +1,70 @@
+/*******************************************************************************************
+*
+*   bench - Reproducible benchmark runs of the game loop
+*
+*   A benchmark run replaces the mouse and keyboard with a camera path, one camera per frame,
+*   and advances the game by a fixed timestep so every run covers the same ground. Paths are
+*   either generated (GenCameraPath) or recorded from a normal play session (--record-path).
+*
+*   BenchRecorder times each frame and the phases inside it. MarkBenchPhase() ends the
+*   phase that is running and starts the next one, so the phases of a frame add up to the
+*   whole frame. SaveBenchResults() writes a per-frame CSV and a JSON summary with the mean,
+*   p50, p95, p99 and max of the frame and of every phase, in milliseconds. SetBenchMemory()
+*   records the memory held by the chunks each frame, the summary has its first, last and
+*   largest value so a long run shows whether it stays flat.
+*
+********************************************************************************************/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "raylib.h"
+#include <stddef.h>
+
+#define BENCH_TIMESTEP (1.0f/60.0f)     // Seconds of game time per benchmark frame
+#define BENCH_FRAMES 3600               // Default benchmark length, one minute of game time
+
+typedef enum {
+    BENCH_PHASE_CHUNKS = 0,             // Chunk requests and uploads
+    BENCH_PHASE_UPDATE,                 // Camera and ground collision
+    BENCH_PHASE_DRAW,                   // Draw submission
+    BENCH_PHASE_PRESENT,                // EndDrawing(), buffer swap and event polling
+    BENCH_PHASE_COUNT
+} BenchPhase;
+
+typedef struct CameraPath {
+    Vector3 *positions;
+    Vector3 *targets;
+    int count;
+    int capacity;
+} CameraPath;
+
+typedef struct BenchRecorder {
+    int frameCount;                     // Frames to record
+    int frame;                          // Frames recorded so far
+    double *frameTimes;                 // Seconds, frameCount entries
+    double *phaseTimes;                 // Seconds, frameCount*BENCH_PHASE_COUNT entries
+    size_t *memoryBytes;                // Chunk memory at the end of each frame, frameCount entries
+    double frameStart;
+    double phaseStart;
+    int phase;                          // Phase running, -1 between frames
+    double loadTime;                    // Seconds spent loading before the first frame
+} BenchRecorder;
+
+CameraPath GenCameraPath(int frameCount, float timestep);                  // Level circle over the map at walking speed
+CameraPath LoadCameraPath(const char *fileName);                          // One "px py pz tx ty tz" line per frame
+bool SaveCameraPath(CameraPath path, const char *fileName);
+void AppendCameraPath(CameraPath *path, Camera camera);
+void UnloadCameraPath(CameraPath *path);
+void GetCameraPathFrame(CameraPath path, int frame, Camera *camera);       // Paths shorter than the run loop back to the start
+
+void InitBenchRecorder(BenchRecorder *recorder, int frameCount);
+void UnloadBenchRecorder(BenchRecorder *recorder);
+void BeginBenchFrame(BenchRecorder *recorder);
+void MarkBenchPhase(BenchRecorder *recorder, BenchPhase phase);            // End the running phase and start phase
+void EndBenchFrame(BenchRecorder *recorder);
+void SetBenchMemory(BenchRecorder *recorder, size_t bytes);                // Memory held by the chunks in the frame running
+bool IsBenchFinished(const BenchRecorder *recorder);
+bool SaveBenchResults(const BenchRecorder *recorder, const char *baseName);  // Writes baseName.csv and baseName.json
+
+#endif // BENCH_H
@@ -0,0 +1,373 @@
+#include "chunk.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include "profiler.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes of mip levels first to last - 1 of an image, levels never shrink below a texel
+static size_t GetMipLevelsSize(Image image, int first, int last) {
+    size_t size = 0;
+    for (int level = first; level < last; level++) {
+        int width = (image.width >> level > 0)? image.width >> level : 1;
+        int height = (image.height >> level > 0)? image.height >> level : 1;
+        size += GetPixelDataSize(width, height, image.format);
+    }
+    return size;
+}
+
+IVector2 GetPosChunk(Vector3 position) {
+    return (IVector2){(int)floor(position.x/CHUNK_SIZE), (int)floor(position.z/CHUNK_SIZE)};
+}
+
+ChunkData BuildChunkData(IVector2 chunkID, const ChunkSource* source, bool buildMeshes, Arena* arena) {
+    ChunkData data = { 0 };
+    data.chunkID = chunkID;
+    data.arena = arena;
+
+    if (source->generator != NULL) {
+        // Generated ground is unbounded, every chunk has a full set of samples
+        int sampleCount = (int)CHUNK_SIZE + 1;
+        data.heightfield = GenTerrainHeightfield(source->generator, chunkID.x * (int)CHUNK_SIZE, chunkID.y * (int)CHUNK_SIZE, sampleCount, sampleCount, CHUNK_APRON);
+    } else {
+        // for now all we will have in the chunk is the section of the height map within that chunk
+        Rectangle chunkMapRec = {
+            .x = chunkID.x * CHUNK_SIZE + MAP_SIZE / 2,
+            .y = chunkID.y * CHUNK_SIZE + MAP_SIZE / 2,
+            .width = CHUNK_SIZE + 1,
+            .height = CHUNK_SIZE + 1,
+        };
+        if (chunkMapRec.x + chunkMapRec.width  > MAP_SIZE) chunkMapRec.width = CHUNK_SIZE;
+        if (chunkMapRec.y + chunkMapRec.height > MAP_SIZE) chunkMapRec.height = CHUNK_SIZE;
+
+        // Crop the apron with it where the map has one, the edge of the map repeats its last samples
+        Rectangle apronRec = { chunkMapRec.x - CHUNK_APRON, chunkMapRec.y - CHUNK_APRON, chunkMapRec.width + 2*CHUNK_APRON, chunkMapRec.height + 2*CHUNK_APRON };
+        if (apronRec.x < 0) { apronRec.width += apronRec.x; apronRec.x = 0; }
+        if (apronRec.y < 0) { apronRec.height += apronRec.y; apronRec.y = 0; }
+        if (apronRec.x + apronRec.width  > MAP_SIZE) apronRec.width = MAP_SIZE - apronRec.x;
+        if (apronRec.y + apronRec.height > MAP_SIZE) apronRec.height = MAP_SIZE - apronRec.y;
+        Image heightMapImage = LoadTileRegion(&source->tileCache->heightMap, apronRec);
+        if (heightMapImage.data == NULL) return data;   // Outside the source map, the chunk is empty
+
+        Rectangle area = { chunkMapRec.x - apronRec.x, chunkMapRec.y - apronRec.y, chunkMapRec.width, chunkMapRec.height };
+        data.heightfield = LoadHeightfieldFromImageEx(heightMapImage, area, CHUNK_APRON, (Vector3){chunkID.x * CHUNK_SIZE, 0, chunkID.y * CHUNK_SIZE}, (Vector3){CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE});
+        UnloadImage(heightMapImage);
+    }
+
+    // Adaptive meshes where the heightfield allows them, they keep every border sample so
+    // neighbours meet without skirts. Grids otherwise, and always for instanced terrain.
+    float *rtinErrors = buildMeshes? LoadHeightfieldRtinErrors(&data.heightfield, arena) : NULL;
+    const float rtinMaxErrors[CHUNK_LOD_COUNT] = CHUNK_RTIN_ERRORS;
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        if (rtinErrors != NULL) {
+            data.groundMeshes[lod] = GenHeightfieldRtinMesh(&data.heightfield, rtinErrors, rtinMaxErrors[lod], arena);
+            data.lodError[lod] = GetHeightfieldRtinMeshError(&data.heightfield, data.groundMeshes[lod]);
+        } else {
+            if (buildMeshes) data.groundMeshes[lod] = GenHeightfieldMesh(&data.heightfield, 1 << lod, CHUNK_SKIRT_DEPTH, arena);
+            data.lodError[lod] = GetHeightfieldMeshError(&data.heightfield, 1 << lod);
+        }
+    }
+    if (arena == NULL) UnloadHeightfieldRtinErrors(rtinErrors);
+
+    if (source->generator != NULL) {
+        data.groundTexture = GenTerrainColorImage(source->generator, &data.heightfield, (int)CHUNK_TEX_SCALE);
+    } else {
+        Rectangle chunkMapTexRec = {
+            .x = (chunkID.x * CHUNK_SIZE + MAP_SIZE/2) * CHUNK_TEX_SCALE,
+            .y = (chunkID.y * CHUNK_SIZE + MAP_SIZE/2) * CHUNK_TEX_SCALE,
+            .width = CHUNK_SIZE * CHUNK_TEX_SCALE,
+            .height = CHUNK_SIZE * CHUNK_TEX_SCALE,
+        };
+        data.groundTexture = LoadTileRegion(&source->tileCache->texture, chunkMapTexRec);
+    }
+
+    // Chunks drawn with their own meshes stream their texture levels in and out, the instanced
+    // renderer copies the whole chain into the chunk's colour layer. Either way the levels are
+    // built here on the worker.
+    if (data.groundTexture.data != NULL) ImageMipmaps(&data.groundTexture);
+
+    return data;
+}
+
+void UnloadChunkData(ChunkData data) {
+    if (data.archived) return;      // Nothing was allocated, the arrays belong to the archive
+
+    // The meshes were never uploaded, free the arrays directly so this does not need a GL context
+    if (data.arena == NULL) {
+        for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) UnloadMeshData(&data.groundMeshes[lod]);
+    }
+    UnloadImage(data.groundTexture);
+    UnloadHeightfield(&data.heightfield);
+}
+
+void UploadChunk(Chunk* chunk, ChunkData* data) {
+    PROFILE_BEGIN("UploadChunk");
+    chunk->chunkID = data->chunkID;
+    chunk->numModels = 0;
+    chunk->firstProp = 0;
+    chunk->models = NULL;
+    chunk->modelLocs = NULL;
+    chunk->propGrid = (CollisionGrid){ 0 };
+    chunk->texture = (Image){ 0 };
+    chunk->textureLevel = -1;
+    chunk->heightfield = data->heightfield;
+    chunk->archived = data->archived;
+    data->heightfield = (Heightfield){ 0 };
+
+    // Bounds of the ground surface. Skirts hang below it but only ever fill seams, so they
+    // are left out to keep the box tight for culling.
+    chunk->bounds = (BoundingBox){ 0 };
+    if (chunk->heightfield.heights != NULL) {
+        Vector3 origin = chunk->heightfield.origin;
+        chunk->bounds.min = (Vector3){ origin.x, chunk->heightfield.minHeight, origin.z };
+        chunk->bounds.max = (Vector3){ origin.x + CHUNK_SIZE, chunk->heightfield.maxHeight, origin.z + CHUNK_SIZE };
+    }
+
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) chunk->lodError[lod] = data->lodError[lod];
+
+    if (data->groundMeshes[0].vertexCount > 0) {
+        chunk->numModels = 1;
+        chunk->firstProp = 1;
+        chunk->modelLocs = (Vector3*)malloc(sizeof(Vector3) * chunk->numModels);
+        chunk->modelLocs[0] = (Vector3){data->chunkID.x * CHUNK_SIZE, 0 , data->chunkID.y * CHUNK_SIZE}; // give chunk origin coordinate to ground mesh origin
+
+        // The ground is a single model holding every level of detail, so they share one material
+        for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) UploadMesh(&data->groundMeshes[lod], false);
+        Model ground = LoadModelFromMesh(data->groundMeshes[0]);
+        ground.meshCount = CHUNK_LOD_COUNT;
+        ground.meshes = (Mesh *)RL_REALLOC(ground.meshes, CHUNK_LOD_COUNT*sizeof(Mesh));
+        ground.meshMaterial = (int *)RL_REALLOC(ground.meshMaterial, CHUNK_LOD_COUNT*sizeof(int));
+        for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+            ground.meshes[lod] = data->groundMeshes[lod];
+            ground.meshMaterial[lod] = 0;
+            data->groundMeshes[lod] = (Mesh){ 0 };     // Owned by the model now
+
+            // Ground queries use the heightfield, so only the indices stay on the CPU once the
+            // mesh is on the GPU: DrawMesh() draws indexed when they are there, and anything
+            // else that reads them gets real indices. Archive and arena arrays belong to someone
+            // else, the indices are copied out of them. Otherwise the vertex arrays are freed.
+            Mesh *mesh = &ground.meshes[lod];
+            if (data->archived || (data->arena != NULL)) {
+                unsigned short *indices = NULL;
+                if (mesh->indices != NULL) {
+                    indices = (unsigned short *)RL_MALLOC(mesh->triangleCount*3*sizeof(unsigned short));
+                    memcpy(indices, mesh->indices, mesh->triangleCount*3*sizeof(unsigned short));
+                }
+                mesh->indices = indices;
+            } else {
+                RL_FREE(mesh->vertices);
+                RL_FREE(mesh->normals);
+                RL_FREE(mesh->texcoords);
+            }
+            mesh->vertices = NULL;
+            mesh->normals = NULL;
+            mesh->texcoords = NULL;
+        }
+
+        chunk->models = (Model*)malloc(sizeof(Model) * chunk->numModels);
+        chunk->models[0] = ground;
+    }
+
+    // Keep the texture, the terrain renderer may need to copy it into its layer again. A ground
+    // model starts from the coarsest level of the mip chain, finer ones are uploaded as the
+    // camera comes closer.
+    chunk->texture = data->groundTexture;
+    data->groundTexture = (Image){ 0 };
+    if ((chunk->firstProp > 0) && (chunk->texture.data != NULL)) SetChunkTextureLevel(chunk, GetChunkCoarsestMipLevel(chunk));
+
+    PROFILE_COUNT(PROFILE_UPLOAD_BYTES, (long long)GetChunkGpuBytes(chunk));
+    PROFILE_COUNT(PROFILE_CHUNK_LOADS, 1);
+    PROFILE_END();
+}
+
+void LoadChunk(Chunk* chunk, IVector2 chunkID, const ChunkSource* source) { // Loads the chunk data for chunkID into chunk
+    PROFILE_BEGIN("LoadChunk");
+    ChunkData data = BuildChunkData(chunkID, source, true, NULL);
+    UploadChunk(chunk, &data);
+    SetChunkTextureLevel(chunk, 0);     // Nothing streams the levels of a chunk loaded on its own
+    PROFILE_END();
+}
+
+void UnloadChunk(Chunk* chunk) {
+    // raylib's UnloadModel() leaves material textures loaded: the ground's streamed level and
+    // whatever textures the props came with go here
+    if (chunk->textureLevel >= 0) UnloadTexture(chunk->models[0].materials[0].maps[MATERIAL_MAP_DIFFUSE].texture);
+    for (int i = chunk->firstProp; i < chunk->numModels; i++) {
+        Model model = chunk->models[i];
+        for (int m = 0; m < model.materialCount; m++) {
+            for (int map = 0; map <= MATERIAL_MAP_BRDF; map++) {
+                Texture2D texture = model.materials[m].maps[map].texture;
+                if ((texture.id > 0) && (texture.id != rlGetTextureIdDefault())) UnloadTexture(texture);
+            }
+        }
+    }
+
+    for (int i = 0; i < chunk->numModels; i++) UnloadModel(chunk->models[i]);
+    free(chunk->models);
+    free(chunk->modelLocs);
+    chunk->models = NULL;
+    chunk->modelLocs = NULL;
+    chunk->numModels = 0;
+    chunk->firstProp = 0;
+    UnloadCollisionGrid(&chunk->propGrid);
+    if (!chunk->archived) {
+        UnloadImage(chunk->texture);
+        UnloadHeightfield(&chunk->heightfield);
+    }
+    chunk->heightfield = (Heightfield){ 0 };
+    chunk->texture = (Image){ 0 };
+    chunk->textureLevel = -1;
+}
+
+void AddChunkProp(Chunk* chunk, Model model, Vector3 position) {
+    chunk->numModels++;
+    chunk->models = (Model*)realloc(chunk->models, sizeof(Model) * chunk->numModels);
+    chunk->modelLocs = (Vector3*)realloc(chunk->modelLocs, sizeof(Vector3) * chunk->numModels);
+    chunk->models[chunk->numModels - 1] = model;
+    chunk->modelLocs[chunk->numModels - 1] = position;
+
+    // Rebuild the grid over every prop, adding props is rare next to colliding with them
+    int propCount = chunk->numModels - chunk->firstProp;
+    Vector2 origin = { chunk->chunkID.x * CHUNK_SIZE, chunk->chunkID.y * CHUNK_SIZE };
+    UnloadCollisionGrid(&chunk->propGrid);
+    chunk->propGrid = LoadCollisionGrid(&chunk->models[chunk->firstProp], &chunk->modelLocs[chunk->firstProp], propCount, origin, CHUNK_SIZE);
+
+    // Props standing out of the ground have to keep the chunk from being culled
+    if (chunk->propGrid.triangleCount > 0) {
+        chunk->bounds.min.y = fminf(chunk->bounds.min.y, chunk->propGrid.minHeight);
+        chunk->bounds.max.y = fmaxf(chunk->bounds.max.y, chunk->propGrid.maxHeight);
+    }
+}
+
+float GetChunkDistance(const Chunk* chunk, Vector3 position) {
+    Vector3 closest = Vector3Min(Vector3Max(position, chunk->bounds.min), chunk->bounds.max);
+    return Vector3Distance(position, closest);
+}
+
+int GetChunkLod(const Chunk* chunk, Camera camera, float screenHeight) {
+    if (chunk->heightfield.heights == NULL) return 0;
+
+    float distance = fmaxf(GetChunkDistance(chunk, camera.position), 1.0f);
+
+    // Pixels covered by one world unit at that distance
+    float pixelsPerUnit = screenHeight / (2.0f * tanf(camera.fovy * DEG2RAD * 0.5f) * distance);
+
+    for (int lod = CHUNK_LOD_COUNT - 1; lod > 0; lod--) {
+        if (chunk->lodError[lod] * pixelsPerUnit <= CHUNK_LOD_PIXEL_ERROR) return lod;
+    }
+    return 0;
+}
+
+int GetChunkTriangleCount(const Chunk* chunk, int lodLevel) {
+    if (chunk->firstProp == 0) return 0;
+    Model ground = chunk->models[0];
+    if (lodLevel >= ground.meshCount) lodLevel = ground.meshCount - 1;
+    return ground.meshes[lodLevel].triangleCount;
+}
+
+size_t GetChunkGpuBytes(const Chunk* chunk) {
+    size_t bytes = 0;
+    for (int i = 0; i < chunk->numModels; i++) {
+        Model model = chunk->models[i];
+        for (int m = 0; m < model.meshCount; m++) {
+            bytes += model.meshes[m].vertexCount*(3 + 3 + 2)*sizeof(float);            // Positions, normals, texcoords
+            bytes += model.meshes[m].triangleCount*3*sizeof(unsigned short);
+        }
+        Texture2D texture = model.materials[0].maps[MATERIAL_MAP_DIFFUSE].texture;
+        size_t textureBytes = GetPixelDataSize(texture.width, texture.height, texture.format);
+        bytes += (texture.mipmaps > 1)? textureBytes*4/3 : textureBytes;
+    }
+    return bytes;
+}
+
+size_t GetChunkCpuBytes(const Chunk* chunk) {
+    size_t bytes = chunk->numModels*(sizeof(Model) + sizeof(Vector3));
+
+    // Props keep their vertex data, the ground only keeps its indices
+    for (int i = 0; i < chunk->numModels; i++) {
+        Model model = chunk->models[i];
+        for (int m = 0; m < model.meshCount; m++) {
+            if (model.meshes[m].vertices != NULL) bytes += model.meshes[m].vertexCount*(3 + 3 + 2)*sizeof(float);
+            if (model.meshes[m].indices != NULL) bytes += model.meshes[m].triangleCount*3*sizeof(unsigned short);
+        }
+    }
+
+    const CollisionGrid *grid = &chunk->propGrid;
+    if (grid->cellStarts != NULL) {
+        bytes += grid->triangleCount*3*sizeof(Vector3);
+        bytes += (grid->cellsX*grid->cellsZ + 1 + grid->cellStarts[grid->cellsX*grid->cellsZ])*sizeof(int);
+    }
+
+    // Archived heights and textures are pages of the mapped archive, not counted here
+    if (!chunk->archived) {
+        const Heightfield *heightfield = &chunk->heightfield;
+        if (heightfield->heights != NULL) bytes += (heightfield->samplesZ + 2*heightfield->apron)*heightfield->stride*sizeof(float);
+        if (chunk->texture.data != NULL) bytes += GetMipLevelsSize(chunk->texture, 0, chunk->texture.mipmaps);
+    }
+    return bytes;
+}
+
+int GetChunkMipLevel(const Chunk* chunk, Camera camera, float screenHeight) {
+    if (chunk->texture.data == NULL) return 0;
+
+    float distance = fmaxf(GetChunkDistance(chunk, camera.position), 1.0f);
+
+    // Pixels covered by one world unit at that distance, every level halves the texels per unit
+    float pixelsPerUnit = screenHeight / (2.0f * tanf(camera.fovy * DEG2RAD * 0.5f) * distance);
+    float texelsPerUnit = chunk->texture.width / CHUNK_SIZE;
+    int level = (int)floorf(log2f(texelsPerUnit / pixelsPerUnit));
+
+    int coarsest = GetChunkCoarsestMipLevel(chunk);
+    return (level < 0)? 0 : (level > coarsest)? coarsest : level;
+}
+
+int GetChunkCoarsestMipLevel(const Chunk* chunk) {
+    int level = 0;
+    while ((level < chunk->texture.mipmaps - 1) && ((chunk->texture.width >> level) > CHUNK_TEXTURE_MIN_SIZE)) level++;
+    return level;
+}
+
+size_t GetChunkTextureBytes(const Chunk* chunk, int level) {
+    return GetMipLevelsSize(chunk->texture, level, chunk->texture.mipmaps);
+}
+
+size_t SetChunkTextureLevel(Chunk* chunk, int level) {
+    if ((chunk->firstProp == 0) || (chunk->texture.data == NULL)) return 0;
+    int coarsest = GetChunkCoarsestMipLevel(chunk);
+    if (level < 0) level = 0;
+    if (level > coarsest) level = coarsest;
+    if (level == chunk->textureLevel) return 0;
+
+    // The levels from level down are already laid out as a mip chain of their own
+    Image levels = chunk->texture;
+    levels.data = (unsigned char *)chunk->texture.data + GetMipLevelsSize(chunk->texture, 0, level);
+    levels.width = (chunk->texture.width >> level > 0)? chunk->texture.width >> level : 1;
+    levels.height = (chunk->texture.height >> level > 0)? chunk->texture.height >> level : 1;
+    levels.mipmaps = chunk->texture.mipmaps - level;
+    Texture2D texture = LoadTextureFromImage(levels);
+    if (texture.id == 0) return 0;
+    if (texture.mipmaps > 1) SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+
+    // Swap it in, the old texture stays in use until the new one is ready
+    Texture2D *current = &chunk->models[0].materials[0].maps[MATERIAL_MAP_DIFFUSE].texture;
+    if (chunk->textureLevel >= 0) UnloadTexture(*current);
+    *current = texture;
+    chunk->textureLevel = level;
+
+    return GetChunkTextureBytes(chunk, level);
+}
+
+void DrawChunk(Chunk chunk, int lodLevel) {
+    // The first model is the ground when there is one, draw that in relation to the chunk origin
+    if (chunk.firstProp > 0) {
+        Model ground = chunk.models[0];
+        if (lodLevel >= ground.meshCount) lodLevel = ground.meshCount - 1;
+        DrawMesh(ground.meshes[lodLevel], ground.materials[0], MatrixTranslate(chunk.modelLocs[0].x, chunk.modelLocs[0].y, chunk.modelLocs[0].z));
+    }
+    DrawChunkProps(chunk);
+}
+
+void DrawChunkProps(Chunk chunk) {
+    for (int i = chunk.firstProp; i < chunk.numModels; i++) DrawModel(chunk.models[i], chunk.modelLocs[i], 1.0f, WHITE);
+}
@@ -0,0 +1,111 @@
+/*******************************************************************************************
+*
+*   chunk - Terrain chunks
+*
+*   A chunk is a CHUNK_SIZE x CHUNK_SIZE square of the world. Loading one is split in two:
+*   BuildChunkData() does all of the CPU work (cropping the source images or generating the
+*   ground, building the heightfield and the ground meshes) and may run on any thread, UploadChunk() turns the
+*   result into GPU resources and must run on the thread that owns the OpenGL context.
+*
+*   The ground model has one mesh per level of detail. Level n is an adaptive mesh (rtin.h)
+*   whose error stays under CHUNK_RTIN_ERRORS[n]; chunks whose heightfield is not 2^k + 1
+*   samples across fall back to a grid over every 2^n-th sample, with skirts. Chunks drawn by
+*   the instanced terrain renderer (terrainrender.h) skip the meshes and only keep their
+*   heightfield, their levels are always grids. GetChunkLod() picks the coarsest level whose
+*   error stays under CHUNK_LOD_PIXEL_ERROR pixels on screen.
+*
+*   A chunk keeps its ground texture in CPU memory with a whole mip chain, generated while it
+*   is built, and only has the levels from textureLevel down on the GPU. It starts out with
+*   the coarsest level that is still CHUNK_TEXTURE_MIN_SIZE texels across or more, and
+*   SetChunkTextureLevel() swaps in a texture with finer or coarser levels. GetChunkMipLevel()
+*   picks the coarsest level that still has a texel for every pixel the chunk covers on
+*   screen. The chunk stream decides which level each chunk gets.
+*
+*   Props are extra models placed in a chunk with AddChunkProp(), after the ground model.
+*   Their triangles are indexed in the chunk's collision grid (collision.h) as they are added.
+*
+********************************************************************************************/
+
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include "raylib.h"
+#include "heightfield.h"
+#include "terrainmesh.h"
+#include "rtin.h"
+#include "tilecache.h"
+#include "terraingen.h"
+#include "collision.h"
+#include <stddef.h>
+
+#define MAP_SIZE 1024.0f
+#define CHUNK_SIZE 128.0f
+#define CHUNK_TEX_SCALE 4.0f
+
+#define CHUNK_LOD_COUNT 4               // Full, 1/2, 1/4 and 1/8 sampling
+#define CHUNK_LOD_PIXEL_ERROR 2.0f      // Largest ground error allowed on screen, in pixels
+#define CHUNK_SKIRT_DEPTH CHUNK_SIZE    // Ground heights span at most CHUNK_SIZE, so skirts this deep close any crack
+#define CHUNK_RTIN_ERRORS { 0.0f, 0.5f, 1.5f, 4.0f }   // Largest vertical error of each adaptive ground level, in world units
+#define CHUNK_APRON 1                   // Neighbour samples kept around each heightfield while building, so normals match across seams
+#define CHUNK_ARENA_SIZE (4 << 20)      // Starting size of a chunk build arena, grows to fit the largest chunk
+#define CHUNK_TEXTURE_MIN_SIZE 16       // Ground texture mip levels at most this many texels across are always resident
+
+typedef struct IVector2 {
+    int x;                // Vector x component
+    int y;                // Vector y component
+} IVector2;
+
+// Where chunk ground comes from: the source map images, or the procedural generator when it
+// is not NULL. Generated ground has no edge, the map is MAP_SIZE across around the origin.
+typedef struct ChunkSource {
+    TileCache* tileCache;
+    const TerrainGenerator* generator;
+} ChunkSource;
+
+//Make chunks
+typedef struct Chunk {
+    IVector2 chunkID;                // Chunk ID, indicates its location in the world
+    Model* models;
+    Vector3* modelLocs;
+    int numModels;
+    int firstProp;                   // Models before this one are the ground, props follow it
+    CollisionGrid propGrid;          // Triangles of the props, for collision
+    Heightfield heightfield;         // Ground height samples, used for ground queries instead of the mesh
+    float lodError[CHUNK_LOD_COUNT]; // Largest vertical error of each ground level of detail
+    BoundingBox bounds;              // World space bounds of the ground, used for culling and level of detail
+    Image texture;                   // Ground texture, kept for uploads, with its whole mip chain when the chunk has a ground model
+    int textureLevel;                // Finest mip level of the ground texture on the GPU, -1 when there is none
+    bool archived;                   // The heightfield and the texture point into a chunk archive and are not freed
+} Chunk;
+
+// CPU side of a chunk, nothing in here has been uploaded yet
+typedef struct ChunkData {
+    IVector2 chunkID;
+    Mesh groundMeshes[CHUNK_LOD_COUNT];  // Ground mesh for each level of detail, vertex data only, empty for instanced terrain
+    float lodError[CHUNK_LOD_COUNT]; // Largest vertical error of each level of detail
+    Image groundTexture;             // Ground texture crop, with its mip chain when meshes were built
+    Heightfield heightfield;         // Ground height samples
+    bool archived;                   // Every array points into a chunk archive and is not freed
+    Arena* arena;                    // Arena holding the ground meshes, NULL when they were allocated one by one
+} ChunkData;
+
+IVector2 GetPosChunk(Vector3 position);                                 // Get the ID of the chunk containing a world position
+ChunkData BuildChunkData(IVector2 chunkID, const ChunkSource* source, bool buildMeshes, Arena* arena);  // Do the CPU work for a chunk, safe to call from worker threads, arena may be NULL
+void UnloadChunkData(ChunkData data);                                   // Free chunk data that will not be uploaded, its arena is left to the caller
+void UploadChunk(Chunk* chunk, ChunkData* data);                        // Upload chunk data to the GPU (main thread only), takes ownership of data except its arena, which may be reset afterwards
+void LoadChunk(Chunk* chunk, IVector2 chunkID, const ChunkSource* source);  // Build and upload a chunk in one go
+void UnloadChunk(Chunk* chunk);                                         // Free everything owned by a chunk
+void AddChunkProp(Chunk* chunk, Model model, Vector3 position);         // Place a model in the chunk and make it collide, the chunk takes ownership of it
+float GetChunkDistance(const Chunk* chunk, Vector3 position);          // Distance from a point to the chunk bounds, 0 inside
+int GetChunkLod(const Chunk* chunk, Camera camera, float screenHeight);  // Pick the ground level of detail for a camera
+int GetChunkTriangleCount(const Chunk* chunk, int lodLevel);            // Triangles DrawChunk() submits at a level of detail
+size_t GetChunkGpuBytes(const Chunk* chunk);                            // Video memory used by the chunk's own models
+size_t GetChunkCpuBytes(const Chunk* chunk);                            // Memory the chunk holds on the CPU side
+int GetChunkMipLevel(const Chunk* chunk, Camera camera, float screenHeight);  // Pick the ground texture mip level for a camera
+int GetChunkCoarsestMipLevel(const Chunk* chunk);                       // Ground texture level that always stays resident
+size_t GetChunkTextureBytes(const Chunk* chunk, int level);             // Video memory of the ground texture with level as its finest mip
+size_t SetChunkTextureLevel(Chunk* chunk, int level);                   // Upload the ground texture from level down (main thread only), returns the bytes uploaded
+void DrawChunk(Chunk chunk, int lodLevel);
+void DrawChunkProps(Chunk chunk);                                       // Only the props, for chunks whose ground is drawn by the terrain renderer
+
+#endif // CHUNK_H
@@ -0,0 +1,149 @@
+#include "chunkarchive.h"
+#include "mapfile.h"
+#include <string.h>
+
+static bool IsRangeValid(const ChunkArchive *archive, uint64_t offset, uint64_t size) {
+    return ((offset % CHUNK_ARCHIVE_ALIGNMENT) == 0) && (offset <= archive->size) && (size <= archive->size - offset);
+}
+
+// Bytes of a whole mip chain, 0 when the levels do not make one
+static uint64_t GetMipChainSize(int width, int height, int mipmaps, int format) {
+    if ((width <= 0) || (height <= 0) || (width > CHUNK_ARCHIVE_MAX_TEXTURE) || (height > CHUNK_ARCHIVE_MAX_TEXTURE)) return 0;
+    int maxMipmaps = 1;
+    while (((width > height)? width : height) >> maxMipmaps) maxMipmaps++;
+    if ((mipmaps <= 0) || (mipmaps > maxMipmaps)) return 0;
+
+    uint64_t size = 0;
+    for (int level = 0; level < mipmaps; level++) {
+        size += GetPixelDataSize((width >> level > 0)? width >> level : 1, (height >> level > 0)? height >> level : 1, format);
+    }
+    return size;
+}
+
+// NULL when everything the entry points at is inside the archive and consistent
+static const char *GetEntryError(const ChunkArchive *archive, const ChunkArchiveEntry *entry) {
+    if (entry->samplesX == 0) return NULL;      // Empty chunk
+    if ((entry->samplesX < 2) || (entry->samplesZ < 2) || (entry->apron < 0) || (entry->apron > CHUNK_APRON)) return "bad heightfield size";
+    if (!IsRangeValid(archive, entry->heightsOffset, (uint64_t)(entry->samplesX + 2*entry->apron)*(entry->samplesZ + 2*entry->apron)*sizeof(float))) return "chunk data out of bounds";
+
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        const ChunkArchiveMesh *mesh = &entry->meshes[lod];
+        if ((mesh->vertexCount <= 0) || (mesh->vertexCount > 65536) || (mesh->triangleCount <= 0)) return "bad mesh size";
+        if (!IsRangeValid(archive, mesh->verticesOffset, (uint64_t)mesh->vertexCount*3*sizeof(float))) return "chunk data out of bounds";
+        if (!IsRangeValid(archive, mesh->normalsOffset, (uint64_t)mesh->vertexCount*3*sizeof(float))) return "chunk data out of bounds";
+        if (!IsRangeValid(archive, mesh->texcoordsOffset, (uint64_t)mesh->vertexCount*2*sizeof(float))) return "chunk data out of bounds";
+        if (!IsRangeValid(archive, mesh->indicesOffset, (uint64_t)mesh->triangleCount*3*sizeof(unsigned short))) return "chunk data out of bounds";
+
+        // Uploads and draws trust the indices, a bad one would read past the vertex buffers
+        const unsigned short *indices = (const unsigned short *)(archive->data + mesh->indicesOffset);
+        for (int i = 0; i < mesh->triangleCount*3; i++) {
+            if (indices[i] >= mesh->vertexCount) return "mesh index out of range";
+        }
+    }
+
+    if (entry->textureSize > 0) {
+        if (entry->textureFormat != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8) return "unsupported texture format";
+        if (entry->textureSize != GetMipChainSize(entry->textureWidth, entry->textureHeight, entry->textureMipmaps, entry->textureFormat)) return "texture size does not match its mip chain";
+        if (!IsRangeValid(archive, entry->textureOffset, entry->textureSize)) return "chunk data out of bounds";
+    }
+
+    return NULL;
+}
+
+bool OpenChunkArchive(ChunkArchive *archive, const char *fileName) {
+    memset(archive, 0, sizeof(*archive));
+
+    archive->data = (unsigned char *)MapFile(fileName, &archive->size);
+    if (archive->data == NULL) {
+        TraceLog(LOG_INFO, "CHUNKARCHIVE: [%s] No chunk archive", fileName);
+        return false;
+    }
+
+    const char *error = NULL;
+    const ChunkArchiveHeader *header = (const ChunkArchiveHeader *)archive->data;
+    if (archive->size < sizeof(ChunkArchiveHeader)) error = "file too small";
+    else if (header->magic != CHUNK_ARCHIVE_MAGIC) error = "not a chunk archive";
+    else if (header->version != CHUNK_ARCHIVE_VERSION) error = "baked by a different version, bake it again";
+    else if ((header->chunkSize != CHUNK_SIZE) || (header->lodCount != CHUNK_LOD_COUNT)) error = "baked with different chunk settings, bake it again";
+    else if ((header->chunksX <= 0) || (header->chunksZ <= 0) ||
+             !IsRangeValid(archive, header->entriesOffset, (uint64_t)header->chunksX*header->chunksZ*sizeof(ChunkArchiveEntry))) error = "bad chunk index";
+    else {
+        archive->header = header;
+        archive->entries = (const ChunkArchiveEntry *)(archive->data + header->entriesOffset);
+        for (int i = 0; (i < header->chunksX*header->chunksZ) && (error == NULL); i++) error = GetEntryError(archive, &archive->entries[i]);
+    }
+
+    if (error != NULL) {
+        TraceLog(LOG_WARNING, "CHUNKARCHIVE: [%s] Failed to open chunk archive, %s", fileName, error);
+        CloseChunkArchive(archive);
+        return false;
+    }
+
+    TraceLog(LOG_INFO, "CHUNKARCHIVE: [%s] Mapped %ix%i chunks (%.1f MB)", fileName, header->chunksX, header->chunksZ, archive->size/(1024.0*1024.0));
+    return true;
+}
+
+void CloseChunkArchive(ChunkArchive *archive) {
+    UnmapFile(archive->data, archive->size);
+    memset(archive, 0, sizeof(*archive));
+}
+
+const ChunkArchiveEntry *GetChunkArchiveEntry(const ChunkArchive *archive, IVector2 chunkID) {
+    int x = chunkID.x - archive->header->chunkMinX;
+    int z = chunkID.y - archive->header->chunkMinZ;
+    if ((x < 0) || (z < 0) || (x >= archive->header->chunksX) || (z >= archive->header->chunksZ)) return NULL;
+    return &archive->entries[x*archive->header->chunksZ + z];
+}
+
+ChunkData LoadChunkDataFromArchive(const ChunkArchive *archive, IVector2 chunkID, bool loadMeshes) {
+    ChunkData data = { 0 };
+    data.chunkID = chunkID;
+    data.archived = true;
+
+    const ChunkArchiveEntry *entry = GetChunkArchiveEntry(archive, chunkID);
+    if ((entry == NULL) || (entry->samplesX == 0)) return data;
+
+    Heightfield *heightfield = &data.heightfield;
+    heightfield->samplesX = entry->samplesX;
+    heightfield->samplesZ = entry->samplesZ;
+    heightfield->stride = entry->samplesX + 2*entry->apron;
+    heightfield->apron = entry->apron;
+    heightfield->heights = (float *)(archive->data + entry->heightsOffset) + entry->apron*heightfield->stride + entry->apron;
+    heightfield->origin = (Vector3){ entry->origin[0], entry->origin[1], entry->origin[2] };
+    heightfield->cellSizeX = entry->cellSizeX;
+    heightfield->cellSizeZ = entry->cellSizeZ;
+    heightfield->minHeight = entry->minHeight;
+    heightfield->maxHeight = entry->maxHeight;
+
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        data.lodError[lod] = entry->lodError[lod];
+        if (!loadMeshes) continue;
+
+        const ChunkArchiveMesh *source = &entry->meshes[lod];
+        Mesh *mesh = &data.groundMeshes[lod];
+        mesh->vertexCount = source->vertexCount;
+        mesh->triangleCount = source->triangleCount;
+        mesh->vertices = (float *)(archive->data + source->verticesOffset);
+        mesh->normals = (float *)(archive->data + source->normalsOffset);
+        mesh->texcoords = (float *)(archive->data + source->texcoordsOffset);
+        mesh->indices = (unsigned short *)(archive->data + source->indicesOffset);
+
+        // Fault the pages in here on the worker, not in the middle of the upload
+        PrefetchMappedRange(mesh->vertices, mesh->vertexCount*3*sizeof(float));
+        PrefetchMappedRange(mesh->normals, mesh->vertexCount*3*sizeof(float));
+        PrefetchMappedRange(mesh->texcoords, mesh->vertexCount*2*sizeof(float));
+        PrefetchMappedRange(mesh->indices, mesh->triangleCount*3*sizeof(unsigned short));
+    }
+    PrefetchMappedRange(archive->data + entry->heightsOffset, heightfield->stride*(heightfield->samplesZ + 2*heightfield->apron)*sizeof(float));
+
+    if (entry->textureSize > 0) {
+        data.groundTexture.data = archive->data + entry->textureOffset;
+        data.groundTexture.width = entry->textureWidth;
+        data.groundTexture.height = entry->textureHeight;
+        data.groundTexture.mipmaps = entry->textureMipmaps;
+        data.groundTexture.format = entry->textureFormat;
+        PrefetchMappedRange(data.groundTexture.data, entry->textureSize);
+    }
+
+    return data;
+}
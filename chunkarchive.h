@@ -0,0 +1,93 @@
+/*******************************************************************************************
+*
+*   chunkarchive - Pre-baked chunk data in a single memory mapped file
+*
+*   The bake tool (bake.c) runs BuildChunkData() for every chunk of the map once and writes
+*   the result to an archive: the height samples and their apron, the vertex, normal, texcoord and index
+*   arrays of every ground level of detail, and the ground texture with its full mip chain.
+*   At run time the archive is mapped read-only and LoadChunkDataFromArchive() hands out
+*   ChunkData whose arrays point straight into the mapping, so nothing is decoded, parsed or
+*   copied before the upload.
+*
+*   Layout, all values in native byte order and every array 16 byte aligned:
+*       ChunkArchiveHeader
+*       chunk arrays, in any order
+*       ChunkArchiveEntry[chunksX*chunksZ], at header.entriesOffset, ordered x major
+*
+*   Changing any of these structs, CHUNK_LOD_COUNT or the mesh layout means bumping
+*   CHUNK_ARCHIVE_VERSION, old archives are then refused and have to be baked again.
+*
+*   Opening an archive checks every entry before anything is handed out: each array has to lie
+*   inside the file, every index has to name a vertex of its mesh and the texture has to be
+*   exactly the RGBA mip chain its size and level count describe. A truncated or corrupt file
+*   is refused instead of making an upload read past the mapping.
+*
+********************************************************************************************/
+
+#ifndef CHUNKARCHIVE_H
+#define CHUNKARCHIVE_H
+
+#include "chunk.h"
+#include <stdint.h>
+#include <stddef.h>
+
+#define CHUNK_ARCHIVE_MAGIC 0x4b4e4843              // "CHNK"
+#define CHUNK_ARCHIVE_VERSION 5
+#define CHUNK_ARCHIVE_ALIGNMENT 16
+#define CHUNK_ARCHIVE_MAX_TEXTURE 16384             // Widest ground texture an archive may hold
+#define CHUNK_ARCHIVE_FILE "resources/chunks.bin"   // Default archive, written by bake
+
+typedef struct ChunkArchiveHeader {
+    uint32_t magic;
+    uint32_t version;
+    float chunkSize;
+    int32_t lodCount;
+    int32_t chunkMinX;              // ID of the first chunk in each direction
+    int32_t chunkMinZ;
+    int32_t chunksX;
+    int32_t chunksZ;
+    uint64_t entriesOffset;
+} ChunkArchiveHeader;
+
+typedef struct ChunkArchiveMesh {
+    int32_t vertexCount;
+    int32_t triangleCount;
+    uint64_t verticesOffset;        // vertexCount*3 floats
+    uint64_t normalsOffset;         // vertexCount*3 floats
+    uint64_t texcoordsOffset;       // vertexCount*2 floats
+    uint64_t indicesOffset;         // triangleCount*3 unsigned shorts
+} ChunkArchiveMesh;
+
+typedef struct ChunkArchiveEntry {
+    int32_t samplesX;               // 0 for a chunk with no ground
+    int32_t samplesZ;
+    int32_t apron;                  // Neighbour samples stored around the chunk's own, at most CHUNK_APRON
+    float origin[3];
+    float cellSizeX;
+    float cellSizeZ;
+    float minHeight;
+    float maxHeight;
+    float lodError[CHUNK_LOD_COUNT];
+    uint64_t heightsOffset;         // (samplesX + 2*apron)*(samplesZ + 2*apron) floats, from the apron's corner
+    ChunkArchiveMesh meshes[CHUNK_LOD_COUNT];
+    int32_t textureWidth;
+    int32_t textureHeight;
+    int32_t textureMipmaps;
+    int32_t textureFormat;          // Always PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+    uint64_t textureOffset;         // Every mip level, largest first, as ImageMipmaps() lays them out
+    uint64_t textureSize;           // Has to match the mip chain exactly
+} ChunkArchiveEntry;
+
+typedef struct ChunkArchive {
+    unsigned char *data;            // Whole file, mapped read-only
+    size_t size;
+    const ChunkArchiveHeader *header;
+    const ChunkArchiveEntry *entries;
+} ChunkArchive;
+
+bool OpenChunkArchive(ChunkArchive *archive, const char *fileName);    // Map and validate an archive, false if it is missing or unusable
+void CloseChunkArchive(ChunkArchive *archive);                         // Every ChunkData and Chunk loaded from the archive must be unloaded first
+const ChunkArchiveEntry *GetChunkArchiveEntry(const ChunkArchive *archive, IVector2 chunkID);   // NULL outside the baked map
+ChunkData LoadChunkDataFromArchive(const ChunkArchive *archive, IVector2 chunkID, bool loadMeshes);   // Zero copy, safe to call from worker threads
+
+#endif // CHUNKARCHIVE_H
@@ -0,0 +1,122 @@
+#include "chunkcache.h"
+#include <stdlib.h>
+
+static unsigned int HashChunkID(IVector2 chunkID) {
+    unsigned int hash = (unsigned int)chunkID.x*0x9e3779b1u ^ (unsigned int)chunkID.y*0x85ebca77u;
+    return hash ^ (hash >> 15);
+}
+
+static bool SameChunk(IVector2 a, IVector2 b) {
+    return (a.x == b.x) && (a.y == b.y);
+}
+
+// Bucket holding the chunk, or the empty bucket where it would go
+static int FindBucket(const ChunkCache *cache, IVector2 chunkID) {
+    int mask = cache->bucketCount - 1;
+    int bucket = (int)(HashChunkID(chunkID) & mask);
+    while ((cache->buckets[bucket] >= 0) && !SameChunk(cache->entries[cache->buckets[bucket]].chunkID, chunkID)) bucket = (bucket + 1) & mask;
+    return bucket;
+}
+
+void InitChunkCache(ChunkCache *cache, int capacity, size_t budget) {
+    *cache = (ChunkCache){ 0 };
+    cache->capacity = capacity;
+    cache->budget = budget;
+    cache->entries = (ChunkEntry *)calloc(capacity, sizeof(ChunkEntry));
+
+    // Half empty at worst keeps probe sequences short
+    cache->bucketCount = 1;
+    while (cache->bucketCount < 2*capacity) cache->bucketCount *= 2;
+    cache->buckets = (int *)malloc(cache->bucketCount*sizeof(int));
+    for (int i = 0; i < cache->bucketCount; i++) cache->buckets[i] = -1;
+}
+
+void UnloadChunkCache(ChunkCache *cache) {
+    for (int i = 0; i < cache->entryCount; i++) {
+        if (cache->entries[i].state != CHUNK_LOADING) UnloadChunk(&cache->entries[i].chunk);
+    }
+    free(cache->entries);
+    free(cache->buckets);
+    *cache = (ChunkCache){ 0 };
+}
+
+ChunkEntry *GetChunkEntry(const ChunkCache *cache, IVector2 chunkID) {
+    int index = cache->buckets[FindBucket(cache, chunkID)];
+    return (index >= 0)? &cache->entries[index] : NULL;
+}
+
+ChunkEntry *AddChunkEntry(ChunkCache *cache, IVector2 chunkID) {
+    int bucket = FindBucket(cache, chunkID);
+    if (cache->buckets[bucket] >= 0) return &cache->entries[cache->buckets[bucket]];
+    if (cache->entryCount == cache->capacity) return NULL;
+
+    ChunkEntry *entry = &cache->entries[cache->entryCount];
+    *entry = (ChunkEntry){ 0 };
+    entry->chunkID = chunkID;
+    entry->state = CHUNK_LOADING;
+    cache->buckets[bucket] = cache->entryCount++;
+    return entry;
+}
+
+void RemoveChunkEntry(ChunkCache *cache, ChunkEntry *entry) {
+    if (entry->state != CHUNK_LOADING) UnloadChunk(&entry->chunk);
+    int index = (int)(entry - cache->entries);
+    int mask = cache->bucketCount - 1;
+
+    // Empty the entry's bucket, then move back every entry of the run after it that would
+    // not be found past the gap any more
+    int hole = FindBucket(cache, entry->chunkID);
+    for (int bucket = (hole + 1) & mask; cache->buckets[bucket] >= 0; bucket = (bucket + 1) & mask) {
+        int home = (int)(HashChunkID(cache->entries[cache->buckets[bucket]].chunkID) & mask);
+        if (((bucket - home) & mask) >= ((bucket - hole) & mask)) {
+            cache->buckets[hole] = cache->buckets[bucket];
+            hole = bucket;
+        }
+    }
+    cache->buckets[hole] = -1;
+
+    // Keep the entries packed, the last one takes the free place
+    int last = --cache->entryCount;
+    if (index != last) {
+        cache->buckets[FindBucket(cache, cache->entries[last].chunkID)] = index;
+        cache->entries[index] = cache->entries[last];
+    }
+}
+
+void UpdateChunkCacheBytes(ChunkCache *cache) {
+    cache->cpuBytes = 0;
+    cache->gpuBytes = 0;
+    for (int i = 0; i < cache->entryCount; i++) {
+        ChunkEntry *entry = &cache->entries[i];
+        entry->cpuBytes = (entry->state != CHUNK_LOADING)? GetChunkCpuBytes(&entry->chunk) : 0;
+        entry->gpuBytes = (entry->state != CHUNK_LOADING)? GetChunkGpuBytes(&entry->chunk) : 0;
+        cache->cpuBytes += entry->cpuBytes;
+        cache->gpuBytes += entry->gpuBytes;
+    }
+    if (cache->cpuBytes + cache->gpuBytes > cache->peakBytes) cache->peakBytes = cache->cpuBytes + cache->gpuBytes;
+}
+
+int EvictChunks(ChunkCache *cache, int freeEntries) {
+    int evicted = 0;
+    while ((cache->cpuBytes + cache->gpuBytes > cache->budget) || (cache->entryCount > cache->capacity - freeEntries)) {
+        ChunkEntry *oldest = NULL;
+        for (int i = 0; i < cache->entryCount; i++) {
+            ChunkEntry *entry = &cache->entries[i];
+            if ((entry->state == CHUNK_EVICTING) && ((oldest == NULL) || (entry->lastVisible < oldest->lastVisible))) oldest = entry;
+        }
+        if (oldest == NULL) break;      // Everything left is still needed, the budget is too small for the ring
+
+        cache->cpuBytes -= oldest->cpuBytes;
+        cache->gpuBytes -= oldest->gpuBytes;
+        RemoveChunkEntry(cache, oldest);
+        cache->evictionCount++;
+        evicted++;
+    }
+    return evicted;
+}
+
+int GetChunkCacheCount(const ChunkCache *cache, ChunkState state) {
+    int count = 0;
+    for (int i = 0; i < cache->entryCount; i++) count += (cache->entries[i].state == state);
+    return count;
+}
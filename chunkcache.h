@@ -0,0 +1,70 @@
+/*******************************************************************************************
+*
+*   chunkcache - Loaded chunks, looked up by chunk ID
+*
+*   A ChunkCache finds chunks through an open addressing hash table over their IDs. Removals
+*   shift the entries that follow back into the gap, so there are no tombstones and lookups
+*   stay short however many chunks have come and gone. The entries themselves are packed
+*   into one array, so walking every chunk skips nothing; removing one moves the last entry
+*   into its place, so entry pointers are only good until the next removal.
+*
+*   Every entry goes through three states. It is LOADING from the request until its chunk has
+*   been uploaded, RESIDENT while the camera is near it and EVICTING once the camera has left
+*   it behind. Evicting chunks can still be drawn and queried and go back to RESIDENT if the
+*   camera returns. They are only unloaded by EvictChunks(), least recently visible first,
+*   when the cache holds more than its memory budget or needs the entries.
+*
+*   UpdateChunkCacheBytes() measures the CPU and GPU memory of every chunk, ground texture
+*   levels come and go from frame to frame.
+*
+*   Main thread only, unloading chunks needs the OpenGL context.
+*
+********************************************************************************************/
+
+#ifndef CHUNKCACHE_H
+#define CHUNKCACHE_H
+
+#include "chunk.h"
+#include <stddef.h>
+
+typedef enum {
+    CHUNK_LOADING = 0,              // Requested, being built or waiting for its upload
+    CHUNK_RESIDENT,                 // Uploaded and near the camera
+    CHUNK_EVICTING                  // Uploaded and left behind, unloaded when the cache needs room
+} ChunkState;
+
+typedef struct ChunkEntry {
+    IVector2 chunkID;
+    ChunkState state;
+    Chunk chunk;                    // Only valid once the chunk has left CHUNK_LOADING
+    unsigned int lastVisible;       // Last frame the chunk was drawn, or requested if it never was
+    size_t cpuBytes;                // As measured by the last UpdateChunkCacheBytes()
+    size_t gpuBytes;
+} ChunkEntry;
+
+typedef struct ChunkCache {
+    ChunkEntry *entries;            // entryCount entries, packed
+    int entryCount;
+    int capacity;                   // Entries the cache can hold
+    int *buckets;                   // Index of the entry in each bucket, -1 when empty
+    int bucketCount;                // Power of two, at least twice the capacity
+    size_t budget;                  // CPU plus GPU bytes evicting chunks are unloaded to stay under
+
+    // Totals over every entry as of the last UpdateChunkCacheBytes()
+    size_t cpuBytes;
+    size_t gpuBytes;
+    size_t peakBytes;               // Most CPU plus GPU bytes ever measured
+    int loadCount;                  // Chunks uploaded into the cache, counted by whoever uploads them
+    int evictionCount;              // Chunks unloaded by EvictChunks()
+} ChunkCache;
+
+void InitChunkCache(ChunkCache *cache, int capacity, size_t budget);
+void UnloadChunkCache(ChunkCache *cache);                               // Unload every chunk and free the cache
+ChunkEntry *GetChunkEntry(const ChunkCache *cache, IVector2 chunkID);   // NULL when the chunk is not in the cache
+ChunkEntry *AddChunkEntry(ChunkCache *cache, IVector2 chunkID);         // New CHUNK_LOADING entry, NULL when the cache is full
+void RemoveChunkEntry(ChunkCache *cache, ChunkEntry *entry);            // Unload the entry's chunk if it has one and forget it
+void UpdateChunkCacheBytes(ChunkCache *cache);                          // Measure the memory of every chunk
+int EvictChunks(ChunkCache *cache, int freeEntries);                    // Unload evicting chunks until the cache is within budget with freeEntries to spare, returns how many
+int GetChunkCacheCount(const ChunkCache *cache, ChunkState state);      // Entries in a state
+
+#endif // CHUNKCACHE_H
@@ -0,0 +1,484 @@
+#include "chunkstream.h"
+#include "frustum.h"
+#include "profiler.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static bool SameChunk(IVector2 a, IVector2 b) {
+    return (a.x == b.x) && (a.y == b.y);
+}
+
+static bool IsChunkNear(IVector2 center, IVector2 chunkID, int radius) {
+    return (abs(chunkID.x - center.x) <= radius) && (abs(chunkID.y - center.y) <= radius);
+}
+
+//----------------------------------------------------------------------------------
+// Worker threads
+//----------------------------------------------------------------------------------
+
+static ChunkData LoadStreamChunkData(ChunkStream *stream, IVector2 chunkID, Arena *arena) {
+    bool meshes = (stream->renderer == NULL);   // The instanced renderer draws every chunk with shared grids
+    PROFILE_BEGIN("BuildChunkData");
+    ChunkData data = (stream->archive != NULL)? LoadChunkDataFromArchive(stream->archive, chunkID, meshes) : BuildChunkData(chunkID, &stream->source, meshes, arena);
+    PROFILE_END();
+    return data;
+}
+
+// Caller must hold stream->lock. NULL when every arena is in use or the stream builds no
+// meshes, the chunk is then built with plain allocations.
+static Arena *TakeArena(ChunkStream *stream) {
+    if (stream->freeArenaCount == 0) return NULL;
+    return stream->freeArenas[--stream->freeArenaCount];
+}
+
+static void ReleaseArena(ChunkStream *stream, Arena *arena) {
+    if (arena == NULL) return;
+    ResetArena(arena);
+    pthread_mutex_lock(&stream->lock);
+    stream->freeArenas[stream->freeArenaCount++] = arena;
+    pthread_mutex_unlock(&stream->lock);
+}
+
+// Caller must hold stream->lock
+static void PushResult(ChunkStream *stream, ChunkData data) {
+    if (stream->resultCount == stream->resultCapacity) {
+        stream->resultCapacity *= 2;
+        stream->results = (ChunkData *)realloc(stream->results, stream->resultCapacity * sizeof(ChunkData));
+    }
+    stream->results[stream->resultCount++] = data;
+    pthread_cond_signal(&stream->resultReady);
+}
+
+static void *ChunkWorker(void *arg) {
+    ChunkStream *stream = (ChunkStream *)arg;
+    PROFILE_THREAD("chunk worker");
+
+    pthread_mutex_lock(&stream->lock);
+    while (true) {
+        while (!stream->quit && (stream->jobCount == 0)) pthread_cond_wait(&stream->jobReady, &stream->lock);
+        if (stream->quit) break;
+
+        ChunkJob job = stream->jobs[--stream->jobCount];    // Jobs are sorted most urgent last
+        Arena *arena = TakeArena(stream);
+        stream->building++;
+        pthread_mutex_unlock(&stream->lock);
+
+        ChunkData data = LoadStreamChunkData(stream, job.chunkID, arena);
+
+        pthread_mutex_lock(&stream->lock);
+        stream->building--;
+        PushResult(stream, data);
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    return NULL;
+}
+
+int GetDefaultWorkerCount(void) {
+#if defined(_SC_NPROCESSORS_ONLN)
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    int cores = 4;
+#endif
+    int workers = cores - 1;    // Leave a core for the main thread
+    if (workers < 1) workers = 1;
+    if (workers > CHUNK_STREAM_MAX_WORKERS) workers = CHUNK_STREAM_MAX_WORKERS;
+    return workers;
+}
+
+void InitChunkStream(ChunkStream *stream, ChunkSource source, const ChunkArchive *archive, TerrainRenderer *renderer, int workerCount) {
+    memset(stream, 0, sizeof(*stream));
+    stream->source = source;
+    stream->archive = archive;
+    stream->renderer = renderer;
+    stream->textureBudget = CHUNK_TEXTURE_BUDGET;
+    InitChunkCache(&stream->cache, CHUNK_CACHE_CAPACITY, CHUNK_CACHE_BUDGET);
+
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->jobReady, NULL);
+    pthread_cond_init(&stream->resultReady, NULL);
+
+    stream->resultCapacity = CHUNK_STREAM_WINDOW*CHUNK_STREAM_WINDOW;
+    stream->results = (ChunkData *)malloc(stream->resultCapacity * sizeof(ChunkData));
+
+    // Archived and instanced chunks build no meshes and need no arena
+    if ((archive == NULL) && (renderer == NULL)) {
+        for (int i = 0; i < CHUNK_STREAM_ARENAS; i++) {
+            stream->arenas[i] = LoadArena(CHUNK_ARENA_SIZE);
+            stream->freeArenas[stream->freeArenaCount++] = &stream->arenas[i];
+        }
+    }
+
+    if (workerCount > CHUNK_STREAM_MAX_WORKERS) workerCount = CHUNK_STREAM_MAX_WORKERS;
+    for (int i = 0; i < workerCount; i++) {
+        if (pthread_create(&stream->workers[i], NULL, ChunkWorker, stream) != 0) {
+            TraceLog(LOG_WARNING, "CHUNKSTREAM: Failed to start worker %i", i);
+            break;
+        }
+        stream->workerCount++;
+    }
+
+    TraceLog(LOG_INFO, "CHUNKSTREAM: Started with %i worker threads", stream->workerCount);
+}
+
+void CloseChunkStream(ChunkStream *stream) {
+    pthread_mutex_lock(&stream->lock);
+    stream->quit = true;
+    stream->jobCount = 0;
+    pthread_cond_broadcast(&stream->jobReady);
+    pthread_mutex_unlock(&stream->lock);
+
+    for (int i = 0; i < stream->workerCount; i++) pthread_join(stream->workers[i], NULL);
+
+    for (int i = 0; i < stream->resultCount; i++) UnloadChunkData(stream->results[i]);
+    free(stream->results);
+
+    TraceLog(LOG_INFO, "CHUNKSTREAM: %i chunks loaded, %i evicted, at most %.1f MB in memory", stream->cache.loadCount,
+             stream->cache.evictionCount, stream->cache.peakBytes/1048576.0);
+    UnloadChunkCache(&stream->cache);
+    for (int i = 0; i < CHUNK_STREAM_ARENAS; i++) UnloadArena(&stream->arenas[i]);
+
+    pthread_cond_destroy(&stream->resultReady);
+    pthread_cond_destroy(&stream->jobReady);
+    pthread_mutex_destroy(&stream->lock);
+}
+
+//----------------------------------------------------------------------------------
+// Requests
+//----------------------------------------------------------------------------------
+
+// Distance from the camera to the chunk centre, with chunks behind the camera counted as up
+// to twice as far away as chunks straight ahead
+static float GetChunkPriority(IVector2 chunkID, Vector3 position, Vector3 forward) {
+    Vector3 toChunk = { (chunkID.x + 0.5f) * CHUNK_SIZE - position.x, 0.0f, (chunkID.y + 0.5f) * CHUNK_SIZE - position.z };
+    float distance = Vector3Length(toChunk);
+    float facing = (distance > 0.0f)? Vector3DotProduct(toChunk, forward) / distance : 1.0f;
+    return distance * (1.5f - 0.5f * facing);
+}
+
+static int CompareJobs(const void *a, const void *b) {
+    float pa = ((const ChunkJob *)a)->priority;
+    float pb = ((const ChunkJob *)b)->priority;
+    return (pa < pb) - (pa > pb);   // Most urgent (lowest) last
+}
+
+// Caller must hold stream->lock
+static void RemoveJob(ChunkStream *stream, IVector2 chunkID) {
+    for (int i = 0; i < stream->jobCount; i++) {
+        if (SameChunk(stream->jobs[i].chunkID, chunkID)) {
+            stream->jobs[i] = stream->jobs[--stream->jobCount];
+            return;
+        }
+    }
+}
+
+// Caller must hold stream->lock
+static void RequestChunks(ChunkStream *stream, Camera camera) {
+    ChunkCache *cache = &stream->cache;
+    stream->center = GetPosChunk(camera.position);
+
+    // Chunks far enough behind the camera may be evicted. Requests for them are dropped: a
+    // queued job is removed, a chunk already being built is dropped when it arrives.
+    for (int i = 0; i < cache->entryCount; i++) {
+        ChunkEntry *entry = &cache->entries[i];
+        if (IsChunkNear(stream->center, entry->chunkID, CHUNK_STREAM_RADIUS + CHUNK_CACHE_HYSTERESIS)) continue;
+        if (entry->state == CHUNK_RESIDENT) entry->state = CHUNK_EVICTING;
+        else if (entry->state == CHUNK_LOADING) {
+            RemoveJob(stream, entry->chunkID);
+            RemoveChunkEntry(cache, entry);
+            i--;    // The last entry moved into this one
+        }
+    }
+
+    for (int dx = -CHUNK_STREAM_RADIUS; dx <= CHUNK_STREAM_RADIUS; dx++) {
+        for (int dy = -CHUNK_STREAM_RADIUS; dy <= CHUNK_STREAM_RADIUS; dy++) {
+            IVector2 chunkID = { stream->center.x + dx, stream->center.y + dy };
+            ChunkEntry *entry = GetChunkEntry(cache, chunkID);
+            if (entry != NULL) {
+                if (entry->state == CHUNK_EVICTING) entry->state = CHUNK_RESIDENT;     // Back before it was evicted
+                continue;
+            }
+
+            entry = AddChunkEntry(cache, chunkID);
+            if (entry == NULL) continue;    // Full of chunks that are still needed, asked again next update
+            entry->lastVisible = stream->frame;
+            stream->jobs[stream->jobCount++] = (ChunkJob){ chunkID, 0.0f };
+        }
+    }
+
+    // Re-prioritise everything still queued, the camera may have turned since it was requested
+    Vector3 forward = Vector3Subtract(camera.target, camera.position);
+    forward.y = 0.0f;
+    forward = Vector3Normalize(forward);
+    for (int i = 0; i < stream->jobCount; i++) {
+        stream->jobs[i].priority = GetChunkPriority(stream->jobs[i].chunkID, camera.position, forward);
+    }
+    qsort(stream->jobs, stream->jobCount, sizeof(ChunkJob), CompareJobs);
+}
+
+//----------------------------------------------------------------------------------
+// Uploads
+//----------------------------------------------------------------------------------
+
+static void UploadResult(ChunkStream *stream, ChunkData *data) {
+    ChunkEntry *entry = GetChunkEntry(&stream->cache, data->chunkID);
+    Arena *arena = data->arena;
+
+    // Stale result, the chunk was dropped while it was being built, or was requested again
+    // and this is the older of two builds
+    if ((entry == NULL) || (entry->state != CHUNK_LOADING)) {
+        UnloadChunkData(*data);
+        ReleaseArena(stream, arena);
+        return;
+    }
+
+    UploadChunk(&entry->chunk, data);
+    ReleaseArena(stream, arena);
+    entry->state = CHUNK_RESIDENT;
+    stream->cache.loadCount++;
+    if ((stream->renderer != NULL) && IsChunkInStreamRing(stream, entry->chunkID)) UploadTerrainTile(stream->renderer, &entry->chunk);
+
+    // A build requested again after it was dropped may still be queued
+    pthread_mutex_lock(&stream->lock);
+    RemoveJob(stream, entry->chunkID);
+    pthread_mutex_unlock(&stream->lock);
+}
+
+// After the uploads of an update: give the chunks in the ring their atlas tiles back from
+// chunks that share them, then evict chunks until the cache is within its budget with room
+// for a whole new ring
+static void UpdateStreamResidency(ChunkStream *stream) {
+    if (stream->renderer != NULL) {
+        for (int dx = -CHUNK_STREAM_RADIUS; dx <= CHUNK_STREAM_RADIUS; dx++) {
+            for (int dy = -CHUNK_STREAM_RADIUS; dy <= CHUNK_STREAM_RADIUS; dy++) {
+                IVector2 chunkID = { stream->center.x + dx, stream->center.y + dy };
+                ChunkEntry *entry = GetChunkEntry(&stream->cache, chunkID);
+                if ((entry == NULL) || (entry->state == CHUNK_LOADING) || IsTerrainTileLoaded(stream->renderer, chunkID)) continue;
+                UploadTerrainTile(stream->renderer, &entry->chunk);
+            }
+        }
+    }
+
+    UpdateChunkCacheBytes(&stream->cache);
+    stream->evictCount = EvictChunks(&stream->cache, CHUNK_STREAM_WINDOW*CHUNK_STREAM_WINDOW);
+}
+
+// Get the next chunk that is ready to upload, building it here when there are no workers
+static bool NextResult(ChunkStream *stream, ChunkData *data, bool wait) {
+    pthread_mutex_lock(&stream->lock);
+
+    if (stream->workerCount == 0) {
+        if (stream->jobCount == 0) {
+            pthread_mutex_unlock(&stream->lock);
+            return false;
+        }
+        ChunkJob job = stream->jobs[--stream->jobCount];
+        Arena *arena = TakeArena(stream);
+        pthread_mutex_unlock(&stream->lock);
+        *data = LoadStreamChunkData(stream, job.chunkID, arena);
+        return true;
+    }
+
+    if (wait) {
+        while ((stream->resultCount == 0) && ((stream->jobCount > 0) || (stream->building > 0))) {
+            pthread_cond_wait(&stream->resultReady, &stream->lock);
+        }
+    }
+
+    bool found = (stream->resultCount > 0);
+    if (found) {
+        *data = stream->results[0];     // Oldest first, workers take jobs in priority order
+        stream->resultCount--;
+        memmove(stream->results, stream->results + 1, stream->resultCount * sizeof(ChunkData));
+    }
+    pthread_mutex_unlock(&stream->lock);
+
+    return found;
+}
+
+void UpdateChunkStream(ChunkStream *stream, Camera camera, double uploadBudget) {
+    stream->frame++;
+    pthread_mutex_lock(&stream->lock);
+    RequestChunks(stream, camera);
+    if (stream->jobCount > 0) pthread_cond_broadcast(&stream->jobReady);
+    pthread_mutex_unlock(&stream->lock);
+
+    // Always upload at least one chunk per frame so streaming keeps making progress
+    double uploadStart = GetTime();
+    stream->uploadCount = 0;
+    ChunkData data;
+    while (NextResult(stream, &data, false)) {
+        UploadResult(stream, &data);
+        stream->uploadCount++;
+        if (GetTime() - uploadStart >= uploadBudget) break;
+    }
+    stream->uploadTime = GetTime() - uploadStart;
+
+    UpdateStreamResidency(stream);
+}
+
+void FillChunkStream(ChunkStream *stream, Camera camera) {
+    stream->frame++;
+    pthread_mutex_lock(&stream->lock);
+    RequestChunks(stream, camera);
+    pthread_cond_broadcast(&stream->jobReady);
+    pthread_mutex_unlock(&stream->lock);
+
+    double uploadStart = GetTime();
+    stream->uploadCount = 0;
+    ChunkData data;
+    while (NextResult(stream, &data, true)) {
+        UploadResult(stream, &data);
+        stream->uploadCount++;
+    }
+    stream->uploadTime = GetTime() - uploadStart;
+
+    UpdateStreamResidency(stream);
+}
+
+//----------------------------------------------------------------------------------
+// Textures
+//----------------------------------------------------------------------------------
+
+typedef struct TextureRequest {
+    Chunk *chunk;
+    int level;                  // Mip level the chunk should end up with
+    float distance;
+} TextureRequest;
+
+static int CompareTextureRequests(const void *a, const void *b) {
+    float da = ((const TextureRequest *)a)->distance;
+    float db = ((const TextureRequest *)b)->distance;
+    return (da < db) - (da > db);   // Furthest first
+}
+
+void UpdateStreamTextures(ChunkStream *stream, Camera camera, float screenHeight, size_t uploadBytes) {
+    TextureRequest requests[CHUNK_CACHE_CAPACITY];
+    int requestCount = 0;
+    size_t total = 0;
+    for (int i = 0; i < stream->cache.entryCount; i++) {
+        Chunk *chunk = &stream->cache.entries[i].chunk;
+        if ((stream->cache.entries[i].state == CHUNK_LOADING) || (chunk->textureLevel < 0)) continue;    // No texture of its own
+        int level = GetChunkMipLevel(chunk, camera, screenHeight);
+        requests[requestCount++] = (TextureRequest){ chunk, level, GetChunkDistance(chunk, camera.position) };
+        total += GetChunkTextureBytes(chunk, level);
+    }
+    qsort(requests, requestCount, sizeof(TextureRequest), CompareTextureRequests);
+
+    // Over budget every chunk drops a level in turn, furthest first, until it fits. The
+    // coarsest levels always stay, even when they do not fit on their own.
+    bool dropped = true;
+    while ((total > stream->textureBudget) && dropped) {
+        dropped = false;
+        for (int i = 0; (i < requestCount) && (total > stream->textureBudget); i++) {
+            TextureRequest *request = &requests[i];
+            if (request->level >= GetChunkCoarsestMipLevel(request->chunk)) continue;
+            total -= GetChunkTextureBytes(request->chunk, request->level) - GetChunkTextureBytes(request->chunk, request->level + 1);
+            request->level++;
+            dropped = true;
+        }
+    }
+
+    // A chunk one level finer than it needs keeps that level while the budget has room for
+    // it, so a camera going back and forth over a level boundary does not upload it every frame
+    for (int i = requestCount - 1; i >= 0; i--) {
+        TextureRequest *request = &requests[i];
+        if (request->chunk->textureLevel != request->level - 1) continue;
+        size_t extra = GetChunkTextureBytes(request->chunk, request->level - 1) - GetChunkTextureBytes(request->chunk, request->level);
+        if (total + extra > stream->textureBudget) continue;
+        total += extra;
+        request->level--;
+    }
+
+    // Coarser textures first, they free the memory the finer ones are about to take
+    size_t uploaded = 0;
+    for (int i = 0; i < requestCount; i++) {
+        if (requests[i].level > requests[i].chunk->textureLevel) uploaded += SetChunkTextureLevel(requests[i].chunk, requests[i].level);
+    }
+
+    // Then finer ones nearest first, straight to the level they need, while the allowance lasts
+    size_t refined = 0;
+    for (int i = requestCount - 1; i >= 0; i--) {
+        TextureRequest *request = &requests[i];
+        if (request->level >= request->chunk->textureLevel) continue;
+        if ((refined > 0) && (refined + GetChunkTextureBytes(request->chunk, request->level) > uploadBytes)) break;
+        refined += SetChunkTextureLevel(request->chunk, request->level);
+    }
+    uploaded += refined;
+
+    stream->textureBytes = 0;
+    for (int i = 0; i < requestCount; i++) stream->textureBytes += GetChunkTextureBytes(requests[i].chunk, requests[i].chunk->textureLevel);
+    stream->textureUploadBytes = uploaded;
+    PROFILE_COUNT(PROFILE_UPLOAD_BYTES, (long long)uploaded);
+    PROFILE_COUNT(PROFILE_TEXTURE_BYTES, (long long)stream->textureBytes);
+}
+
+Chunk *GetStreamChunk(ChunkStream *stream, IVector2 chunkID) {
+    ChunkEntry *entry = GetChunkEntry(&stream->cache, chunkID);
+    if ((entry == NULL) || (entry->state == CHUNK_LOADING)) return NULL;
+    return &entry->chunk;
+}
+
+bool IsChunkInStreamRing(const ChunkStream *stream, IVector2 chunkID) {
+    return IsChunkNear(stream->center, chunkID, CHUNK_STREAM_RADIUS);
+}
+
+const Heightfield *GetStreamHeightfield(int chunkX, int chunkZ, void *stream) {
+    Chunk *chunk = GetStreamChunk((ChunkStream *)stream, (IVector2){ chunkX, chunkZ });
+    if ((chunk == NULL) || (chunk->heightfield.heights == NULL)) return NULL;
+    return &chunk->heightfield;
+}
+
+const CollisionGrid *GetStreamCollisionGrid(int chunkX, int chunkZ, void *stream) {
+    Chunk *chunk = GetStreamChunk((ChunkStream *)stream, (IVector2){ chunkX, chunkZ });
+    if (chunk == NULL) return NULL;
+    return &chunk->propGrid;
+}
+
+ChunkDrawStats DrawChunkStream(ChunkStream *stream, Camera camera, float aspect, float screenHeight) {
+    ChunkDrawStats stats = { 0 };
+    Frustum frustum = GetCameraFrustum(camera, aspect, (float)rlGetCullDistanceNear(), CHUNK_DRAW_DISTANCE);
+
+    for (int i = 0; i < stream->cache.entryCount; i++) {
+        ChunkEntry *entry = &stream->cache.entries[i];
+        if (entry->state == CHUNK_LOADING) continue;
+        Chunk *chunk = &entry->chunk;
+        if (chunk->heightfield.heights == NULL) continue;     // No ground
+        stats.residentChunks++;
+        stats.groundBytes += (stream->renderer != NULL)? GetTerrainTileBytes(stream->renderer) : GetChunkGpuBytes(chunk);
+
+        int lod = GetChunkLod(chunk, camera, screenHeight);
+        int triangles = (stream->renderer != NULL)? stream->renderer->grids[lod].triangleCount : GetChunkTriangleCount(chunk, lod);
+
+        // Chunks outside the ring may have lost their atlas tiles to a chunk inside it
+        bool hasTile = (stream->renderer == NULL) || IsTerrainTileLoaded(stream->renderer, chunk->chunkID);
+        if (!hasTile || (GetChunkDistance(chunk, camera.position) > CHUNK_DRAW_DISTANCE) || !CheckCollisionBoxFrustum(chunk->bounds, &frustum)) {
+            stats.culledChunks++;
+            stats.culledTriangles += triangles;
+            continue;
+        }
+
+        if (stream->renderer != NULL) {
+            QueueTerrainChunk(stream->renderer, chunk, lod);
+            DrawChunkProps(*chunk);
+        } else {
+            DrawChunk(*chunk, lod);
+            stats.drawCalls++;
+        }
+        stats.drawnChunks++;
+        stats.drawnTriangles += triangles;
+        entry->lastVisible = stream->frame;
+    }
+
+    if (stream->renderer != NULL) stats.drawCalls = FlushTerrainRenderer(stream->renderer);
+
+    return stats;
+}
+
+int GetStreamPendingCount(ChunkStream *stream) {
+    return GetChunkCacheCount(&stream->cache, CHUNK_LOADING);
+}
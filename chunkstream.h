@@ -0,0 +1,121 @@
+/*******************************************************************************************
+*
+*   chunkstream - Asynchronous chunk streaming
+*
+*   Keeps the chunks in a square ring around the camera resident. Missing chunks are queued
+*   for worker threads, nearest and most in-view first, and the workers do all of the CPU
+*   work (BuildChunkData). The main thread only uploads finished chunks to the GPU, and only
+*   for as long as the per-frame upload budget allows. With a chunk archive the workers only
+*   fault in the baked arrays, without one they build chunks from the source images or the
+*   procedural generator. Chunks are independent, so generation spreads over every worker.
+*
+*   Loaded chunks live in a ChunkCache (chunkcache.h) and are looked up by ID. A chunk the
+*   camera leaves behind stays resident until it is more than CHUNK_CACHE_HYSTERESIS chunks
+*   past the ring, and even then is only marked for eviction: it is unloaded, least recently
+*   visible first, once the cache holds more than cache.budget bytes or runs short of
+*   entries. Walking back over a chunk border reuses the chunks just left, and memory stays
+*   within the budget however far the camera goes. Chunk pointers handed out by the stream
+*   are good until the next UpdateChunkStream() or FillChunkStream().
+*
+*   Each mesh build takes an arena (arena.h) from a small pool and hands it back once the
+*   chunk is uploaded, so building ground meshes does not go through malloc.
+*
+*   UpdateStreamTextures() streams the mip levels of the chunk ground textures: every chunk
+*   gets the level its distance needs (GetChunkMipLevel), and while that adds up to more than
+*   textureBudget the furthest chunks drop a level first. Coarser textures are swapped in at
+*   once, finer ones nearest first and only as many as the upload allowance lets through, so
+*   detail arrives over a few frames as the camera moves. Chunks drawn by the terrain renderer
+*   have their colour in its colour layers instead and are left alone.
+*
+*   DrawChunkStream() only submits chunks whose bounds are inside the camera frustum and
+*   within CHUNK_DRAW_DISTANCE. With a TerrainRenderer they are batched into one instanced
+*   draw per level of detail, otherwise each chunk draws its own ground mesh.
+*
+********************************************************************************************/
+
+#ifndef CHUNKSTREAM_H
+#define CHUNKSTREAM_H
+
+#include "chunk.h"
+#include "chunkarchive.h"
+#include "chunkcache.h"
+#include "terrainrender.h"
+#include <pthread.h>
+
+#define CHUNK_STREAM_RADIUS 4                                   // Chunks kept resident in each direction around the camera
+#define CHUNK_STREAM_WINDOW (2*CHUNK_STREAM_RADIUS + 1)         // Width of the ring, in chunks, and of the terrain renderer atlases
+#define CHUNK_CACHE_HYSTERESIS 1                                // Chunks past the ring before a chunk left behind may be evicted
+#define CHUNK_CACHE_CAPACITY 256                                // Chunks kept at most, more than the ring widened by the hysteresis
+#define CHUNK_CACHE_BUDGET ((size_t)384 << 20)                  // Default CPU plus GPU memory for the cached chunks
+#define CHUNK_STREAM_MAX_WORKERS 8
+#define CHUNK_STREAM_ARENAS (2*CHUNK_STREAM_MAX_WORKERS)         // Mesh builds in flight that get an arena, the rest allocate as they go. Each one holds memory from its first use on
+#define CHUNK_UPLOAD_BUDGET 0.002                               // Seconds per frame the main thread may spend uploading chunks
+#define CHUNK_DRAW_DISTANCE (CHUNK_STREAM_RADIUS*CHUNK_SIZE)    // Chunks further than this are not drawn, the ring may not cover them
+#define CHUNK_TEXTURE_BUDGET (64 << 20)                         // Default video memory for the ground textures of every resident chunk
+#define CHUNK_TEXTURE_UPLOAD_BYTES (2 << 20)                    // Finer ground texture levels uploaded per frame, at least one texture always goes through
+
+typedef struct ChunkJob {
+    IVector2 chunkID;
+    float priority;             // Lower is more urgent
+} ChunkJob;
+
+typedef struct ChunkDrawStats {
+    int drawnChunks;
+    int culledChunks;           // Resident chunks outside the frustum or past the draw distance
+    int drawnTriangles;
+    int culledTriangles;        // Triangles the culled chunks would have submitted
+    int drawCalls;
+    int residentChunks;         // Chunks with ground, drawn or not
+    size_t groundBytes;         // Video memory used by the ground of the resident chunks
+} ChunkDrawStats;
+
+typedef struct ChunkStream {
+    ChunkSource source;
+    const ChunkArchive *archive;    // Baked chunks, used instead of source when not NULL
+    TerrainRenderer *renderer;      // Instanced ground drawing, per chunk meshes when NULL
+    ChunkCache cache;           // Every chunk requested or loaded, main thread only
+    IVector2 center;            // Chunk the camera was in at the last update
+    unsigned int frame;         // Updates so far, to find the least recently visible chunks
+
+    // Shared with the workers, guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t jobReady;
+    pthread_cond_t resultReady;
+    ChunkJob jobs[CHUNK_CACHE_CAPACITY];    // Sorted most urgent last, at most one per loading chunk
+    int jobCount;
+    int building;                           // Jobs taken by a worker but not finished yet
+    ChunkData *results;                     // Built chunks waiting for upload
+    int resultCount;
+    int resultCapacity;
+    Arena arenas[CHUNK_STREAM_ARENAS];      // Chunk build memory, each one held from the start of a build until its upload
+    Arena *freeArenas[CHUNK_STREAM_ARENAS];
+    int freeArenaCount;
+    bool quit;
+
+    pthread_t workers[CHUNK_STREAM_MAX_WORKERS];
+    int workerCount;            // 0 builds chunks on the main thread inside UpdateChunkStream()
+
+    size_t textureBudget;       // Video memory the ground textures may use, CHUNK_TEXTURE_BUDGET unless changed
+
+    // Stats for the last update
+    int uploadCount;
+    double uploadTime;
+    int evictCount;
+    size_t textureBytes;        // Video memory used by the ground textures after the last texture update
+    size_t textureUploadBytes;  // Ground texture bytes uploaded by the last texture update
+} ChunkStream;
+
+void InitChunkStream(ChunkStream *stream, ChunkSource source, const ChunkArchive *archive, TerrainRenderer *renderer, int workerCount);  // Start the workers, nothing is requested yet
+void CloseChunkStream(ChunkStream *stream);                                         // Stop the workers and unload every chunk
+void UpdateChunkStream(ChunkStream *stream, Camera camera, double uploadBudget);    // Request chunks around the camera and upload finished ones
+void FillChunkStream(ChunkStream *stream, Camera camera);                           // Load every chunk around the camera before returning
+void UpdateStreamTextures(ChunkStream *stream, Camera camera, float screenHeight, size_t uploadBytes);  // Move chunk textures toward the mip levels the camera needs, within the budget
+Chunk *GetStreamChunk(ChunkStream *stream, IVector2 chunkID);                       // Get a resident chunk, NULL if it is not loaded
+const Heightfield *GetStreamHeightfield(int chunkX, int chunkZ, void *stream);      // HeightfieldLookup over the resident chunks (main thread only)
+const CollisionGrid *GetStreamCollisionGrid(int chunkX, int chunkZ, void *stream);  // CollisionGridLookup over the resident chunks (main thread only)
+ChunkDrawStats DrawChunkStream(ChunkStream *stream, Camera camera, float aspect, float screenHeight);    // Draw the visible chunks, call inside BeginMode3D()
+int GetStreamPendingCount(ChunkStream *stream);                                     // Chunks requested but not uploaded yet
+bool IsChunkInStreamRing(const ChunkStream *stream, IVector2 chunkID);              // Within CHUNK_STREAM_RADIUS of the camera's chunk at the last update
+int GetDefaultWorkerCount(void);                                                    // One worker per spare core
+
+#endif // CHUNKSTREAM_H
@@ -0,0 +1,319 @@
+#include "collision.h"
+#include "raymath.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+static int ClampCell(float position, float origin, float cellSize, int cells) {
+    int cell = (int)floorf((position - origin)/cellSize);
+    return (cell < 0)? 0 : (cell > cells - 1)? cells - 1 : cell;
+}
+
+CollisionGrid LoadCollisionGrid(const Model *models, const Vector3 *positions, int modelCount, Vector2 origin, float size) {
+    CollisionGrid grid = { 0 };
+    grid.origin = origin;
+    grid.cellSize = COLLISION_CELL_SIZE;
+    grid.cellsX = (int)ceilf(size/COLLISION_CELL_SIZE);
+    grid.cellsZ = grid.cellsX;
+    grid.minHeight = FLT_MAX;
+    grid.maxHeight = -FLT_MAX;
+
+    for (int i = 0; i < modelCount; i++) {
+        for (int m = 0; m < models[i].meshCount; m++) {
+            if (models[i].meshes[m].vertices != NULL) grid.triangleCount += models[i].meshes[m].triangleCount;
+        }
+    }
+    if (grid.triangleCount == 0) return grid;
+
+    // Corners in world space, with the same transform DrawModel() uses
+    grid.triangles = (Vector3 *)malloc(grid.triangleCount*3*sizeof(Vector3));
+    int corner = 0;
+    for (int i = 0; i < modelCount; i++) {
+        Matrix transform = MatrixMultiply(models[i].transform, MatrixTranslate(positions[i].x, positions[i].y, positions[i].z));
+        for (int m = 0; m < models[i].meshCount; m++) {
+            Mesh mesh = models[i].meshes[m];
+            if (mesh.vertices == NULL) continue;
+            for (int c = 0; c < mesh.triangleCount*3; c++) {
+                int v = (mesh.indices != NULL)? mesh.indices[c] : c;
+                Vector3 vertex = { mesh.vertices[v*3], mesh.vertices[v*3 + 1], mesh.vertices[v*3 + 2] };
+                grid.triangles[corner] = Vector3Transform(vertex, transform);
+                grid.minHeight = fminf(grid.minHeight, grid.triangles[corner].y);
+                grid.maxHeight = fmaxf(grid.maxHeight, grid.triangles[corner].y);
+                corner++;
+            }
+        }
+    }
+
+    // Count the triangles of each cell, turn the counts into starts, then fill the cells
+    int cellCount = grid.cellsX*grid.cellsZ;
+    grid.cellStarts = (int *)calloc(cellCount + 1, sizeof(int));
+    for (int pass = 0; pass < 2; pass++) {
+        int *cellFill = (pass == 0)? NULL : (int *)malloc(cellCount*sizeof(int));
+        if (pass == 1) {
+            for (int c = 0; c < cellCount; c++) grid.cellStarts[c + 1] += grid.cellStarts[c];
+            for (int c = 0; c < cellCount; c++) cellFill[c] = grid.cellStarts[c];
+            grid.cellTriangles = (int *)malloc(grid.cellStarts[cellCount]*sizeof(int));
+        }
+
+        for (int t = 0; t < grid.triangleCount; t++) {
+            const Vector3 *v = &grid.triangles[t*3];
+            int x0 = ClampCell(fminf(fminf(v[0].x, v[1].x), v[2].x), origin.x, grid.cellSize, grid.cellsX);
+            int x1 = ClampCell(fmaxf(fmaxf(v[0].x, v[1].x), v[2].x), origin.x, grid.cellSize, grid.cellsX);
+            int z0 = ClampCell(fminf(fminf(v[0].z, v[1].z), v[2].z), origin.y, grid.cellSize, grid.cellsZ);
+            int z1 = ClampCell(fmaxf(fmaxf(v[0].z, v[1].z), v[2].z), origin.y, grid.cellSize, grid.cellsZ);
+            for (int z = z0; z <= z1; z++) {
+                for (int x = x0; x <= x1; x++) {
+                    if (pass == 0) grid.cellStarts[z*grid.cellsX + x + 1]++;
+                    else grid.cellTriangles[cellFill[z*grid.cellsX + x]++] = t;
+                }
+            }
+        }
+        free(cellFill);
+    }
+
+    return grid;
+}
+
+void UnloadCollisionGrid(CollisionGrid *grid) {
+    free(grid->triangles);
+    free(grid->cellStarts);
+    free(grid->cellTriangles);
+    *grid = (CollisionGrid){ 0 };
+}
+
+// Closest point to p on the triangle abc, Ericson, Real-Time Collision Detection 5.1.5
+static Vector3 ClosestPointTriangle(Vector3 p, Vector3 a, Vector3 b, Vector3 c) {
+    Vector3 ab = Vector3Subtract(b, a), ac = Vector3Subtract(c, a), ap = Vector3Subtract(p, a);
+    float d1 = Vector3DotProduct(ab, ap), d2 = Vector3DotProduct(ac, ap);
+    if ((d1 <= 0.0f) && (d2 <= 0.0f)) return a;
+
+    Vector3 bp = Vector3Subtract(p, b);
+    float d3 = Vector3DotProduct(ab, bp), d4 = Vector3DotProduct(ac, bp);
+    if ((d3 >= 0.0f) && (d4 <= d3)) return b;
+
+    float vc = d1*d4 - d3*d2;
+    if ((vc <= 0.0f) && (d1 >= 0.0f) && (d3 <= 0.0f)) return Vector3Add(a, Vector3Scale(ab, d1/(d1 - d3)));
+
+    Vector3 cp = Vector3Subtract(p, c);
+    float d5 = Vector3DotProduct(ab, cp), d6 = Vector3DotProduct(ac, cp);
+    if ((d6 >= 0.0f) && (d5 <= d6)) return c;
+
+    float vb = d5*d2 - d1*d6;
+    if ((vb <= 0.0f) && (d2 >= 0.0f) && (d6 <= 0.0f)) return Vector3Add(a, Vector3Scale(ac, d2/(d2 - d6)));
+
+    float va = d3*d6 - d5*d4;
+    if ((va <= 0.0f) && ((d4 - d3) >= 0.0f) && ((d5 - d6) >= 0.0f)) {
+        return Vector3Add(b, Vector3Scale(Vector3Subtract(c, b), (d4 - d3)/((d4 - d3) + (d5 - d6))));
+    }
+
+    float denom = 1.0f/(va + vb + vc);
+    return Vector3Add(a, Vector3Add(Vector3Scale(ab, vb*denom), Vector3Scale(ac, vc*denom)));
+}
+
+// Closest points between the segments p1 q1 and p2 q2, Ericson 5.1.9
+static void ClosestPointsSegments(Vector3 p1, Vector3 q1, Vector3 p2, Vector3 q2, Vector3 *c1, Vector3 *c2) {
+    Vector3 d1 = Vector3Subtract(q1, p1), d2 = Vector3Subtract(q2, p2), r = Vector3Subtract(p1, p2);
+    float a = Vector3DotProduct(d1, d1), e = Vector3DotProduct(d2, d2), f = Vector3DotProduct(d2, r);
+    float s = 0.0f, t = 0.0f;
+
+    if ((a <= EPSILON) && (e <= EPSILON)) {
+        s = t = 0.0f;
+    } else if (a <= EPSILON) {
+        t = Clamp(f/e, 0.0f, 1.0f);
+    } else {
+        float c = Vector3DotProduct(d1, r);
+        if (e <= EPSILON) {
+            s = Clamp(-c/a, 0.0f, 1.0f);
+        } else {
+            float b = Vector3DotProduct(d1, d2);
+            float denom = a*e - b*b;
+            s = (denom != 0.0f)? Clamp((b*f - c*e)/denom, 0.0f, 1.0f) : 0.0f;
+            t = (b*s + f)/e;
+            if (t < 0.0f) { t = 0.0f; s = Clamp(-c/a, 0.0f, 1.0f); }
+            else if (t > 1.0f) { t = 1.0f; s = Clamp((b - c)/a, 0.0f, 1.0f); }
+        }
+    }
+
+    *c1 = Vector3Add(p1, Vector3Scale(d1, s));
+    *c2 = Vector3Add(p2, Vector3Scale(d2, t));
+}
+
+// Move the capsule segment a b out of the triangle v, returns the push, zero when they do not overlap
+static Vector3 GetTrianglePush(Vector3 a, Vector3 b, float radius, const Vector3 *v) {
+    Vector3 push = { 0 };
+    Vector3 normal = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(v[1], v[0]), Vector3Subtract(v[2], v[0])));
+    float distanceA = Vector3DotProduct(Vector3Subtract(a, v[0]), normal);
+    float distanceB = Vector3DotProduct(Vector3Subtract(b, v[0]), normal);
+    if (((distanceA > radius) && (distanceB > radius)) || ((distanceA < -radius) && (distanceB < -radius))) return push;
+
+    // The segment goes through the triangle, push it all the way to the side its middle is on
+    if ((distanceA*distanceB < 0.0f) || (distanceA == 0.0f) || (distanceB == 0.0f)) {
+        float t = (distanceA != distanceB)? distanceA/(distanceA - distanceB) : 0.0f;
+        Vector3 crossing = Vector3Lerp(a, b, t);
+        if (Vector3DistanceSqr(ClosestPointTriangle(crossing, v[0], v[1], v[2]), crossing) <= EPSILON*EPSILON) {
+            if (distanceA + distanceB < 0.0f) {
+                normal = Vector3Negate(normal);
+                distanceA = -distanceA;
+                distanceB = -distanceB;
+            }
+            return Vector3Scale(normal, radius - fminf(fminf(distanceA, distanceB), 0.0f));
+        }
+    }
+
+    // Otherwise the closest points are an end of the segment and the face, or the segment and an edge
+    Vector3 onSegment = a, onTriangle = ClosestPointTriangle(a, v[0], v[1], v[2]);
+    float distanceSqr = Vector3DistanceSqr(onSegment, onTriangle);
+    Vector3 candidate = ClosestPointTriangle(b, v[0], v[1], v[2]);
+    if (Vector3DistanceSqr(b, candidate) < distanceSqr) {
+        onSegment = b;
+        onTriangle = candidate;
+        distanceSqr = Vector3DistanceSqr(b, candidate);
+    }
+    for (int edge = 0; edge < 3; edge++) {
+        Vector3 c1, c2;
+        ClosestPointsSegments(a, b, v[edge], v[(edge + 1)%3], &c1, &c2);
+        if (Vector3DistanceSqr(c1, c2) < distanceSqr) {
+            onSegment = c1;
+            onTriangle = c2;
+            distanceSqr = Vector3DistanceSqr(c1, c2);
+        }
+    }
+
+    if ((distanceSqr >= radius*radius) || (distanceSqr <= EPSILON*EPSILON)) return push;
+    float distance = sqrtf(distanceSqr);
+    return Vector3Scale(Vector3Subtract(onSegment, onTriangle), (radius - distance)/distance);
+}
+
+// Prop triangles whose bounds reach into the box, each listed once even when it spans several
+// cells, from every chunk the box touches. -1 when there are more than maxTriangles of them.
+static int GatherTriangles(const CollisionWorld *world, BoundingBox box, const Vector3 **triangles, int maxTriangles) {
+    int count = 0;
+    for (int chunkZ = (int)floorf(box.min.z/world->chunkSize); chunkZ <= (int)floorf(box.max.z/world->chunkSize); chunkZ++) {
+        for (int chunkX = (int)floorf(box.min.x/world->chunkSize); chunkX <= (int)floorf(box.max.x/world->chunkSize); chunkX++) {
+            const CollisionGrid *grid = world->grids(chunkX, chunkZ, world->userData);
+            if ((grid == NULL) || (grid->triangleCount == 0)) continue;
+            if ((box.min.y > grid->maxHeight) || (box.max.y < grid->minHeight)) continue;
+
+            int x0 = ClampCell(box.min.x, grid->origin.x, grid->cellSize, grid->cellsX);
+            int x1 = ClampCell(box.max.x, grid->origin.x, grid->cellSize, grid->cellsX);
+            int z0 = ClampCell(box.min.z, grid->origin.y, grid->cellSize, grid->cellsZ);
+            int z1 = ClampCell(box.max.z, grid->origin.y, grid->cellSize, grid->cellsZ);
+            for (int z = z0; z <= z1; z++) {
+                for (int x = x0; x <= x1; x++) {
+                    int cell = z*grid->cellsX + x;
+                    for (int i = grid->cellStarts[cell]; i < grid->cellStarts[cell + 1]; i++) {
+                        const Vector3 *v = &grid->triangles[grid->cellTriangles[i]*3];
+                        Vector3 min = Vector3Min(Vector3Min(v[0], v[1]), v[2]);
+                        Vector3 max = Vector3Max(Vector3Max(v[0], v[1]), v[2]);
+                        if ((min.x > box.max.x) || (max.x < box.min.x) || (min.y > box.max.y) || (max.y < box.min.y) ||
+                            (min.z > box.max.z) || (max.z < box.min.z)) continue;
+
+                        // Only take the triangle from the first of its cells inside the box
+                        int firstX = ClampCell(min.x, grid->origin.x, grid->cellSize, grid->cellsX);
+                        int firstZ = ClampCell(min.z, grid->origin.y, grid->cellSize, grid->cellsZ);
+                        if ((x != ((firstX > x0)? firstX : x0)) || (z != ((firstZ > z0)? firstZ : z0))) continue;
+
+                        if (count == maxTriangles) return -1;
+                        triangles[count++] = v;
+                    }
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+// One pass over the triangles, pushing the capsule out of each one it overlaps in turn
+static bool PushCapsuleOut(Capsule *capsule, const Vector3 **triangles, int triangleCount, bool *grounded) {
+    bool pushed = false;
+    for (int i = 0; i < triangleCount; i++) {
+        Vector3 a = { capsule->base.x, capsule->base.y + capsule->radius, capsule->base.z };
+        Vector3 b = { capsule->base.x, capsule->base.y + capsule->height - capsule->radius, capsule->base.z };
+
+        // Cheap bounds test first, most triangles near the move are not near this step
+        const Vector3 *v = triangles[i];
+        float radius = capsule->radius;
+        if ((fminf(fminf(v[0].x, v[1].x), v[2].x) > a.x + radius) || (fmaxf(fmaxf(v[0].x, v[1].x), v[2].x) < a.x - radius)) continue;
+        if ((fminf(fminf(v[0].z, v[1].z), v[2].z) > a.z + radius) || (fmaxf(fmaxf(v[0].z, v[1].z), v[2].z) < a.z - radius)) continue;
+        if ((fminf(fminf(v[0].y, v[1].y), v[2].y) > b.y + radius) || (fmaxf(fmaxf(v[0].y, v[1].y), v[2].y) < a.y - radius)) continue;
+
+        Vector3 push = GetTrianglePush(a, b, radius, v);
+        float length = Vector3Length(push);
+        if (length == 0.0f) continue;
+
+        capsule->base = Vector3Add(capsule->base, push);
+        if (push.y >= COLLISION_GROUND_SLOPE*length) *grounded = true;
+        pushed = true;
+    }
+
+    return pushed;
+}
+
+// Every prop triangle the capsule could touch while moving by move. Pushes never take the
+// capsule further than its radius out of the swept box.
+static int GatherMoveTriangles(const CollisionWorld *world, Capsule capsule, Vector3 move, const Vector3 **triangles) {
+    if (world->grids == NULL) return 0;
+
+    Vector3 end = Vector3Add(capsule.base, move);
+    float reach = 2.0f*capsule.radius;
+    BoundingBox box = {
+        { fminf(capsule.base.x, end.x) - reach, fminf(capsule.base.y, end.y) - reach, fminf(capsule.base.z, end.z) - reach },
+        { fmaxf(capsule.base.x, end.x) + reach, fmaxf(capsule.base.y, end.y) + capsule.height + reach, fmaxf(capsule.base.z, end.z) + reach }
+    };
+    return GatherTriangles(world, box, triangles, COLLISION_MAX_TRIANGLES);
+}
+
+CapsuleMove MoveCapsule(const CollisionWorld *world, Capsule capsule, Vector3 move) {
+    CapsuleMove result = { capsule.base, false, false };
+
+    // Steps stay within half the radius. A move longer than COLLISION_MAX_STEPS of them, after
+    // a long frame, is cut short rather than taking steps a thin prop could slip through.
+    float length = Vector3Length(move);
+    float maxLength = COLLISION_MAX_STEPS*0.5f*capsule.radius;
+    if (length > maxLength) {
+        move = Vector3Scale(move, maxLength/length);
+        length = maxLength;
+    }
+    int steps = (int)ceilf(length/(0.5f*capsule.radius));
+    if (steps < 1) steps = 1;
+    if (steps > COLLISION_MAX_STEPS) steps = COLLISION_MAX_STEPS;
+    Vector3 step = Vector3Scale(move, 1.0f/steps);
+
+    // The triangles are gathered once for as many steps as possible. When the props around a
+    // stretch of the move are too many to hold, it is split into shorter stretches, and a
+    // single step among too many stays where it is: no triangle is ever left out.
+    const Vector3 *triangles[COLLISION_MAX_TRIANGLES];
+    int stretch = steps;
+    for (int done = 0; done < steps; done += stretch) {
+        if (stretch > steps - done) stretch = steps - done;
+        int triangleCount = GatherMoveTriangles(world, capsule, Vector3Scale(step, (float)stretch), triangles);
+        while ((triangleCount < 0) && (stretch > 1)) {
+            stretch = (stretch + 1)/2;
+            triangleCount = GatherMoveTriangles(world, capsule, Vector3Scale(step, (float)stretch), triangles);
+        }
+        if (triangleCount < 0) {
+            result.hitProp = true;
+            break;
+        }
+
+        for (int s = 0; s < stretch; s++) {
+            capsule.base = Vector3Add(capsule.base, step);
+            result.grounded = false;
+
+            for (int i = 0; (i < COLLISION_ITERATIONS) && (triangleCount > 0); i++) {
+                if (!PushCapsuleOut(&capsule, triangles, triangleCount, &result.grounded)) break;
+                result.hitProp = true;
+            }
+
+            float groundHeight;
+            if (GetTerrainHeight(world->heightfields, world->userData, world->chunkSize, capsule.base.x, capsule.base.z, &groundHeight, NULL) && (capsule.base.y <= groundHeight)) {
+                capsule.base.y = groundHeight;
+                result.grounded = true;
+            }
+        }
+    }
+
+    result.base = capsule.base;
+    return result;
+}
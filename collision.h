@@ -0,0 +1,77 @@
+/*******************************************************************************************
+*
+*   collision - Capsule movement against the ground and the props of each chunk
+*
+*   The ground is already a grid (heightfield.h), props get one of their own: a CollisionGrid
+*   splits a chunk into COLLISION_CELL_SIZE columns and lists, for every column, the prop
+*   triangles whose bounds reach into it. A query only tests the triangles listed in the
+*   columns it touches, so its cost follows how crowded the props around it are, not how many
+*   triangles the chunk holds.
+*
+*   MoveCapsule() sweeps the capsule along the move in steps no longer than half its radius, so
+*   it can not pass through a prop thinner than that within one step. A move longer than
+*   COLLISION_MAX_STEPS such steps is cut short. The triangles near the move are gathered from
+*   the grids once, into a buffer of COLLISION_MAX_TRIANGLES. Where the props are too crowded
+*   for that the move is split and each part gathers its own, and a single step that still
+*   does not fit is not taken, so no triangle is ever skipped. After every step the capsule is
+*   pushed out of the triangles it overlaps and lifted out of the ground, which leaves only the
+*   part of the motion along whatever it hit: it slides.
+*
+*   Props should stay inside their chunk. Triangles hanging over its border are kept in the
+*   border columns, and only collide while the capsule overlaps the chunk.
+*
+********************************************************************************************/
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include "raylib.h"
+#include "heightfield.h"
+
+#define COLLISION_CELL_SIZE 4.0f        // Width of a grid column, in world units
+#define COLLISION_MAX_STEPS 32          // Steps of half the radius in one move, longer moves are cut short
+#define COLLISION_ITERATIONS 4          // Push out passes per step, for capsules wedged between props
+#define COLLISION_MAX_TRIANGLES 2048    // Prop triangles gathered at once, crowded moves are split to fit
+#define COLLISION_GROUND_SLOPE 0.7f     // Props whose surface normal points up at least this much can be stood on
+
+typedef struct CollisionGrid {
+    Vector3 *triangles;     // Three world space corners per triangle
+    int triangleCount;
+    int *cellStarts;        // cellTriangles[cellStarts[c]] to cellTriangles[cellStarts[c + 1] - 1] are the triangles of cell c
+    int *cellTriangles;     // Triangle indices, grouped by cell
+    Vector2 origin;         // World x and z of the corner of cell (0, 0)
+    int cellsX;
+    int cellsZ;
+    float cellSize;
+    float minHeight;        // Lowest and highest corner of any triangle
+    float maxHeight;
+} CollisionGrid;
+
+typedef struct Capsule {
+    Vector3 base;           // Bottom of the capsule, where it touches the ground
+    float height;           // From the bottom to the top, at least 2*radius
+    float radius;
+} Capsule;
+
+typedef struct CapsuleMove {
+    Vector3 base;           // Where the capsule ended up
+    bool grounded;          // Ended up on the ground, or on a prop flat enough to stand on
+    bool hitProp;           // Touched a prop on the way
+} CapsuleMove;
+
+// Find the prop grid of a chunk, NULL if there is none
+typedef const CollisionGrid *(*CollisionGridLookup)(int chunkX, int chunkZ, void *userData);
+
+// Everything a capsule collides with, spread over a grid of chunkSize x chunkSize chunks
+typedef struct CollisionWorld {
+    HeightfieldLookup heightfields;
+    CollisionGridLookup grids;      // May be NULL when there are no props
+    void *userData;                 // Passed to both lookups
+    float chunkSize;
+} CollisionWorld;
+
+CollisionGrid LoadCollisionGrid(const Model *models, const Vector3 *positions, int modelCount, Vector2 origin, float size);   // Grid over the triangles of the models drawn at positions, covering size x size from origin
+void UnloadCollisionGrid(CollisionGrid *grid);
+CapsuleMove MoveCapsule(const CollisionWorld *world, Capsule capsule, Vector3 move);     // Sweep the capsule by move, sliding along the ground and props
+
+#endif // COLLISION_H
@@ -0,0 +1,114 @@
+#include "dynres.h"
+#include "rlgl.h"
+#include "external/glad.h"     // rlgl has no timer queries
+#include <string.h>
+
+void LoadDynamicResolution(DynamicResolution *resolution, int width, int height, float targetFps, bool enabled) {
+    memset(resolution, 0, sizeof(DynamicResolution));
+    const float scales[DYNRES_LEVEL_COUNT] = DYNRES_SCALES;
+
+    int levelCount = enabled? DYNRES_LEVEL_COUNT : 1;     // Full resolution only needs the first target
+    for (int level = 0; level < levelCount; level++) {
+        resolution->scales[level] = scales[level];
+        resolution->targets[level] = LoadRenderTexture((int)(width*scales[level]), (int)(height*scales[level]));
+        SetTextureFilter(resolution->targets[level].texture, TEXTURE_FILTER_BILINEAR);
+    }
+
+    resolution->enabled = enabled;
+    resolution->budget = 1.0f/targetFps;
+    resolution->averageFrameTime = resolution->budget;
+    resolution->cooldown = DYNRES_COOLDOWN_FRAMES;
+
+    if (enabled) glGenQueries(DYNRES_QUERY_FRAMES, resolution->queries);
+
+    resolution->upscaleShader = LoadShader(0, "shaders/upscale.fs");
+    resolution->texelSizeLoc = GetShaderLocation(resolution->upscaleShader, "texelSize");
+    resolution->sharpnessLoc = GetShaderLocation(resolution->upscaleShader, "sharpness");
+}
+
+void UnloadDynamicResolution(DynamicResolution *resolution) {
+    for (int level = 0; level < DYNRES_LEVEL_COUNT; level++) {
+        if (resolution->targets[level].id > 0) UnloadRenderTexture(resolution->targets[level]);
+    }
+    if (resolution->enabled) glDeleteQueries(DYNRES_QUERY_FRAMES, resolution->queries);
+    UnloadShader(resolution->upscaleShader);
+    memset(resolution, 0, sizeof(DynamicResolution));
+}
+
+void BeginDynamicResolutionFrame(DynamicResolution *resolution) {
+    if (!resolution->enabled) return;
+
+    resolution->frameStart = GetTime();
+    rlDrawRenderBatchActive();      // Leftovers from the last frame are not this frame's work
+    glBeginQuery(GL_TIME_ELAPSED, resolution->queries[resolution->frameCount % DYNRES_QUERY_FRAMES]);
+}
+
+void EndDynamicResolutionFrame(DynamicResolution *resolution) {
+    if (!resolution->enabled) return;
+
+    rlDrawRenderBatchActive();      // raylib batches draws, send them before the query ends
+    glEndQuery(GL_TIME_ELAPSED);
+    float cpuFrameTime = (float)(GetTime() - resolution->frameStart);
+    resolution->frameCount++;
+
+    // The oldest query in flight, its slot is reused by the next frame
+    if (resolution->frameCount >= DYNRES_QUERY_FRAMES) {
+        unsigned int query = resolution->queries[resolution->frameCount % DYNRES_QUERY_FRAMES];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+            resolution->gpuFrameTime = (float)(nanoseconds*1e-9);
+        }
+    }
+
+    UpdateDynamicResolution(resolution, (cpuFrameTime > resolution->gpuFrameTime)? cpuFrameTime : resolution->gpuFrameTime);
+}
+
+void UpdateDynamicResolution(DynamicResolution *resolution, float frameTime) {
+    if (!resolution->enabled) return;
+
+    // A moving average, so single slow frames such as chunk uploads do not change the scale
+    resolution->averageFrameTime += 0.1f*(frameTime - resolution->averageFrameTime);
+    if (resolution->cooldown > 0) {
+        resolution->cooldown--;
+        return;
+    }
+
+    int level = resolution->level;
+    if ((resolution->averageFrameTime > resolution->budget) && (level < DYNRES_LEVEL_COUNT - 1)) level++;
+    else if (level > 0) {
+        // Assume the frame time follows the pixel count, which overestimates it when the
+        // frame is not limited by pixels, so scaling up stays on the careful side
+        float pixelRatio = (resolution->scales[level - 1]*resolution->scales[level - 1])/(resolution->scales[level]*resolution->scales[level]);
+        if (resolution->averageFrameTime*pixelRatio < resolution->budget*DYNRES_UPSCALE_HEADROOM) level--;
+    }
+
+    if (level != resolution->level) {
+        resolution->level = level;
+        resolution->cooldown = DYNRES_COOLDOWN_FRAMES;
+    }
+}
+
+RenderTexture2D GetDynamicResolutionTarget(const DynamicResolution *resolution) {
+    return resolution->targets[resolution->level];
+}
+
+float GetDynamicResolutionScale(const DynamicResolution *resolution) {
+    return resolution->scales[resolution->level];
+}
+
+void DrawDynamicResolution(const DynamicResolution *resolution, int screenWidth, int screenHeight) {
+    Texture2D texture = resolution->targets[resolution->level].texture;
+    Vector2 texelSize = { 1.0f/texture.width, 1.0f/texture.height };
+    float sharpness = (resolution->level > 0)? DYNRES_SHARPNESS : 0.0f;
+    SetShaderValue(resolution->upscaleShader, resolution->texelSizeLoc, &texelSize, SHADER_UNIFORM_VEC2);
+    SetShaderValue(resolution->upscaleShader, resolution->sharpnessLoc, &sharpness, SHADER_UNIFORM_FLOAT);
+
+    // Render textures are upside down
+    BeginShaderMode(resolution->upscaleShader);
+        DrawTexturePro(texture, (Rectangle){ 0, 0, (float)texture.width, (float)-texture.height },
+                       (Rectangle){ 0, 0, (float)screenWidth, (float)screenHeight }, (Vector2){ 0, 0 }, 0.0f, WHITE);
+    EndShaderMode();
+}
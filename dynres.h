@@ -0,0 +1,63 @@
+/*******************************************************************************************
+*
+*   dynres - Dynamic resolution scaling of the scene render target
+*
+*   The 3D scene is drawn into an offscreen target whose size follows the frame time: when
+*   the average frame takes longer than the budget the scene drops to the next smaller
+*   scale, and it only climbs back once the frame time, scaled by the extra pixels, would
+*   still fit the budget comfortably. After every change the controller waits a while before
+*   it changes again, so it does not flip between two sizes.
+*
+*   The frame time it works from is the time the frame's work takes, not the interval between
+*   frames: that includes the swap, so with vsync it would never drop below the refresh period
+*   and the scale would fall to the smallest and stay there. BeginDynamicResolutionFrame() and
+*   EndDynamicResolutionFrame() bracket everything but the swap, on the CPU with the clock and
+*   on the GPU with a timer query. GPU results are read DYNRES_QUERY_FRAMES - 1 frames later,
+*   so reading them never stalls, and the slower of the two is what the controller sees.
+*
+*   One render texture per scale is created up front, so changing scale never allocates.
+*   DrawDynamicResolution() upscales the current one to the screen with a light sharpening
+*   filter. Anything drawn after it (the HUD) is at native resolution.
+*
+********************************************************************************************/
+
+#ifndef DYNRES_H
+#define DYNRES_H
+
+#include "raylib.h"
+
+#define DYNRES_LEVEL_COUNT 4
+#define DYNRES_SCALES { 1.0f, 0.85f, 0.7f, 0.5f }   // Render scale of each level, per axis
+#define DYNRES_TARGET_FPS 144
+#define DYNRES_UPSCALE_HEADROOM 0.85f   // Only scale up when the estimated frame time stays under this share of the budget
+#define DYNRES_COOLDOWN_FRAMES 30       // Frames to wait after a change before the next one
+#define DYNRES_SHARPNESS 0.2f           // Weight of each neighbour in the sharpening filter when upscaling
+#define DYNRES_QUERY_FRAMES 3           // GPU timer queries in flight, results are read this many frames minus one later
+
+typedef struct DynamicResolution {
+    RenderTexture2D targets[DYNRES_LEVEL_COUNT];
+    float scales[DYNRES_LEVEL_COUNT];
+    int level;                          // Target drawn into this frame
+    bool enabled;                       // Stays at full resolution when false
+    float budget;                       // Frame time to stay under, in seconds
+    float averageFrameTime;
+    int cooldown;                       // Frames left before the level may change again
+    double frameStart;                  // GetTime() at BeginDynamicResolutionFrame()
+    unsigned int queries[DYNRES_QUERY_FRAMES];  // GL_TIME_ELAPSED queries, one per frame in flight
+    int frameCount;                     // Frames timed so far
+    float gpuFrameTime;                 // Latest GPU time read back
+    Shader upscaleShader;
+    int texelSizeLoc;
+    int sharpnessLoc;
+} DynamicResolution;
+
+void LoadDynamicResolution(DynamicResolution *resolution, int width, int height, float targetFps, bool enabled);
+void UnloadDynamicResolution(DynamicResolution *resolution);
+void BeginDynamicResolutionFrame(DynamicResolution *resolution);    // Start timing the frame's work, first thing in the frame
+void EndDynamicResolutionFrame(DynamicResolution *resolution);      // Stop timing and pick the target for the next frame, just before EndDrawing()
+void UpdateDynamicResolution(DynamicResolution *resolution, float frameTime);  // Pick the target for the coming frame from the time a frame's work took
+RenderTexture2D GetDynamicResolutionTarget(const DynamicResolution *resolution);
+float GetDynamicResolutionScale(const DynamicResolution *resolution);
+void DrawDynamicResolution(const DynamicResolution *resolution, int screenWidth, int screenHeight);  // Upscale the current target to the screen, inside BeginDrawing()
+
+#endif // DYNRES_H
@@ -0,0 +1,46 @@
+#include "frustum.h"
+#include "raymath.h"
+#include <math.h>
+
+static Vector4 NormalizePlane(Vector4 plane) {
+    float length = sqrtf(plane.x*plane.x + plane.y*plane.y + plane.z*plane.z);
+    if (length == 0.0f) return plane;
+    return (Vector4){ plane.x/length, plane.y/length, plane.z/length, plane.w/length };
+}
+
+Frustum GetCameraFrustum(Camera camera, float aspect, float nearPlane, float farPlane) {
+    Matrix view = MatrixLookAt(camera.position, camera.target, camera.up);
+    Matrix projection = MatrixPerspective(camera.fovy*DEG2RAD, aspect, nearPlane, farPlane);
+    Matrix m = MatrixMultiply(view, projection);
+
+    // Rows of the clip matrix, raylib matrices are column major
+    Vector4 row0 = { m.m0, m.m4, m.m8, m.m12 };
+    Vector4 row1 = { m.m1, m.m5, m.m9, m.m13 };
+    Vector4 row2 = { m.m2, m.m6, m.m10, m.m14 };
+    Vector4 row3 = { m.m3, m.m7, m.m11, m.m15 };
+
+    Frustum frustum = { 0 };
+    frustum.planes[0] = NormalizePlane((Vector4){ row3.x + row0.x, row3.y + row0.y, row3.z + row0.z, row3.w + row0.w });
+    frustum.planes[1] = NormalizePlane((Vector4){ row3.x - row0.x, row3.y - row0.y, row3.z - row0.z, row3.w - row0.w });
+    frustum.planes[2] = NormalizePlane((Vector4){ row3.x + row1.x, row3.y + row1.y, row3.z + row1.z, row3.w + row1.w });
+    frustum.planes[3] = NormalizePlane((Vector4){ row3.x - row1.x, row3.y - row1.y, row3.z - row1.z, row3.w - row1.w });
+    frustum.planes[4] = NormalizePlane((Vector4){ row3.x + row2.x, row3.y + row2.y, row3.z + row2.z, row3.w + row2.w });
+    frustum.planes[5] = NormalizePlane((Vector4){ row3.x - row2.x, row3.y - row2.y, row3.z - row2.z, row3.w - row2.w });
+
+    return frustum;
+}
+
+bool CheckCollisionBoxFrustum(BoundingBox box, const Frustum *frustum) {
+    for (int i = 0; i < 6; i++) {
+        Vector4 plane = frustum->planes[i];
+
+        // Corner of the box furthest along the plane normal, if it is outside so is the box
+        Vector3 corner = {
+            (plane.x >= 0.0f)? box.max.x : box.min.x,
+            (plane.y >= 0.0f)? box.max.y : box.min.y,
+            (plane.z >= 0.0f)? box.max.z : box.min.z
+        };
+        if (plane.x*corner.x + plane.y*corner.y + plane.z*corner.z + plane.w < 0.0f) return false;
+    }
+    return true;
+}
@@ -0,0 +1,24 @@
+/*******************************************************************************************
+*
+*   frustum - View frustum culling
+*
+*   GetCameraFrustum() extracts the six clip planes from the same projection and view matrices
+*   BeginMode3D() uses, so anything it culls would have been clipped anyway. Boxes are tested
+*   against each plane with the corner furthest along the plane normal, which never culls a
+*   visible box but may keep a few boxes that straddle two planes outside a corner.
+*
+********************************************************************************************/
+
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include "raylib.h"
+
+typedef struct Frustum {
+    Vector4 planes[6];      // Left, right, bottom, top, near, far as (normal, distance), normals point inwards
+} Frustum;
+
+Frustum GetCameraFrustum(Camera camera, float aspect, float nearPlane, float farPlane);    // Perspective camera only
+bool CheckCollisionBoxFrustum(BoundingBox box, const Frustum *frustum);                  // False when the box is fully outside
+
+#endif // FRUSTUM_H
@@ -0,0 +1,236 @@
+#include "heightfield.h"
+#include "raymath.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+
+Heightfield LoadHeightfieldFromImage(Image heightMap, Vector3 origin, Vector3 size) {
+    return LoadHeightfieldFromImageEx(heightMap, (Rectangle){ 0, 0, (float)heightMap.width, (float)heightMap.height }, 0, origin, size);
+}
+
+Heightfield LoadHeightfieldFromImageEx(Image heightMap, Rectangle area, int apron, Vector3 origin, Vector3 size) {
+    Heightfield heightfield = { 0 };
+    int areaX = (int)area.x, areaZ = (int)area.y;
+    int samplesX = (int)area.width, samplesZ = (int)area.height;
+    if ((heightMap.data == NULL) || (samplesX < 2) || (samplesZ < 2)) return heightfield;
+
+    heightfield.samplesX = samplesX;
+    heightfield.samplesZ = samplesZ;
+    heightfield.stride = samplesX + 2*apron;
+    heightfield.apron = apron;
+    heightfield.origin = origin;
+    heightfield.cellSizeX = size.x/(samplesX - 1);
+    heightfield.cellSizeZ = size.z/(samplesZ - 1);
+    float *samples = (float *)RL_MALLOC(heightfield.stride*(samplesZ + 2*apron)*sizeof(float));
+    heightfield.heights = samples + apron*heightfield.stride + apron;
+
+    Color *pixels = LoadImageColors(heightMap);
+    float scaleY = size.y/255.0f;
+    heightfield.minHeight = FLT_MAX;
+    heightfield.maxHeight = -FLT_MAX;
+    for (int z = -apron; z < samplesZ + apron; z++) {
+        int pixelZ = (int)Clamp((float)(areaZ + z), 0.0f, (float)(heightMap.height - 1));
+        for (int x = -apron; x < samplesX + apron; x++) {
+            int pixelX = (int)Clamp((float)(areaX + x), 0.0f, (float)(heightMap.width - 1));
+            Color pixel = pixels[pixelZ*heightMap.width + pixelX];
+            float height = ((float)(pixel.r + pixel.g + pixel.b)/3.0f)*scaleY;    // Same grey value as GenMeshHeightmap()
+            heightfield.heights[z*heightfield.stride + x] = height;
+
+            if ((x < 0) || (z < 0) || (x >= samplesX) || (z >= samplesZ)) continue;     // The apron does not count towards the bounds
+            if (height < heightfield.minHeight) heightfield.minHeight = height;
+            if (height > heightfield.maxHeight) heightfield.maxHeight = height;
+        }
+    }
+    UnloadImageColors(pixels);
+
+    return heightfield;
+}
+
+void UnloadHeightfield(Heightfield *heightfield) {
+    if (heightfield->heights != NULL) RL_FREE(heightfield->heights - heightfield->apron*heightfield->stride - heightfield->apron);
+    *heightfield = (Heightfield){ 0 };
+}
+
+bool GetHeightfieldHeight(const Heightfield *heightfield, float x, float z, float *height, Vector3 *normal) {
+    if (heightfield->heights == NULL) return false;
+
+    float gridX = (x - heightfield->origin.x)/heightfield->cellSizeX;
+    float gridZ = (z - heightfield->origin.z)/heightfield->cellSizeZ;
+    if ((gridX < 0.0f) || (gridZ < 0.0f) || (gridX > heightfield->samplesX - 1) || (gridZ > heightfield->samplesZ - 1)) return false;
+
+    int cellX = (int)gridX;
+    int cellZ = (int)gridZ;
+    if (cellX > heightfield->samplesX - 2) cellX = heightfield->samplesX - 2;
+    if (cellZ > heightfield->samplesZ - 2) cellZ = heightfield->samplesZ - 2;
+    float tx = gridX - cellX;
+    float tz = gridZ - cellZ;
+
+    const float *row0 = heightfield->heights + cellZ*heightfield->stride + cellX;
+    const float *row1 = row0 + heightfield->stride;
+    float h00 = row0[0], h10 = row0[1];
+    float h01 = row1[0], h11 = row1[1];
+
+    // Pick the triangle of the cell the point is in, the diagonal runs from (x+1,z) to (x,z+1)
+    float h, slopeX, slopeZ;
+    if (tx + tz <= 1.0f) {
+        h = h00 + tx*(h10 - h00) + tz*(h01 - h00);
+        slopeX = (h10 - h00)/heightfield->cellSizeX;
+        slopeZ = (h01 - h00)/heightfield->cellSizeZ;
+    } else {
+        h = h11 + (1.0f - tx)*(h01 - h11) + (1.0f - tz)*(h10 - h11);
+        slopeX = (h11 - h01)/heightfield->cellSizeX;
+        slopeZ = (h11 - h10)/heightfield->cellSizeZ;
+    }
+
+    if (height != NULL) *height = heightfield->origin.y + h;
+    if (normal != NULL) *normal = Vector3Normalize((Vector3){ -slopeX, 1.0f, -slopeZ });
+    return true;
+}
+
+// Slab test against the heightfield bounds, returns the ray parameter range inside them
+static bool ClipRayToHeightfield(Ray ray, const Heightfield *heightfield, float *tEnter, float *tExit) {
+    float boundsMin[3] = { heightfield->origin.x, heightfield->origin.y + heightfield->minHeight, heightfield->origin.z };
+    float boundsMax[3] = {
+        heightfield->origin.x + (heightfield->samplesX - 1)*heightfield->cellSizeX,
+        heightfield->origin.y + heightfield->maxHeight,
+        heightfield->origin.z + (heightfield->samplesZ - 1)*heightfield->cellSizeZ
+    };
+    float position[3] = { ray.position.x, ray.position.y, ray.position.z };
+    float direction[3] = { ray.direction.x, ray.direction.y, ray.direction.z };
+
+    float t0 = 0.0f, t1 = FLT_MAX;
+    for (int axis = 0; axis < 3; axis++) {
+        if (fabsf(direction[axis]) < EPSILON) {
+            if ((position[axis] < boundsMin[axis]) || (position[axis] > boundsMax[axis])) return false;
+            continue;
+        }
+        float inverse = 1.0f/direction[axis];
+        float tNear = (boundsMin[axis] - position[axis])*inverse;
+        float tFar = (boundsMax[axis] - position[axis])*inverse;
+        if (tNear > tFar) { float swap = tNear; tNear = tFar; tFar = swap; }
+        if (tNear > t0) t0 = tNear;
+        if (tFar < t1) t1 = tFar;
+        if (t0 > t1) return false;
+    }
+
+    *tEnter = t0;
+    *tExit = t1;
+    return true;
+}
+
+RayCollision GetRayCollisionHeightfield(Ray ray, const Heightfield *heightfield) {
+    RayCollision collision = { 0 };
+    if (heightfield->heights == NULL) return collision;
+
+    float tEnter, tExit;
+    if (!ClipRayToHeightfield(ray, heightfield, &tEnter, &tExit)) return collision;
+
+    // Walk the cells under the ray (2D DDA over x/z), starting where it enters the bounds
+    int lastCellX = heightfield->samplesX - 2;
+    int lastCellZ = heightfield->samplesZ - 2;
+    float gridX = (ray.position.x + ray.direction.x*tEnter - heightfield->origin.x)/heightfield->cellSizeX;
+    float gridZ = (ray.position.z + ray.direction.z*tEnter - heightfield->origin.z)/heightfield->cellSizeZ;
+    int cellX = (int)Clamp(floorf(gridX), 0.0f, (float)lastCellX);
+    int cellZ = (int)Clamp(floorf(gridZ), 0.0f, (float)lastCellZ);
+
+    int stepX = (ray.direction.x > 0.0f)? 1 : -1;
+    int stepZ = (ray.direction.z > 0.0f)? 1 : -1;
+    float tDeltaX = (fabsf(ray.direction.x) > EPSILON)? heightfield->cellSizeX/fabsf(ray.direction.x) : FLT_MAX;
+    float tDeltaZ = (fabsf(ray.direction.z) > EPSILON)? heightfield->cellSizeZ/fabsf(ray.direction.z) : FLT_MAX;
+    float tMaxX = FLT_MAX, tMaxZ = FLT_MAX;
+    if (tDeltaX < FLT_MAX) {
+        float boundary = heightfield->origin.x + (cellX + (stepX > 0))*heightfield->cellSizeX;
+        tMaxX = (boundary - ray.position.x)/ray.direction.x;
+    }
+    if (tDeltaZ < FLT_MAX) {
+        float boundary = heightfield->origin.z + (cellZ + (stepZ > 0))*heightfield->cellSizeZ;
+        tMaxZ = (boundary - ray.position.z)/ray.direction.z;
+    }
+
+    float tCell = tEnter;
+    while (tCell <= tExit) {
+        float tNext = fminf(fminf(tMaxX, tMaxZ), tExit);
+
+        const float *row0 = heightfield->heights + cellZ*heightfield->stride + cellX;
+        const float *row1 = row0 + heightfield->stride;
+        float cellTop = heightfield->origin.y + fmaxf(fmaxf(row0[0], row0[1]), fmaxf(row1[0], row1[1]));
+
+        // Skip the triangle tests while the ray stays above every sample of the cell
+        float yEnter = ray.position.y + ray.direction.y*tCell;
+        float yExit = ray.position.y + ray.direction.y*tNext;
+        if (fminf(yEnter, yExit) <= cellTop) {
+            float x0 = heightfield->origin.x + cellX*heightfield->cellSizeX;
+            float x1 = x0 + heightfield->cellSizeX;
+            float z0 = heightfield->origin.z + cellZ*heightfield->cellSizeZ;
+            float z1 = z0 + heightfield->cellSizeZ;
+            float y = heightfield->origin.y;
+            Vector3 v00 = { x0, y + row0[0], z0 }, v10 = { x1, y + row0[1], z0 };
+            Vector3 v01 = { x0, y + row1[0], z1 }, v11 = { x1, y + row1[1], z1 };
+
+            RayCollision hitA = GetRayCollisionTriangle(ray, v00, v01, v10);
+            RayCollision hitB = GetRayCollisionTriangle(ray, v10, v01, v11);
+            if (hitA.hit && (!hitB.hit || (hitA.distance <= hitB.distance))) return hitA;
+            if (hitB.hit) return hitB;
+        }
+
+        // Step into the next cell
+        if (tMaxX < tMaxZ) {
+            cellX += stepX;
+            if ((cellX < 0) || (cellX > lastCellX)) break;
+            tCell = tMaxX;
+            tMaxX += tDeltaX;
+        } else {
+            cellZ += stepZ;
+            if ((cellZ < 0) || (cellZ > lastCellZ) || (tMaxZ == FLT_MAX)) break;
+            tCell = tMaxZ;
+            tMaxZ += tDeltaZ;
+        }
+    }
+
+    return collision;
+}
+
+bool GetTerrainHeight(HeightfieldLookup lookup, void *userData, float chunkSize, float x, float z, float *height, Vector3 *normal) {
+    const Heightfield *heightfield = lookup((int)floorf(x/chunkSize), (int)floorf(z/chunkSize), userData);
+    if (heightfield == NULL) return false;
+    return GetHeightfieldHeight(heightfield, x, z, height, normal);
+}
+
+RayCollision GetRayCollisionTerrain(Ray ray, float maxDistance, HeightfieldLookup lookup, void *userData, float chunkSize) {
+    RayCollision collision = { 0 };
+
+    // Walk the chunks under the ray in order, the first chunk with a hit holds the nearest one
+    int chunkX = (int)floorf(ray.position.x/chunkSize);
+    int chunkZ = (int)floorf(ray.position.z/chunkSize);
+    int stepX = (ray.direction.x > 0.0f)? 1 : -1;
+    int stepZ = (ray.direction.z > 0.0f)? 1 : -1;
+    float tDeltaX = (fabsf(ray.direction.x) > EPSILON)? chunkSize/fabsf(ray.direction.x) : FLT_MAX;
+    float tDeltaZ = (fabsf(ray.direction.z) > EPSILON)? chunkSize/fabsf(ray.direction.z) : FLT_MAX;
+    float tMaxX = (tDeltaX < FLT_MAX)? ((chunkX + (stepX > 0))*chunkSize - ray.position.x)/ray.direction.x : FLT_MAX;
+    float tMaxZ = (tDeltaZ < FLT_MAX)? ((chunkZ + (stepZ > 0))*chunkSize - ray.position.z)/ray.direction.z : FLT_MAX;
+
+    float tChunk = 0.0f;
+    while (tChunk <= maxDistance) {
+        const Heightfield *heightfield = lookup(chunkX, chunkZ, userData);
+        if (heightfield != NULL) {
+            collision = GetRayCollisionHeightfield(ray, heightfield);
+            if (collision.hit) {
+                if (collision.distance > maxDistance) collision = (RayCollision){ 0 };
+                return collision;
+            }
+        }
+
+        if ((tMaxX == FLT_MAX) && (tMaxZ == FLT_MAX)) break;    // Vertical ray, only one chunk to test
+        if (tMaxX < tMaxZ) {
+            chunkX += stepX;
+            tChunk = tMaxX;
+            tMaxX += tDeltaX;
+        } else {
+            chunkZ += stepZ;
+            tChunk = tMaxZ;
+            tMaxZ += tDeltaZ;
+        }
+    }
+
+    return collision;
+}
@@ -0,0 +1,54 @@
+/*******************************************************************************************
+*
+*   heightfield - Ground queries against a regular grid of height samples
+*
+*   Every chunk keeps its height samples next to its mesh. Looking up the ground under a point
+*   only needs the four samples around it, so it costs the same whatever the chunk resolution,
+*   and ray casts walk the grid cells the ray crosses instead of testing every triangle.
+*
+*   Each grid cell is split into the same two triangles GenHeightfieldMesh() builds, (x,z) (x,z+1)
+*   (x+1,z) and (x+1,z) (x,z+1) (x+1,z+1), so query results match the full detail ground exactly.
+*
+*   A heightfield may carry an apron: rings of samples from the neighbouring chunks around its
+*   own, stored in the same rows. Queries never look at them, they are there so normals along
+*   the border come out the same on both sides of a seam (see GetHeightfieldSampleNormal()).
+*
+*   The functions only read the heightfield, so they can be called from any thread as long as
+*   the heightfield is not unloaded at the same time.
+*
+********************************************************************************************/
+
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include "raylib.h"
+
+typedef struct Heightfield {
+    int samplesX;           // Samples along x
+    int samplesZ;           // Samples along z
+    int stride;             // Floats between the start of two rows
+    float *heights;         // heights[z*stride + x], world units
+    int apron;              // Neighbour samples around the heightfield, heights[z*stride + x] is valid from -apron to samples - 1 + apron
+    Vector3 origin;         // World position of sample (0, 0) at height 0
+    float cellSizeX;        // World distance between samples along x
+    float cellSizeZ;        // World distance between samples along z
+    float minHeight;        // Lowest sample
+    float maxHeight;        // Highest sample
+} Heightfield;
+
+// Find the heightfield for a chunk, NULL if there is none. Used by the world queries to step
+// from chunk to chunk.
+typedef const Heightfield *(*HeightfieldLookup)(int chunkX, int chunkZ, void *userData);
+
+Heightfield LoadHeightfieldFromImage(Image heightMap, Vector3 origin, Vector3 size);     // Same scaling as GenMeshHeightmap()
+Heightfield LoadHeightfieldFromImageEx(Image heightMap, Rectangle area, int apron, Vector3 origin, Vector3 size);  // Heightfield over area of the image, with an apron from the pixels around it (edge pixels repeat past the image)
+void UnloadHeightfield(Heightfield *heightfield);
+bool GetHeightfieldHeight(const Heightfield *heightfield, float x, float z, float *height, Vector3 *normal);  // Ground under (x, z), false outside the heightfield
+RayCollision GetRayCollisionHeightfield(Ray ray, const Heightfield *heightfield);       // Nearest hit between the ray and the ground
+
+// World queries over a grid of chunkSize x chunkSize heightfields, seams between chunks are
+// handled by sampling whichever chunk contains the point
+bool GetTerrainHeight(HeightfieldLookup lookup, void *userData, float chunkSize, float x, float z, float *height, Vector3 *normal);
+RayCollision GetRayCollisionTerrain(Ray ray, float maxDistance, HeightfieldLookup lookup, void *userData, float chunkSize);
+
+#endif // HEIGHTFIELD_H
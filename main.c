@@ -24,174 +24,20 @@
 #include "rcamera.h"
 #include "rlgl.h"
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-#define MAP_SIZE 1024.0f
-#define CHUNK_SIZE 128.0f
-#define CHUNK_TEX_SCALE 4.0f
+#include "bench.h"
+#include "chunkstream.h"
+#include "dynres.h"
+#include "profiler.h"
+#include "sky.h"
+#include "terraingen.h"
 
-#ifndef M_PI
-#define M_PI (3.14159265358979323846)
-#endif
-
-
-bool IsOnMesh(Vector3 position, float height, Mesh * mesh, Matrix transform) {
-    Ray ray = (Ray){position, (Vector3){0, -1, 0}};
-    RayCollision rayCollision = GetRayCollisionMesh(ray, *mesh, transform);
-    if (((rayCollision.distance - height) <= EPSILON) && ((rayCollision.distance - height) >= -EPSILON)) return true;
-    // if (((rayCollision.distance - height) <= EPSILON) && rayCollision.hit) return true;
-    return false;
-}
-
-typedef struct IVector2 {
-    int x;                // Vector x component
-    int y;                // Vector y component
-} IVector2;
-
-//Make chunks
-typedef struct Chunk {
-    IVector2 chunkID;                // Chunk ID, indicates its location in the world
-    Model* models;
-    Vector3* modelLocs;
-    int numModels;
-} Chunk;
-
-IVector2 GetPosChunk(Vector3 position) {
-    return (IVector2){(int)floor(position.x/CHUNK_SIZE), (int)floor(position.z/CHUNK_SIZE)};
-}
-
-void LoadChunk(Chunk* chunk, IVector2 chunkID) { // Loads the chunk data for chunkID into chunk
-    // for now all we will have in the chunk is the section of the height map within that chunk
-    chunk->chunkID = chunkID;
-
-    char filename[] = "C:/Users/Matt/Desktop/Hardware-Stuff/Noise Textures/heightmap1024.png";
-    Image heightMapImage = LoadImage(filename);
-    Rectangle chunkMapRec = {
-        .x = chunkID.x * CHUNK_SIZE + MAP_SIZE / 2,
-        .y = chunkID.y * CHUNK_SIZE + MAP_SIZE / 2,
-        .width = CHUNK_SIZE + 1,
-        .height = CHUNK_SIZE + 1,
-    };
-    if (chunkMapRec.x + chunkMapRec.width  > MAP_SIZE) chunkMapRec.width = CHUNK_SIZE;
-    if (chunkMapRec.y + chunkMapRec.height > MAP_SIZE) chunkMapRec.height = CHUNK_SIZE;
-    ImageCrop(&heightMapImage, chunkMapRec);
-    Mesh heightMapMesh = GenMeshHeightmap(heightMapImage, (Vector3){CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE});
-    
-    char texfilename[] = "C:/Users/Matt/Desktop/Hardware-Stuff/Noise Textures/heightmaptexture4096.png";
-    Rectangle chunkMapTexRec = {
-        .x = (chunkID.x * CHUNK_SIZE + MAP_SIZE/2) * CHUNK_TEX_SCALE,
-        .y = (chunkID.y * CHUNK_SIZE + MAP_SIZE/2) * CHUNK_TEX_SCALE,
-        .width = CHUNK_SIZE * CHUNK_TEX_SCALE,
-        .height = CHUNK_SIZE * CHUNK_TEX_SCALE,
-    };
-    
-    Image heightMapTexImage = LoadImage(texfilename);
-    ImageCrop(&heightMapTexImage, chunkMapTexRec);
-    chunk->numModels = 1;
-    chunk->modelLocs = (Vector3*)malloc(sizeof(Vector3) * chunk->numModels);
-    chunk->modelLocs[0] = (Vector3){chunkID.x * CHUNK_SIZE, 0 , chunkID.y * CHUNK_SIZE}; // give chunk origin coordinate to ground mesh origin
-
-    chunk->models = (Model*)malloc(sizeof(Model) * chunk->numModels);
-    chunk->models[0] = LoadModelFromMesh(heightMapMesh);
-    chunk->models[0].materials[0].maps[MATERIAL_MAP_DIFFUSE].texture = LoadTextureFromImage(heightMapTexImage);
-    UnloadImage(heightMapImage);
-    UnloadImage(heightMapTexImage);
-    // UnloadMesh(heightMapMesh);
-}
-
-void DrawChunk(Chunk chunk, int lodLevel) {
-    // For now the first model will always be the ground, draw that in relation to the chunk origin
-    DrawModel(chunk.models[0], chunk.modelLocs[0], 1.0f, WHITE);
-}
-
-
-Mesh skyMesh;
-Model skyModel;
-Shader skyShader;
-
-void makeSky() {
-	skyMesh = GenMeshSphere(45000, 32, 15);
-	skyModel = LoadModelFromMesh(skyMesh);
-	skyShader = LoadShader("shaders/sky.vs", "shaders/sky.fs");
-
-    float turbidityVal = 4.7; // 4.75;
-    float rayleighVal = 2.28; // 6.77;
-    float mieCoefficientVal = 0.003; //0.005; // 0.0191;
-    float mieDirectionalGVal = 0.82; // 0.793;
-    float luminanceVal = 1.00; // 1.1735;
-    float inclinationVal = 0.3; //0.4983; // 0.4956;
-    float azimuthVal = 0.1979; // 0.2174;
-    float refractiveIndexVal = 1.00029; // 1.000633;
-    float numMoleculesVal = 2.542e25;
-    float depolarizationFactorVal = 0.02; // 0.01;
-    float rayleighZenithLengthVal = 8400; // 1425;
-    float mieVVal = 3.936; // 4.042;
-    float mieZenithLengthVal = 34000; // 1600;
-    float sunIntensityFactorVal = 1000; // 2069;
-    float sunIntensityFalloffSteepnessVal = 1.5; // 2.26;
-    float sunAngularDiameterDegreesVal = 0.00933; // 0.01487;
-    float tonemapWeightingVal = 9.50;
-    Vector3 primariesVal = { 6.8e-7, 5.5e-7, 4.5e-7 }; // { 7.929e-7, 3.766e-7, 3.172e-7 };
-    Vector3 mieKCoefficientVal = { 0.686, 0.678, 0.666 }; // { 0.686, 0.678, 0.666 };
-    Vector3 cameraPosVal = { 1000, -400, 0 };
-    Vector3 sunPositionVal;
-
-    float theta = M_PI * (inclinationVal - 0.5);
-    float phi = 2 * M_PI * (azimuthVal - 0.5);
-
-    float distance = 4000;
-    sunPositionVal.x = distance * cos(phi);
-    sunPositionVal.y = distance * sin(phi) * sin(theta);
-    sunPositionVal.z = distance * sin(phi) * cos(theta);
-
-    int turbidityLoc                    = GetShaderLocation(skyShader, "turbidity");
-    int rayleighLoc                     = GetShaderLocation(skyShader, "rayleigh");
-    int mieCoefficientLoc               = GetShaderLocation(skyShader, "mieCoefficient");
-    int mieDirectionalGLoc              = GetShaderLocation(skyShader, "mieDirectionalG");
-    int luminanceLoc                    = GetShaderLocation(skyShader, "luminance");
-    int inclinationLoc                  = GetShaderLocation(skyShader, "inclination");
-    int azimuthLoc                      = GetShaderLocation(skyShader, "azimuth");
-    int refractiveIndexLoc              = GetShaderLocation(skyShader, "refractiveIndex");
-    int numMoleculesLoc                 = GetShaderLocation(skyShader, "numMolecules");
-    int depolarizationFactorLoc         = GetShaderLocation(skyShader, "depolarizationFactor");
-    int rayleighZenithLengthLoc         = GetShaderLocation(skyShader, "rayleighZenithLength");
-    int mieVLoc                         = GetShaderLocation(skyShader, "mieV");
-    int mieZenithLengthLoc              = GetShaderLocation(skyShader, "mieZenithLength");
-    int sunIntensityFactorLoc           = GetShaderLocation(skyShader, "sunIntensityFactor");
-    int sunIntensityFalloffSteepnessLoc = GetShaderLocation(skyShader, "sunIntensityFalloffSteepness");
-    int sunAngularDiameterDegreesLoc    = GetShaderLocation(skyShader, "sunAngularDiameterDegrees");
-    int tonemapWeightingLoc             = GetShaderLocation(skyShader, "tonemapWeighting");
-    int primariesLoc                    = GetShaderLocation(skyShader, "primaries");
-    int mieKCoefficientLoc              = GetShaderLocation(skyShader, "mieKCoefficient");
-    int cameraPosLoc                    = GetShaderLocation(skyShader, "cameraPos");
-    int sunPositionLoc                  = GetShaderLocation(skyShader, "sunPosition");
-
-    SetShaderValue(skyShader, turbidityLoc,                    &turbidityVal,                    SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, rayleighLoc,                     &rayleighVal,                     SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, mieCoefficientLoc,               &mieCoefficientVal,               SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, mieDirectionalGLoc,              &mieDirectionalGVal,              SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, luminanceLoc,                    &luminanceVal,                    SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, inclinationLoc,                  &inclinationVal,                  SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, azimuthLoc,                      &azimuthVal,                      SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, refractiveIndexLoc,              &refractiveIndexVal,              SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, numMoleculesLoc,                 &numMoleculesVal,                 SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, depolarizationFactorLoc,         &depolarizationFactorVal,         SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, rayleighZenithLengthLoc,         &rayleighZenithLengthVal,         SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, mieVLoc,                         &mieVVal,                         SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, mieZenithLengthLoc,              &mieZenithLengthVal,              SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, sunIntensityFactorLoc,           &sunIntensityFactorVal,           SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, sunIntensityFalloffSteepnessLoc, &sunIntensityFalloffSteepnessVal, SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, sunAngularDiameterDegreesLoc,    &sunAngularDiameterDegreesVal,    SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, tonemapWeightingLoc,             &tonemapWeightingVal,             SHADER_UNIFORM_FLOAT);
-    SetShaderValue(skyShader, primariesLoc,                    &primariesVal,                    SHADER_UNIFORM_VEC3);
-    SetShaderValue(skyShader, mieKCoefficientLoc,              &mieKCoefficientVal,              SHADER_UNIFORM_VEC3);
-    SetShaderValue(skyShader, cameraPosLoc,                    &cameraPosVal,                    SHADER_UNIFORM_VEC3);
-    SetShaderValue(skyShader, sunPositionLoc,                  &sunPositionVal,                  SHADER_UNIFORM_VEC3);
-
-
-	skyModel.materials[0].shader = skyShader;
-}
+#define HEIGHTMAP_FILE "C:/Users/Matt/Desktop/Hardware-Stuff/Noise Textures/heightmap1024.png"
+#define HEIGHTMAP_TEXTURE_FILE "C:/Users/Matt/Desktop/Hardware-Stuff/Noise Textures/heightmaptexture4096.png"
 
 //----------------------------------------------------------------------------------
 // Local Variables Definition (local to this module)
@@ -199,30 +45,83 @@ void makeSky() {
 Camera camera = { 0 };
 Vector3 cubePosition = { 0 };
 
-void moveSun(float az, float el, float* azimuthVal, float* inclinationVal) {
-    int azimuthLoc = GetShaderLocation(skyShader, "azimuth");
-    *azimuthVal += az;
-    SetShaderValue(skyShader, azimuthLoc, &azimuthVal, SHADER_UNIFORM_FLOAT);
-
-    int inclinationLoc = GetShaderLocation(skyShader, "inclination");
-    *inclinationVal += el;
-    SetShaderValue(skyShader, inclinationLoc, &inclinationVal, SHADER_UNIFORM_FLOAT);
+void moveSun(SkyCache *sky, float az, float el) {
+    SkyParams params = sky->params;
+    params.azimuth += az;
+    params.inclination += el;
+    SetSkyParams(sky, params);      // The cubemap is rebuilt by the next UpdateSkyCache()
 }
 
 //----------------------------------------------------------------------------------
 // Main entry point
 //----------------------------------------------------------------------------------
-int main()
+int main(int argc, char *argv[])
 {
     // Initialization
     //--------------------------------------------------------------------------------------
-    const int screenWidth = 2560;
-    const int screenHeight = 1440;
+    int screenWidth = 2560;
+    int screenHeight = 1440;
 
     const float playerHeight = 2.0f;
+    const float playerRadius = 0.4f;
+
+    bool streamChunks = true;           // Load chunks on worker threads while the game runs
+    bool benchMode = false;             // Fly a camera path with a fixed timestep and record frame times
+    int benchFrames = BENCH_FRAMES;
+    const char *benchPathFile = NULL;   // Camera path to fly, a generated one when NULL
+    const char *benchOutput = "bench";
+    const char *recordPathFile = NULL;  // Save the camera of every frame, to be flown by --bench-path
+    const char *heightMapFile = HEIGHTMAP_FILE;
+    const char *heightMapTextureFile = HEIGHTMAP_TEXTURE_FILE;
+    const char *archiveFile = CHUNK_ARCHIVE_FILE;   // Baked chunks, the source images are only used when it is missing
+    bool instancedTerrain = true;       // Draw the ground with shared grids and height atlases, "--render meshes" for a mesh per chunk
+    bool dynamicResolution = true;      // Lower the scene resolution when frames take longer than the target
+    float targetFps = DYNRES_TARGET_FPS;
+    bool procedural = false;            // Generate an unbounded world instead of using the source images
+    unsigned int seed = 1;
+    const char *profileFile = NULL;     // Save a trace of the last frames on exit, needs a PROFILER=1 build
+    int profileFrames = PROFILER_HISTORY;
+    size_t textureBudget = CHUNK_TEXTURE_BUDGET;    // Video memory for the chunk ground textures
+    size_t cacheBudget = CHUNK_CACHE_BUDGET;        // Memory for the loaded chunks, the ones furthest behind are evicted past it
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-stream") == 0) streamChunks = false;  // Load every chunk up front on the main thread
+        else if (strcmp(argv[i], "--bench") == 0) benchMode = true;
+        else if ((strcmp(argv[i], "--bench-frames") == 0) && (i + 1 < argc)) benchFrames = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--bench-path") == 0) && (i + 1 < argc)) benchPathFile = argv[++i];
+        else if ((strcmp(argv[i], "--bench-out") == 0) && (i + 1 < argc)) benchOutput = argv[++i];
+        else if ((strcmp(argv[i], "--record-path") == 0) && (i + 1 < argc)) recordPathFile = argv[++i];
+        else if ((strcmp(argv[i], "--heightmap") == 0) && (i + 1 < argc)) heightMapFile = argv[++i];
+        else if ((strcmp(argv[i], "--texture") == 0) && (i + 1 < argc)) heightMapTextureFile = argv[++i];
+        else if ((strcmp(argv[i], "--archive") == 0) && (i + 1 < argc)) archiveFile = argv[++i];
+        else if (strcmp(argv[i], "--no-archive") == 0) archiveFile = NULL;
+        else if ((strcmp(argv[i], "--render") == 0) && (i + 1 < argc)) instancedTerrain = (strcmp(argv[++i], "meshes") != 0);
+        else if (strcmp(argv[i], "--no-dynres") == 0) dynamicResolution = false;
+        else if ((strcmp(argv[i], "--target-fps") == 0) && (i + 1 < argc)) targetFps = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--procedural") == 0) procedural = true;
+        else if ((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        else if ((strcmp(argv[i], "--profile") == 0) && (i + 1 < argc)) profileFile = argv[++i];
+        else if ((strcmp(argv[i], "--profile-frames") == 0) && (i + 1 < argc)) profileFrames = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "--texture-budget") == 0) && (i + 1 < argc)) textureBudget = (size_t)(atof(argv[++i])*1024*1024);
+        else if ((strcmp(argv[i], "--cache-budget") == 0) && (i + 1 < argc)) cacheBudget = (size_t)(atof(argv[++i])*1024*1024);
+    }
+    if (benchFrames < 1) benchFrames = 1;
+    if (targetFps <= 0.0f) targetFps = DYNRES_TARGET_FPS;
+
+    if (benchMode) {
+        // Same size on every machine and no window to grab input or focus
+        screenWidth = 1280;
+        screenHeight = 720;
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        dynamicResolution = false;      // Every run draws the same pixels
+    }
 
     InitWindow(screenWidth, screenHeight, "bad game made by a bad gamer");
-    ToggleFullscreen();
+    PROFILE_THREAD("main");
+#if !defined(ENABLE_PROFILER)
+    if (profileFile != NULL) TraceLog(LOG_WARNING, "PROFILER: Built without the profiler, build with PROFILER=1 to trace %i frames", profileFrames);
+#endif
+    bool showProfiler = false;          // F3 toggles the profiler overlay, F4 saves a trace
+    if (!benchMode) ToggleFullscreen();
 
     //----------------------------------------------------------------------------------
     // Initialize Shaders
@@ -231,13 +130,9 @@ int main()
     // Shader shaderFirst = LoadShader("shaders/first.vs", "shaders/first.fs");
     // Shader shaderBlur = LoadShader(0, "shaders/blur.fs");
 
-    makeSky();
-    float inclinationVal = 0.4983; // 0.4956;
-    float azimuthVal = 0.1979; // 0.2174;
-
+    SkyCache sky;
+    LoadSkyCache(&sky, GetDefaultSkyParams());
 
-    // Default Shader for final render to screen
-    Shader defaultShader = LoadShader(0, 0);
     //----------------------------------------------------------------------------------
     // End Shaders
     //----------------------------------------------------------------------------------
@@ -257,18 +152,53 @@ int main()
     int cameraMode = CAMERA_FIRST_PERSON;
     // int cameraMode = CAMERA_FREE;
 
-    // Load chunks
-    Chunk chunks[64];
-    for (int chunkx = -4; chunkx < 4; chunkx += 1) {
-        for (int chunky = -4; chunky < 4; chunky += 1) {
-            LoadChunk(&chunks[(chunkx+4) * 8 + (chunky+4)], (IVector2){chunkx, chunky});
-        }
+    // Chunks around the camera are streamed in by worker threads, straight from the baked
+    // archive when there is one. Otherwise they are built from the source images, which are
+    // decoded once and shared by every chunk. Without either the world is generated.
+    ChunkArchive chunkArchive;
+    bool archived = !procedural && (archiveFile != NULL) && OpenChunkArchive(&chunkArchive, archiveFile);
+    if (!archived && !procedural && !FileExists(heightMapFile)) {
+        TraceLog(LOG_INFO, "CHUNK: No chunk archive and no heightmap, generating the world with seed %u", seed);
+        procedural = true;
+    }
+    TileCache tileCache;
+    InitTileCache(&tileCache, heightMapFile, heightMapTextureFile);
+    TerrainGenerator generator = GetTerrainGenerator(seed, CHUNK_SIZE);
+    ChunkSource chunkSource = { &tileCache, procedural? &generator : NULL };
+    TerrainRenderer terrainRenderer;
+    if (instancedTerrain) LoadTerrainRenderer(&terrainRenderer, CHUNK_STREAM_WINDOW);
+    ChunkStream chunkStream;
+    InitChunkStream(&chunkStream, chunkSource, archived? &chunkArchive : NULL, instancedTerrain? &terrainRenderer : NULL, streamChunks? GetDefaultWorkerCount() : 0);
+    chunkStream.textureBudget = textureBudget;
+    chunkStream.cache.budget = cacheBudget;
+
+    CameraPath benchPath = { 0 };
+    CameraPath recordPath = { 0 };
+    BenchRecorder bench = { 0 };
+    if (benchMode) {
+        benchPath = (benchPathFile != NULL)? LoadCameraPath(benchPathFile) : GenCameraPath(benchFrames, BENCH_TIMESTEP);
+        if (benchPath.count == 0) benchPath = GenCameraPath(benchFrames, BENCH_TIMESTEP);
+        GetCameraPathFrame(benchPath, 0, &camera);
+        InitBenchRecorder(&bench, benchFrames);
+    }
+
+    // Benchmarks always start from a full ring so the first frames do not depend on how
+    // quickly the workers get going
+    if (!streamChunks || benchMode) {
+        double chunkLoadStart = GetTime();
+        FillChunkStream(&chunkStream, camera);
+        UpdateStreamTextures(&chunkStream, camera, screenHeight, SIZE_MAX);     // Every texture at its level straight away
+        double chunkLoadTime = GetTime() - chunkLoadStart;
+        bench.loadTime = chunkLoadTime;
+        TraceLog(LOG_INFO, "CHUNK: Loaded %d chunks in %.3f s (%.3f s decoding source images)", chunkStream.uploadCount, chunkLoadTime, tileCache.heightMap.decodeTime + tileCache.texture.decodeTime);
     }
 
-    DisableCursor();                    // Limit cursor to relative movement inside the window
+    if (!benchMode) DisableCursor();    // Limit cursor to relative movement inside the window
 
-    // Create a RenderTexture2D to be used for render to texture
-    RenderTexture2D target = LoadRenderTexture(screenWidth, screenHeight);
+    // The scene is drawn to an offscreen target whose size follows the frame time, the HUD is
+    // drawn over it at native resolution
+    DynamicResolution resolution;
+    LoadDynamicResolution(&resolution, screenWidth, screenHeight, targetFps, dynamicResolution);
 
     //--------------------------------------------------------------------------------------
     // SetTargetFPS(144);               // Set our game to run at 144 frames-per-second
@@ -277,6 +207,12 @@ int main()
     // Main game loop
     while (!WindowShouldClose())    // Detect window close button or ESC key
     {
+        if (benchMode && IsBenchFinished(&bench)) break;
+        BeginBenchFrame(&bench);
+        BeginDynamicResolutionFrame(&resolution);
+
+        // Benchmarks advance by a fixed timestep so every run covers the same path
+        float frameTime = benchMode? BENCH_TIMESTEP : GetFrameTime();
 
         if (IsKeyPressed(KEY_ONE)) {
             cameraMode = CAMERA_FIRST_PERSON;
@@ -288,9 +224,22 @@ int main()
             camera.up = (Vector3){ 0.0f, 1.0f, 0.0f }; // Reset roll
         }
 
+        //----------------------------------------------------------------------------------
+        // Stream chunks around the camera
+        //----------------------------------------------------------------------------------
+        MarkBenchPhase(&bench, BENCH_PHASE_CHUNKS);
+        PROFILE_BEGIN("UpdateChunkStream");
+        UpdateChunkStream(&chunkStream, camera, CHUNK_UPLOAD_BUDGET);
+        PROFILE_END();
+        PROFILE_BEGIN("UpdateStreamTextures");
+        UpdateStreamTextures(&chunkStream, camera, screenHeight, CHUNK_TEXTURE_UPLOAD_BYTES);
+        PROFILE_END();
+        MarkBenchPhase(&bench, BENCH_PHASE_UPDATE);
+
         //----------------------------------------------------------------------------------
         // Update Camera
         //----------------------------------------------------------------------------------
+        PROFILE_BEGIN("camera");
         
         // Sprint
         if (IsKeyDown(KEY_LEFT_SHIFT)) {
@@ -311,70 +260,85 @@ int main()
         moveVec.z = (cameraMode == CAMERA_FREE) * (IsKeyDown(KEY_SPACE) - IsKeyDown(KEY_LEFT_ALT)) * CAMERA_MOVE_SPEED;
 
         // Scale moveVec by deltaTime to get a consistent speed
-        moveVec = Vector3Scale(moveVec,GetFrameTime());
+        moveVec = Vector3Scale(moveVec,frameTime);
 
-        // Check collision with ground -- THIS NEEDS UPDATE TO INCLUDE MOVEVEC
+        // Move the camera, collisions are resolved from where it was after the bounds check
         updateCamera = camera;
-        UpdateCameraPro(&camera,
-                        moveVec,
-                        (Vector3){  mousePositionDelta.x * CAMERA_MOUSE_MOVE_SENSITIVITY,
-                                    mousePositionDelta.y * CAMERA_MOUSE_MOVE_SENSITIVITY,
-                                    0.0},
-                        0.0);
-
-        // Bounds checking
-        if (camera.position.x >  MAP_SIZE/2) {
-            camera.position.x = updateCamera.position.x;
-            camera.target.x = updateCamera.target.x;
-        }
-        if (camera.position.z >  MAP_SIZE/2) {
-            camera.position.z = updateCamera.position.z;
-            camera.target.z = updateCamera.target.z;
-        }
-        if (camera.position.x < -MAP_SIZE/2) {
-            camera.position.x = updateCamera.position.x;
-            camera.target.x = updateCamera.target.x;
-        }
-        if (camera.position.z < -MAP_SIZE/2) {
-            camera.position.z = updateCamera.position.z;
-            camera.target.z = updateCamera.target.z;
+        if (benchMode) GetCameraPathFrame(benchPath, bench.frame, &camera);
+        else {
+            UpdateCameraPro(&camera,
+                            moveVec,
+                            (Vector3){  mousePositionDelta.x * CAMERA_MOUSE_MOVE_SENSITIVITY,
+                                        mousePositionDelta.y * CAMERA_MOUSE_MOVE_SENSITIVITY,
+                                        0.0},
+                            0.0);
         }
 
-        IVector2 moveChunk = GetPosChunk(camera.position);
-        int chunkIdx = (moveChunk.x+4) * 8 + (moveChunk.y+4);
-        if ((cameraMode != CAMERA_FREE) && !IsOnMesh(camera.position, playerHeight, &chunks[chunkIdx].models->meshes[0], MatrixTranslate(chunks[chunkIdx].modelLocs[0].x, chunks[chunkIdx].modelLocs[0].y, chunks[chunkIdx].modelLocs[0].z))) {
-            // Move a player to their height above the mesh
-            Ray ray = (Ray){Vector3Add(camera.position, (Vector3){0,1000000,0}), (Vector3){0.0, -1.0, 0.0}};
-            RayCollision rayCollision = GetRayCollisionMesh(ray, 
-                                                            chunks[chunkIdx].models->meshes[0], 
-                                                            MatrixTranslate(chunks[chunkIdx].modelLocs[0].x, chunks[chunkIdx].modelLocs[0].y, chunks[chunkIdx].modelLocs[0].z));
-            if (rayCollision.hit == true) {
-                camera.position.y = rayCollision.point.y + playerHeight;
-                camera.target.y += 1000000 - rayCollision.distance + playerHeight;
+        // Bounds checking, generated worlds have no edge
+        if (!procedural) {
+            if (camera.position.x >  MAP_SIZE/2) {
+                camera.position.x = updateCamera.position.x;
+                camera.target.x = updateCamera.target.x;
+            }
+            if (camera.position.z >  MAP_SIZE/2) {
+                camera.position.z = updateCamera.position.z;
+                camera.target.z = updateCamera.target.z;
+            }
+            if (camera.position.x < -MAP_SIZE/2) {
+                camera.position.x = updateCamera.position.x;
+                camera.target.x = updateCamera.target.x;
+            }
+            if (camera.position.z < -MAP_SIZE/2) {
+                camera.position.z = updateCamera.position.z;
+                camera.target.z = updateCamera.target.z;
             }
         }
 
+        // Walk the player's capsule along the camera's move: it follows the ground and slides
+        // along props. Bench runs sweep it too so the collision cost is in their frame times,
+        // but keep their path deterministic by placing it straight onto the ground.
+        float groundHeight;
+        if ((cameraMode != CAMERA_FREE) && GetTerrainHeight(GetStreamHeightfield, &chunkStream, CHUNK_SIZE, camera.position.x, camera.position.z, &groundHeight, NULL)) {
+            Vector3 offset = { 0.0f, groundHeight + playerHeight - camera.position.y, 0.0f };
+            Vector3 base = { updateCamera.position.x, updateCamera.position.y - playerHeight, updateCamera.position.z };
+            Vector3 move = Vector3Subtract(camera.position, updateCamera.position);
+            move.y = groundHeight - base.y;     // There is no falling, the player keeps to the ground unless a prop holds them up
+            CollisionWorld world = { GetStreamHeightfield, GetStreamCollisionGrid, &chunkStream, CHUNK_SIZE };
+            CapsuleMove walk = MoveCapsule(&world, (Capsule){ base, playerHeight, playerRadius }, move);
+            if (!benchMode) offset = Vector3Subtract((Vector3){ walk.base.x, walk.base.y + playerHeight, walk.base.z }, camera.position);
+            camera.position = Vector3Add(camera.position, offset);
+            camera.target = Vector3Add(camera.target, offset);
+        }
+        if (recordPathFile != NULL) AppendCameraPath(&recordPath, camera);
+        PROFILE_END();
+
+        if (IsKeyPressed(KEY_F3)) showProfiler = !showProfiler;
+        if (IsKeyPressed(KEY_F4)) PROFILE_SAVE_TRACE((profileFile != NULL)? profileFile : "profile.json", profileFrames);
+
         // Sun shader controls
 
         if (IsKeyPressed(KEY_KP_8)) {
-            moveSun(0.01,0,&azimuthVal,&inclinationVal);
+            moveSun(&sky, 0.01, 0);
         }
 
         if (IsKeyPressed(KEY_KP_2)) {
-            moveSun(-0.01,0,&azimuthVal,&inclinationVal);
+            moveSun(&sky, -0.01, 0);
         }
 
         if (IsKeyPressed(KEY_KP_4)) {
-            moveSun(0,-0.01,&azimuthVal,&inclinationVal);
+            moveSun(&sky, 0, -0.01);
         }
         
         if (IsKeyPressed(KEY_KP_6)) {
-            moveSun(0,0.01,&azimuthVal,&inclinationVal);
+            moveSun(&sky, 0, 0.01);
         }
+        if (UpdateSkyCache(&sky) && instancedTerrain) SetTerrainSunDirection(&terrainRenderer, GetSkySunPosition(sky.params));
 
         //----------------------------------------------------------------------------------
         // Draw
         //----------------------------------------------------------------------------------
+        MarkBenchPhase(&bench, BENCH_PHASE_DRAW);
+        RenderTexture2D target = GetDynamicResolutionTarget(&resolution);
         BeginTextureMode(target);       // Enable drawing to texture
 
             ClearBackground(RAYWHITE);
@@ -384,31 +348,21 @@ int main()
                 // DrawModel(heightMap, heightMapPos, 1.0f, WHITE);
                 // DrawMesh(heightMapMeshLow, LoadMaterialDefault(), heightMapTransform);
 
-                for (int chunkx = -4; chunkx < 4; chunkx += 1) {
-                    for (int chunky = -4; chunky < 4; chunky += 1) {
-                        DrawModel(chunks[(chunkx+4) * 8 + (chunky+4)].models[0], chunks[(chunkx+4) * 8 + (chunky+4)].modelLocs[0], 1.0f, WHITE);
-                        // //Draw chunk origin
-                        // Ray ray = {
-                        //     .position = (Vector3){chunkx * CHUNK_SIZE, 0.0, chunky * CHUNK_SIZE},
-                        //     .direction = (Vector3){0.0, 1.0, 0.0},
-                        // };
-                        // DrawRay(ray, RED);
-                    }
-                }
+                PROFILE_BEGIN("DrawChunkStream");
+                ChunkDrawStats drawStats = DrawChunkStream(&chunkStream, camera, (float)screenWidth/screenHeight, screenHeight);
+                PROFILE_END();
+                PROFILE_COUNT(PROFILE_DRAW_CALLS, drawStats.drawCalls);
+                PROFILE_COUNT(PROFILE_TRIANGLES, drawStats.drawnTriangles);
                 DrawCube(cubePosition, 2.0f, 2.0f, 2.0f, RED);
                 DrawCubeWires(cubePosition, 2.0f, 2.0f, 2.0f, MAROON);
                 DrawGrid(10, 1.0f);
 
-                rlDisableBackfaceCulling();
-                    DrawModel(skyModel, (Vector3){0.0, 0.0, 0.0}, 1, WHITE);
-                rlEnableBackfaceCulling();
+                PROFILE_BEGIN("DrawSky");
+                DrawSky(&sky);
+                PROFILE_END();
 
             EndMode3D();
 
-            char posText[40];
-            sprintf(posText, "%f %f %f", camera.position.x, camera.position.y, camera.position.z);
-            DrawText(posText, 20, 40, 20, BLACK);
-
             // BeginShaderMode(shaderFirst);
             //     DrawTextureRec(target.texture, (Rectangle){ 0, 0, (float)target.texture.width, (float)-target.texture.height }, (Vector2){ 0, 0 }, WHITE); // render texture with shader applied
             // EndShaderMode();
@@ -418,18 +372,60 @@ int main()
 
         BeginDrawing();
 
-            BeginShaderMode(defaultShader);
-                DrawTextureRec(target.texture, (Rectangle){ 0, 0, (float)target.texture.width, (float)-target.texture.height }, (Vector2){ 0, 0 }, WHITE); // render texture with shader applied
-            EndShaderMode();
-            
+            PROFILE_BEGIN("DrawDynamicResolution");
+            DrawDynamicResolution(&resolution, screenWidth, screenHeight);
+            PROFILE_END();
+
+            char posText[40];
+            sprintf(posText, "%f %f %f", camera.position.x, camera.position.y, camera.position.z);
+            DrawText(posText, 20, 40, 20, BLACK);
+
+            DrawText(TextFormat("chunks %i drawn %i culled, triangles %i drawn %i culled", drawStats.drawnChunks, drawStats.culledChunks,
+                                drawStats.drawnTriangles, drawStats.culledTriangles), 20, 70, 20, BLACK);
+            DrawText(TextFormat("%i ground draw calls, %.0f KB ground video memory per chunk", drawStats.drawCalls,
+                                (drawStats.residentChunks > 0)? drawStats.groundBytes/1024.0/drawStats.residentChunks : 0.0), 20, 100, 20, BLACK);
+            DrawText(TextFormat("render scale %.0f%% (%ix%i)", GetDynamicResolutionScale(&resolution)*100.0f, target.texture.width, target.texture.height), 20, 130, 20, BLACK);
+
+            ChunkCache *cache = &chunkStream.cache;
+            DrawText(TextFormat("chunk cache %i resident %i evicting %i loading, %.0f MB CPU + %.0f MB GPU of %.0f MB, %i loads %i evictions",
+                                GetChunkCacheCount(cache, CHUNK_RESIDENT), GetChunkCacheCount(cache, CHUNK_EVICTING), GetChunkCacheCount(cache, CHUNK_LOADING),
+                                cache->cpuBytes/1048576.0, cache->gpuBytes/1048576.0, cache->budget/1048576.0, cache->loadCount, cache->evictionCount), 20, 160, 20, (cache->cpuBytes + cache->gpuBytes > cache->budget)? RED : BLACK);
+
+            int hudY = 190;
+            if (!instancedTerrain) {
+                DrawText(TextFormat("chunk textures %.1f of %.1f MB, %.0f KB uploaded", chunkStream.textureBytes/1048576.0, chunkStream.textureBudget/1048576.0,
+                                    chunkStream.textureUploadBytes/1024.0), 20, hudY, 20, (chunkStream.textureBytes > chunkStream.textureBudget)? RED : BLACK);
+                hudY += 30;
+            }
+
             DrawFPS(10, 10);
+            if (showProfiler) PROFILE_DRAW_OVERLAY(20, hudY);
 
+        EndDynamicResolutionFrame(&resolution);     // Before the swap, which would count any vsync wait
+        MarkBenchPhase(&bench, BENCH_PHASE_PRESENT);
         EndDrawing();
+        SetBenchMemory(&bench, chunkStream.cache.cpuBytes + chunkStream.cache.gpuBytes);
+        EndBenchFrame(&bench);
+        PROFILE_FRAME();
         //----------------------------------------------------------------------------------
     }
 
     // De-Initialization
     //--------------------------------------------------------------------------------------
+    if (benchMode) SaveBenchResults(&bench, benchOutput);
+    if (recordPathFile != NULL) SaveCameraPath(recordPath, recordPathFile);
+    UnloadBenchRecorder(&bench);
+    UnloadCameraPath(&benchPath);
+    UnloadCameraPath(&recordPath);
+
+    CloseChunkStream(&chunkStream); // Stop the workers and unload every chunk
+    if (profileFile != NULL) PROFILE_SAVE_TRACE(profileFile, profileFrames);
+    PROFILE_CLOSE();
+    if (instancedTerrain) UnloadTerrainRenderer(&terrainRenderer);
+    UnloadTileCache(&tileCache);
+    UnloadSkyCache(&sky);
+    UnloadDynamicResolution(&resolution);
+    if (archived) CloseChunkArchive(&chunkArchive);
     CloseWindow();                  // Close window and OpenGL context
     //--------------------------------------------------------------------------------------
 
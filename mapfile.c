@@ -0,0 +1,77 @@
+#include "mapfile.h"
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#define MAPFILE_PAGE_SIZE 4096
+
+#if defined(_WIN32)
+
+void *MapFile(const char *fileName, size_t *size) {
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0)) {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);      // The mapping keeps the file open
+    if (mapping == NULL) return NULL;
+
+    void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);   // The view keeps the mapping alive
+    if (data == NULL) return NULL;
+
+    *size = (size_t)fileSize.QuadPart;
+    return data;
+}
+
+void UnmapFile(void *data, size_t size) {
+    (void)size;
+    if (data != NULL) UnmapViewOfFile(data);
+}
+
+#else
+
+void *MapFile(const char *fileName, size_t *size) {
+    int file = open(fileName, O_RDONLY);
+    if (file < 0) return NULL;
+
+    struct stat info;
+    if ((fstat(file, &info) != 0) || (info.st_size == 0)) {
+        close(file);
+        return NULL;
+    }
+
+    void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);            // The mapping keeps the file open
+    if (data == MAP_FAILED) return NULL;
+
+    *size = (size_t)info.st_size;
+    return data;
+}
+
+void UnmapFile(void *data, size_t size) {
+    if (data != NULL) munmap(data, size);
+}
+
+#endif
+
+void PrefetchMappedRange(const void *data, size_t size) {
+    // Read one byte per page, the same on every platform and cheap once the pages are resident
+    const volatile unsigned char *bytes = (const volatile unsigned char *)data;
+    unsigned char sum = 0;
+    for (size_t offset = 0; offset < size; offset += MAPFILE_PAGE_SIZE) sum += bytes[offset];
+    if (size > 0) sum += bytes[size - 1];
+    (void)sum;
+}
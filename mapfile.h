@@ -0,0 +1,19 @@
+/*******************************************************************************************
+*
+*   mapfile - Read-only memory mapped files
+*
+*   Kept apart from everything else because the Windows implementation needs windows.h, which
+*   clashes with raylib.h, so this is the only file that may include it.
+*
+********************************************************************************************/
+
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stddef.h>
+
+void *MapFile(const char *fileName, size_t *size);     // Map a whole file read-only, NULL on failure
+void UnmapFile(void *data, size_t size);
+void PrefetchMappedRange(const void *data, size_t size); // Fault the pages in now instead of on first use
+
+#endif // MAPFILE_H
@@ -0,0 +1,936 @@
+/*******************************************************************************************
+*
+*   microbench - Micro-benchmarks for the terrain code
+*
+*   Runs on the CPU only, no window or GPU is needed. The terrain is generated from Perlin
+*   noise so the benchmarks do not depend on the source PNGs.
+*
+*   Usage: microbench [suite...]        Runs every suite when none is given
+*
+********************************************************************************************/
+
+#include "raylib.h"
+#include "raymath.h"
+#include "arena.h"
+#include "chunk.h"
+#include "chunkcache.h"
+#include "collision.h"
+#include "dynres.h"
+#include "frustum.h"
+#include "heightfield.h"
+#include "rtin.h"
+#include "sky.h"
+#include "terraingen.h"
+#include "terrainmesh.h"
+#include "terrainrender.h"
+#include "timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define BENCH_CHUNKS 4                  // The benchmark terrain is BENCH_CHUNKS x BENCH_CHUNKS chunks
+#define BENCH_SAMPLES (int)(CHUNK_SIZE + 1)
+
+typedef struct BenchTerrain {
+    Mesh meshes[BENCH_CHUNKS*BENCH_CHUNKS];
+    Heightfield heightfields[BENCH_CHUNKS*BENCH_CHUNKS];
+} BenchTerrain;
+
+static volatile float benchSink;        // Keeps the compiler from dropping benchmarked work
+
+static float RandomRange(float min, float max) {
+    return min + (max - min)*((float)rand()/(float)RAND_MAX);
+}
+
+// The ground mesh chunks used before levels of detail: raylib's GenMeshHeightmap() without
+// the upload, one unindexed vertex per triangle corner. Kept as the mesh raycast baseline.
+static Mesh GenChunkMesh(Image heightMap, Vector3 size) {
+    #define GRAY_VALUE(c) ((float)(c.r + c.g + c.b)/3.0f)
+
+    Mesh mesh = { 0 };
+
+    int mapX = heightMap.width;
+    int mapZ = heightMap.height;
+
+    Color *pixels = LoadImageColors(heightMap);
+
+    // NOTE: One vertex per pixel
+    mesh.triangleCount = (mapX - 1)*(mapZ - 1)*2;    // One quad every four pixels
+
+    mesh.vertexCount = mesh.triangleCount*3;
+
+    mesh.vertices = (float *)RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+    mesh.normals = (float *)RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+    mesh.texcoords = (float *)RL_MALLOC(mesh.vertexCount*2*sizeof(float));
+
+    int vCounter = 0;       // Used to count vertices float by float
+    int tcCounter = 0;      // Used to count texcoords float by float
+    int nCounter = 0;       // Used to count normals float by float
+
+    Vector3 scaleFactor = { size.x/(mapX - 1), size.y/255.0f, size.z/(mapZ - 1) };
+
+    for (int z = 0; z < mapZ - 1; z++) {
+        for (int x = 0; x < mapX - 1; x++) {
+            // Fill vertices array with data
+            //----------------------------------------------------------
+
+            // one triangle - 3 vertex
+            mesh.vertices[vCounter] = (float)x*scaleFactor.x;
+            mesh.vertices[vCounter + 1] = GRAY_VALUE(pixels[x + z*mapX])*scaleFactor.y;
+            mesh.vertices[vCounter + 2] = (float)z*scaleFactor.z;
+
+            mesh.vertices[vCounter + 3] = (float)x*scaleFactor.x;
+            mesh.vertices[vCounter + 4] = GRAY_VALUE(pixels[x + (z + 1)*mapX])*scaleFactor.y;
+            mesh.vertices[vCounter + 5] = (float)(z + 1)*scaleFactor.z;
+
+            mesh.vertices[vCounter + 6] = (float)(x + 1)*scaleFactor.x;
+            mesh.vertices[vCounter + 7] = GRAY_VALUE(pixels[(x + 1) + z*mapX])*scaleFactor.y;
+            mesh.vertices[vCounter + 8] = (float)z*scaleFactor.z;
+
+            // Another triangle - 3 vertex
+            mesh.vertices[vCounter + 9] = mesh.vertices[vCounter + 6];
+            mesh.vertices[vCounter + 10] = mesh.vertices[vCounter + 7];
+            mesh.vertices[vCounter + 11] = mesh.vertices[vCounter + 8];
+
+            mesh.vertices[vCounter + 12] = mesh.vertices[vCounter + 3];
+            mesh.vertices[vCounter + 13] = mesh.vertices[vCounter + 4];
+            mesh.vertices[vCounter + 14] = mesh.vertices[vCounter + 5];
+
+            mesh.vertices[vCounter + 15] = (float)(x + 1)*scaleFactor.x;
+            mesh.vertices[vCounter + 16] = GRAY_VALUE(pixels[(x + 1) + (z + 1)*mapX])*scaleFactor.y;
+            mesh.vertices[vCounter + 17] = (float)(z + 1)*scaleFactor.z;
+            vCounter += 18;     // 6 vertex, 18 floats
+
+            // Fill texcoords array with data
+            //--------------------------------------------------------------
+            mesh.texcoords[tcCounter] = (float)x/(mapX - 1);
+            mesh.texcoords[tcCounter + 1] = (float)z/(mapZ - 1);
+
+            mesh.texcoords[tcCounter + 2] = (float)x/(mapX - 1);
+            mesh.texcoords[tcCounter + 3] = (float)(z + 1)/(mapZ - 1);
+
+            mesh.texcoords[tcCounter + 4] = (float)(x + 1)/(mapX - 1);
+            mesh.texcoords[tcCounter + 5] = (float)z/(mapZ - 1);
+
+            mesh.texcoords[tcCounter + 6] = mesh.texcoords[tcCounter + 4];
+            mesh.texcoords[tcCounter + 7] = mesh.texcoords[tcCounter + 5];
+
+            mesh.texcoords[tcCounter + 8] = mesh.texcoords[tcCounter + 2];
+            mesh.texcoords[tcCounter + 9] = mesh.texcoords[tcCounter + 3];
+
+            mesh.texcoords[tcCounter + 10] = (float)(x + 1)/(mapX - 1);
+            mesh.texcoords[tcCounter + 11] = (float)(z + 1)/(mapZ - 1);
+            tcCounter += 12;    // 6 texcoords, 12 floats
+
+            // Fill normals array with data
+            //--------------------------------------------------------------
+            for (int i = 0; i < 18; i += 9) {
+                Vector3 vA = { mesh.vertices[nCounter + i], mesh.vertices[nCounter + i + 1], mesh.vertices[nCounter + i + 2] };
+                Vector3 vB = { mesh.vertices[nCounter + i + 3], mesh.vertices[nCounter + i + 4], mesh.vertices[nCounter + i + 5] };
+                Vector3 vC = { mesh.vertices[nCounter + i + 6], mesh.vertices[nCounter + i + 7], mesh.vertices[nCounter + i + 8] };
+
+                Vector3 vN = Vector3Normalize(Vector3CrossProduct(Vector3Subtract(vB, vA), Vector3Subtract(vC, vA)));
+
+                for (int j = 0; j < 9; j += 3) {
+                    mesh.normals[nCounter + i + j] = vN.x;
+                    mesh.normals[nCounter + i + j + 1] = vN.y;
+                    mesh.normals[nCounter + i + j + 2] = vN.z;
+                }
+            }
+
+            nCounter += 18;     // 6 vertex, 18 floats
+        }
+    }
+
+    UnloadImageColors(pixels);  // Unload pixels color data
+
+    return mesh;
+}
+
+static BenchTerrain *LoadBenchTerrain(void) {
+    BenchTerrain *terrain = (BenchTerrain *)calloc(1, sizeof(BenchTerrain));
+    int mapSamples = BENCH_CHUNKS*(int)CHUNK_SIZE + 1;
+    Image heightMap = GenImagePerlinNoise(mapSamples, mapSamples, 0, 0, 4.0f);
+
+    for (int chunkX = 0; chunkX < BENCH_CHUNKS; chunkX++) {
+        for (int chunkZ = 0; chunkZ < BENCH_CHUNKS; chunkZ++) {
+            Rectangle rec = { chunkX*CHUNK_SIZE, chunkZ*CHUNK_SIZE, BENCH_SAMPLES, BENCH_SAMPLES };
+            Image crop = ImageFromImage(heightMap, rec);
+            Vector3 origin = { chunkX*CHUNK_SIZE, 0.0f, chunkZ*CHUNK_SIZE };
+            terrain->meshes[chunkX*BENCH_CHUNKS + chunkZ] = GenChunkMesh(crop, (Vector3){ CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE });
+            terrain->heightfields[chunkX*BENCH_CHUNKS + chunkZ] = LoadHeightfieldFromImage(crop, origin, (Vector3){ CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE });
+            UnloadImage(crop);
+        }
+    }
+
+    UnloadImage(heightMap);
+    return terrain;
+}
+
+static void UnloadBenchTerrain(BenchTerrain *terrain) {
+    for (int i = 0; i < BENCH_CHUNKS*BENCH_CHUNKS; i++) {
+        RL_FREE(terrain->meshes[i].vertices);
+        RL_FREE(terrain->meshes[i].normals);
+        RL_FREE(terrain->meshes[i].texcoords);
+        UnloadHeightfield(&terrain->heightfields[i]);
+    }
+    free(terrain);
+}
+
+static const Heightfield *GetBenchHeightfield(int chunkX, int chunkZ, void *userData) {
+    BenchTerrain *terrain = (BenchTerrain *)userData;
+    if ((chunkX < 0) || (chunkZ < 0) || (chunkX >= BENCH_CHUNKS) || (chunkZ >= BENCH_CHUNKS)) return NULL;
+    return &terrain->heightfields[chunkX*BENCH_CHUNKS + chunkZ];
+}
+
+static Matrix GetBenchChunkTransform(int chunkX, int chunkZ) {
+    return MatrixTranslate(chunkX*CHUNK_SIZE, 0.0f, chunkZ*CHUNK_SIZE);
+}
+
+//----------------------------------------------------------------------------------
+// Suites
+//----------------------------------------------------------------------------------
+
+// Ground height under the player: the old snap-to-ground mesh raycast against the chunk the
+// player is in, against an O(1) heightfield lookup. Also casts arbitrary rays across chunks.
+static void BenchHeightfield(void) {
+    BenchTerrain *terrain = LoadBenchTerrain();
+    float worldSize = BENCH_CHUNKS*CHUNK_SIZE;
+
+    const int pointCount = 2000;
+    Vector2 *points = (Vector2 *)malloc(pointCount*sizeof(Vector2));
+    for (int i = 0; i < pointCount; i++) points[i] = (Vector2){ RandomRange(0.0f, worldSize), RandomRange(0.0f, worldSize) };
+
+    double meshStart = GetMonotonicTime();
+    float *meshHeights = (float *)malloc(pointCount*sizeof(float));
+    for (int i = 0; i < pointCount; i++) {
+        int chunkX = (int)(points[i].x/CHUNK_SIZE), chunkZ = (int)(points[i].y/CHUNK_SIZE);
+        Ray ray = { (Vector3){ points[i].x, 1000000.0f, points[i].y }, (Vector3){ 0.0f, -1.0f, 0.0f } };
+        RayCollision hit = GetRayCollisionMesh(ray, terrain->meshes[chunkX*BENCH_CHUNKS + chunkZ], GetBenchChunkTransform(chunkX, chunkZ));
+        meshHeights[i] = hit.hit? hit.point.y : NAN;
+    }
+    double meshTime = GetMonotonicTime() - meshStart;
+
+    const int repeat = 1000;    // The heightfield lookup is too quick to time over one pass
+    double fieldStart = GetMonotonicTime();
+    float maxError = 0.0f;
+    for (int r = 0; r < repeat; r++) {
+        for (int i = 0; i < pointCount; i++) {
+            float height = NAN;
+            GetTerrainHeight(GetBenchHeightfield, terrain, CHUNK_SIZE, points[i].x, points[i].y, &height, NULL);
+            benchSink = height;
+            if (r == 0) maxError = fmaxf(maxError, fabsf(height - meshHeights[i]));
+        }
+    }
+    double fieldTime = (GetMonotonicTime() - fieldStart)/repeat;
+
+    printf("heightfield: ground height     mesh raycast %10.1f ns/query   heightfield %8.1f ns/query   x%.0f   max difference %g\n",
+           meshTime*1e9/pointCount, fieldTime*1e9/pointCount, meshTime/fieldTime, maxError);
+
+    // Arbitrary rays from above the ground, looking slightly down, that may cross chunk seams
+    const int rayCount = 100;
+    Ray *rays = (Ray *)malloc(rayCount*sizeof(Ray));
+    for (int i = 0; i < rayCount; i++) {
+        Vector3 position = { RandomRange(0.0f, worldSize), 0.0f, RandomRange(0.0f, worldSize) };
+        GetTerrainHeight(GetBenchHeightfield, terrain, CHUNK_SIZE, position.x, position.z, &position.y, NULL);
+        position.y += RandomRange(2.0f, 40.0f);
+        float angle = RandomRange(0.0f, 2.0f*PI);
+        rays[i] = (Ray){ position, Vector3Normalize((Vector3){ cosf(angle), RandomRange(-0.5f, -0.05f), sinf(angle) }) };
+    }
+
+    meshStart = GetMonotonicTime();
+    float *meshDistances = (float *)malloc(rayCount*sizeof(float));
+    for (int i = 0; i < rayCount; i++) {
+        RayCollision nearest = { 0 };
+        for (int chunkX = 0; chunkX < BENCH_CHUNKS; chunkX++) {
+            for (int chunkZ = 0; chunkZ < BENCH_CHUNKS; chunkZ++) {
+                RayCollision hit = GetRayCollisionMesh(rays[i], terrain->meshes[chunkX*BENCH_CHUNKS + chunkZ], GetBenchChunkTransform(chunkX, chunkZ));
+                if (hit.hit && (!nearest.hit || (hit.distance < nearest.distance))) nearest = hit;
+            }
+        }
+        meshDistances[i] = nearest.hit? nearest.distance : -1.0f;
+    }
+    meshTime = GetMonotonicTime() - meshStart;
+
+    fieldStart = GetMonotonicTime();
+    maxError = 0.0f;
+    int mismatches = 0;
+    for (int r = 0; r < repeat; r++) {
+        for (int i = 0; i < rayCount; i++) {
+            RayCollision hit = GetRayCollisionTerrain(rays[i], 1000000.0f, GetBenchHeightfield, terrain, CHUNK_SIZE);
+            benchSink = hit.distance;
+            if (r == 0) {
+                if (hit.hit != (meshDistances[i] >= 0.0f)) mismatches++;
+                else if (hit.hit) maxError = fmaxf(maxError, fabsf(hit.distance - meshDistances[i]));
+            }
+        }
+    }
+    fieldTime = (GetMonotonicTime() - fieldStart)/repeat;
+
+    printf("heightfield: arbitrary rays    mesh raycast %10.1f ns/query   heightfield %8.1f ns/query   x%.0f   max difference %g, %i hit mismatches\n",
+           meshTime*1e9/rayCount, fieldTime*1e9/rayCount, meshTime/fieldTime, maxError, mismatches);
+
+    free(meshDistances);
+    free(rays);
+    free(meshHeights);
+    free(points);
+    UnloadBenchTerrain(terrain);
+}
+
+// Size, error and build time of every ground level of detail, with the distance at which
+// GetChunkLod() would switch to it on a 1080 pixel high screen with a 45 degree fov
+static void BenchLod(void) {
+    BenchTerrain *terrain = LoadBenchTerrain();
+    int chunkCount = BENCH_CHUNKS*BENCH_CHUNKS;
+    float pixelsPerUnitAt1 = 1080.0f/(2.0f*tanf(45.0f*DEG2RAD*0.5f));
+
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        int triangles = 0;
+        float maxError = 0.0f;
+
+        double start = GetMonotonicTime();
+        for (int i = 0; i < chunkCount; i++) {
+            Mesh mesh = GenHeightfieldMesh(&terrain->heightfields[i], 1 << lod, CHUNK_SKIRT_DEPTH, NULL);
+            triangles += mesh.triangleCount;
+            UnloadMeshData(&mesh);
+        }
+        double buildTime = (GetMonotonicTime() - start)/chunkCount;
+
+        for (int i = 0; i < chunkCount; i++) maxError = fmaxf(maxError, GetHeightfieldMeshError(&terrain->heightfields[i], 1 << lod));
+
+        printf("lod: level %i   %6i triangles/chunk   build %8.1f us/chunk   max error %6.3f   used beyond %7.1f units\n",
+               lod, triangles/chunkCount, buildTime*1e6, maxError, maxError*pixelsPerUnitAt1/CHUNK_LOD_PIXEL_ERROR);
+    }
+
+    UnloadBenchTerrain(terrain);
+}
+
+// Adaptive ground meshes at a range of error thresholds, against the original
+// GenMeshHeightmap() mesh and the full resolution grid: triangles, build time and the largest
+// vertical distance between the samples and the mesh
+static void BenchRtin(void) {
+    BenchTerrain *terrain = LoadBenchTerrain();
+    int chunkCount = BENCH_CHUNKS*BENCH_CHUNKS;
+
+    int triangles = 0;
+    float maxError = 0.0f;
+    double start = GetMonotonicTime();
+    for (int i = 0; i < chunkCount; i++) {
+        Mesh mesh = GenHeightfieldMesh(&terrain->heightfields[i], 1, 0.0f, NULL);
+        triangles += mesh.triangleCount;
+        maxError = fmaxf(maxError, GetHeightfieldRtinMeshError(&terrain->heightfields[i], mesh));
+        UnloadMeshData(&mesh);
+    }
+    double buildTime = (GetMonotonicTime() - start)/chunkCount;
+
+    Image heightMap = GenImagePerlinNoise(BENCH_SAMPLES, BENCH_SAMPLES, 0, 0, 4.0f);
+    start = GetMonotonicTime();
+    for (int i = 0; i < chunkCount; i++) {
+        Mesh mesh = GenChunkMesh(heightMap, (Vector3){ CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE });
+        UnloadMeshData(&mesh);
+    }
+    double heightmapTime = (GetMonotonicTime() - start)/chunkCount;
+    UnloadImage(heightMap);
+
+    printf("rtin: GenMeshHeightmap   %6i triangles/chunk   build %8.1f us/chunk   max error  0.000\n", terrain->meshes[0].triangleCount, heightmapTime*1e6);
+    printf("rtin: full grid          %6i triangles/chunk   build %8.1f us/chunk   max error %6.3f\n", triangles/chunkCount, buildTime*1e6, maxError);
+
+    start = GetMonotonicTime();
+    float *errors[BENCH_CHUNKS*BENCH_CHUNKS];
+    for (int i = 0; i < chunkCount; i++) errors[i] = LoadHeightfieldRtinErrors(&terrain->heightfields[i], NULL);
+    double errorTime = (GetMonotonicTime() - start)/chunkCount;
+    printf("rtin: midpoint errors    build %8.1f us/chunk, once per chunk for every threshold\n", errorTime*1e6);
+
+    const float thresholds[] = { 0.0f, 0.25f, 0.5f, 1.0f, 2.0f, 4.0f, 8.0f };
+    for (int t = 0; t < (int)(sizeof(thresholds)/sizeof(thresholds[0])); t++) {
+        triangles = 0;
+        maxError = 0.0f;
+        double meshTime = 0.0;
+        for (int i = 0; i < chunkCount; i++) {
+            start = GetMonotonicTime();
+            Mesh mesh = GenHeightfieldRtinMesh(&terrain->heightfields[i], errors[i], thresholds[t], NULL);
+            meshTime += GetMonotonicTime() - start;
+            triangles += mesh.triangleCount;
+            maxError = fmaxf(maxError, GetHeightfieldRtinMeshError(&terrain->heightfields[i], mesh));
+            UnloadMeshData(&mesh);
+        }
+
+        printf("rtin: threshold %5.2f    %6i triangles/chunk   build %8.1f us/chunk   max error %6.3f\n",
+               thresholds[t], triangles/chunkCount, meshTime*1e6/chunkCount, maxError);
+    }
+
+    for (int i = 0; i < chunkCount; i++) UnloadHeightfieldRtinErrors(errors[i]);
+    UnloadBenchTerrain(terrain);
+}
+
+// Share of the terrain left after frustum culling, for first person views from random points
+// looking level in random directions, and the cost of building the frustum and testing it
+static void BenchCull(void) {
+    BenchTerrain *terrain = LoadBenchTerrain();
+    int chunkCount = BENCH_CHUNKS*BENCH_CHUNKS;
+    float worldSize = BENCH_CHUNKS*CHUNK_SIZE;
+
+    BoundingBox bounds[BENCH_CHUNKS*BENCH_CHUNKS];
+    for (int i = 0; i < chunkCount; i++) {
+        Heightfield *heightfield = &terrain->heightfields[i];
+        bounds[i].min = (Vector3){ heightfield->origin.x, heightfield->minHeight, heightfield->origin.z };
+        bounds[i].max = (Vector3){ heightfield->origin.x + CHUNK_SIZE, heightfield->maxHeight, heightfield->origin.z + CHUNK_SIZE };
+    }
+
+    const int viewCount = 10000;
+    Camera *views = (Camera *)malloc(viewCount*sizeof(Camera));
+    for (int i = 0; i < viewCount; i++) {
+        Vector3 position = { RandomRange(0.0f, worldSize), 0.0f, RandomRange(0.0f, worldSize) };
+        GetTerrainHeight(GetBenchHeightfield, terrain, CHUNK_SIZE, position.x, position.z, &position.y, NULL);
+        position.y += 2.0f;
+        float angle = RandomRange(0.0f, 2.0f*PI);
+        views[i] = (Camera){ position, Vector3Add(position, (Vector3){ cosf(angle), 0.0f, sinf(angle) }), (Vector3){ 0.0f, 1.0f, 0.0f }, 60.0f, CAMERA_PERSPECTIVE };
+    }
+
+    long drawn = 0;
+    double start = GetMonotonicTime();
+    for (int i = 0; i < viewCount; i++) {
+        Frustum frustum = GetCameraFrustum(views[i], 16.0f/9.0f, 0.01f, 1000.0f);
+        for (int c = 0; c < chunkCount; c++) drawn += CheckCollisionBoxFrustum(bounds[c], &frustum);
+    }
+    double cullTime = (GetMonotonicTime() - start)/viewCount;
+
+    printf("cull: %i chunks, %.1f%% drawn on average over %i first person views, %.1f ns per view to cull every chunk\n",
+           chunkCount, 100.0*drawn/((double)viewCount*chunkCount), viewCount, cullTime*1e9);
+
+    free(views);
+    UnloadBenchTerrain(terrain);
+}
+
+// Ground memory per chunk and draw calls per frame for each way of drawing the ground: the
+// original GenMeshHeightmap() mesh, a mesh per level of detail, and the instanced renderer
+static void BenchRender(void) {
+    BenchTerrain *terrain = LoadBenchTerrain();
+    int chunkCount = BENCH_CHUNKS*BENCH_CHUNKS;
+    float worldSize = BENCH_CHUNKS*CHUNK_SIZE;
+
+    // raylib keeps the CPU arrays of an uploaded mesh until UnloadMesh()
+    size_t originalBytes = terrain->meshes[0].vertexCount*(3 + 3 + 2)*sizeof(float);
+
+    size_t lodBytes = 0, lodIndexBytes = 0;
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        Mesh mesh = GenHeightfieldMesh(&terrain->heightfields[0], 1 << lod, CHUNK_SKIRT_DEPTH, NULL);
+        lodBytes += mesh.vertexCount*(3 + 3 + 2)*sizeof(float) + mesh.triangleCount*3*sizeof(unsigned short);
+        lodIndexBytes += mesh.triangleCount*3*sizeof(unsigned short);
+        UnloadMeshData(&mesh);
+    }
+
+    size_t gridBytes = 0;
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        Mesh grid = GenTerrainGridMesh(TERRAIN_TILE_SAMPLES, 1 << lod);
+        gridBytes += grid.vertexCount*3*sizeof(float) + grid.triangleCount*3*sizeof(unsigned short);
+        UnloadMeshData(&grid);
+    }
+    size_t tileBytes = TERRAIN_TILE_STRIDE*TERRAIN_TILE_STRIDE*sizeof(float);
+
+    printf("render: ground geometry per chunk   GenMeshHeightmap %6.0f KB video + %6.0f KB RAM   LOD meshes %6.0f KB video + %4.0f KB RAM   instanced %4.0f KB video, plus %.0f KB of grids shared by all chunks\n",
+           originalBytes/1024.0, originalBytes/1024.0, lodBytes/1024.0, lodIndexBytes/1024.0, tileBytes/1024.0, gridBytes/1024.0);
+
+    // Draw calls over random first person views, as DrawChunkStream() would pick them
+    Chunk chunks[BENCH_CHUNKS*BENCH_CHUNKS] = { 0 };
+    for (int i = 0; i < chunkCount; i++) {
+        Heightfield *heightfield = &terrain->heightfields[i];
+        chunks[i].heightfield = *heightfield;
+        chunks[i].bounds.min = (Vector3){ heightfield->origin.x, heightfield->minHeight, heightfield->origin.z };
+        chunks[i].bounds.max = (Vector3){ heightfield->origin.x + CHUNK_SIZE, heightfield->maxHeight, heightfield->origin.z + CHUNK_SIZE };
+        for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) chunks[i].lodError[lod] = GetHeightfieldMeshError(heightfield, 1 << lod);
+    }
+
+    const int viewCount = 1000;
+    long meshDrawCalls = 0, instancedDrawCalls = 0;
+    for (int v = 0; v < viewCount; v++) {
+        Camera camera = { 0 };
+        camera.position = (Vector3){ RandomRange(0.0f, worldSize), 0.0f, RandomRange(0.0f, worldSize) };
+        GetTerrainHeight(GetBenchHeightfield, terrain, CHUNK_SIZE, camera.position.x, camera.position.z, &camera.position.y, NULL);
+        camera.position.y += 2.0f;
+        float angle = RandomRange(0.0f, 2.0f*PI);
+        camera.target = Vector3Add(camera.position, (Vector3){ cosf(angle), 0.0f, sinf(angle) });
+        camera.up = (Vector3){ 0.0f, 1.0f, 0.0f };
+        camera.fovy = 60.0f;
+
+        Frustum frustum = GetCameraFrustum(camera, 16.0f/9.0f, 0.01f, 1000.0f);
+        bool lodUsed[CHUNK_LOD_COUNT] = { 0 };
+        for (int i = 0; i < chunkCount; i++) {
+            if (!CheckCollisionBoxFrustum(chunks[i].bounds, &frustum)) continue;
+            meshDrawCalls++;
+            lodUsed[GetChunkLod(&chunks[i], camera, 1080.0f)] = true;
+        }
+        for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) instancedDrawCalls += lodUsed[lod];
+    }
+
+    printf("render: ground draw calls per frame   mesh per chunk %.1f   instanced %.1f   (%i chunks, %i first person views)\n",
+           (double)meshDrawCalls/viewCount, (double)instancedDrawCalls/viewCount, chunkCount, viewCount);
+
+    UnloadBenchTerrain(terrain);
+}
+
+// Sky model on the CPU: the SSE2 evaluator against the scalar port of the original shader,
+// in time and in largest colour difference, over random view directions and sun positions
+static void BenchSky(void) {
+    const int directionCount = 6*SKY_CUBEMAP_SIZE*SKY_CUBEMAP_SIZE;   // As many as one cubemap build
+    Vector3 *directions = (Vector3 *)malloc(directionCount*sizeof(Vector3));
+    Vector3 *colors = (Vector3 *)malloc(directionCount*sizeof(Vector3));
+    Vector3 *reference = (Vector3 *)malloc(directionCount*sizeof(Vector3));
+    for (int i = 0; i < directionCount; i++) {
+        directions[i] = Vector3Normalize((Vector3){ RandomRange(-1.0f, 1.0f), RandomRange(-1.0f, 1.0f), RandomRange(-1.0f, 1.0f) });
+    }
+
+    const int sunCount = 8;
+    double scalarTime = 0.0, vectorTime = 0.0;
+    float maxDifference = 0.0f;
+    for (int sun = 0; sun < sunCount; sun++) {
+        SkyParams params = GetDefaultSkyParams();
+        params.inclination = RandomRange(0.0f, 1.0f);
+        params.azimuth = RandomRange(0.0f, 0.5f);
+
+        double start = GetMonotonicTime();
+        EvalSkyRadianceScalar(params, directions, reference, directionCount);
+        scalarTime += GetMonotonicTime() - start;
+
+        start = GetMonotonicTime();
+        EvalSkyRadiance(params, directions, colors, directionCount);
+        vectorTime += GetMonotonicTime() - start;
+
+        for (int i = 0; i < directionCount; i++) {
+            maxDifference = fmaxf(maxDifference, fabsf(colors[i].x - reference[i].x));
+            maxDifference = fmaxf(maxDifference, fabsf(colors[i].y - reference[i].y));
+            maxDifference = fmaxf(maxDifference, fabsf(colors[i].z - reference[i].z));
+        }
+    }
+
+    double start = GetMonotonicTime();
+    Image faces = GenImageSkyCubemap(GetDefaultSkyParams(), SKY_CUBEMAP_SIZE);
+    double buildTime = GetMonotonicTime() - start;
+    UnloadImage(faces);
+
+    printf("sky: scalar %6.1f ns/direction   vectorized %6.1f ns/direction   x%.1f   max difference %g (%.3f of an 8 bit step)\n",
+           scalarTime*1e9/(sunCount*directionCount), vectorTime*1e9/(sunCount*directionCount), scalarTime/vectorTime, maxDifference, maxDifference*255.0f);
+    printf("sky: %ix%i cubemap rebuilt in %.2f ms when the sun moves, against %.1f million evaluations every frame at 2560x1440 before\n",
+           SKY_CUBEMAP_SIZE, SKY_CUBEMAP_SIZE, buildTime*1000.0, 2560.0*1440.0/1e6);
+
+    free(directions);
+    free(colors);
+    free(reference);
+}
+
+typedef struct TerrainGenJob {
+    const TerrainGenerator *generator;
+    int firstChunk;
+    int chunkCount;
+} TerrainGenJob;
+
+static void *GenTerrainChunks(void *arg) {
+    TerrainGenJob *job = (TerrainGenJob *)arg;
+    for (int i = job->firstChunk; i < job->firstChunk + job->chunkCount; i++) {
+        Heightfield heightfield = GenTerrainHeightfield(job->generator, (i%16)*(int)CHUNK_SIZE, (i/16)*(int)CHUNK_SIZE, BENCH_SAMPLES, BENCH_SAMPLES, CHUNK_APRON);
+        Image texture = GenTerrainColorImage(job->generator, &heightfield, (int)CHUNK_TEX_SCALE);
+        benchSink += heightfield.maxHeight + texture.width;
+        UnloadImage(texture);
+        UnloadHeightfield(&heightfield);
+    }
+    return NULL;
+}
+
+// Procedural chunks: heights and ground texture of a chunk on one thread, then chunks per
+// second with a thread per core, the way the chunk stream workers generate them. Also checks
+// that neighbouring chunks agree on their shared edge.
+static void BenchTerrainGen(void) {
+    TerrainGenerator generator = GetTerrainGenerator(1, CHUNK_SIZE);
+    const int chunkCount = 32;
+
+    double heightTime = 0.0, colorTime = 0.0;
+    for (int i = 0; i < chunkCount; i++) {
+        double start = GetMonotonicTime();
+        Heightfield heightfield = GenTerrainHeightfield(&generator, (i%16)*(int)CHUNK_SIZE, (i/16)*(int)CHUNK_SIZE, BENCH_SAMPLES, BENCH_SAMPLES, CHUNK_APRON);
+        heightTime += GetMonotonicTime() - start;
+
+        start = GetMonotonicTime();
+        Image texture = GenTerrainColorImage(&generator, &heightfield, (int)CHUNK_TEX_SCALE);
+        colorTime += GetMonotonicTime() - start;
+
+        UnloadImage(texture);
+        UnloadHeightfield(&heightfield);
+    }
+
+#if defined(_SC_NPROCESSORS_ONLN)
+    int threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    int threadCount = 4;
+#endif
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > 16) threadCount = 16;
+    pthread_t threads[16];
+    TerrainGenJob jobs[16];
+    double start = GetMonotonicTime();
+    for (int t = 0; t < threadCount; t++) {
+        jobs[t] = (TerrainGenJob){ &generator, t*chunkCount, chunkCount };
+        pthread_create(&threads[t], NULL, GenTerrainChunks, &jobs[t]);
+    }
+    for (int t = 0; t < threadCount; t++) pthread_join(threads[t], NULL);
+    double threadedTime = GetMonotonicTime() - start;
+
+    // Chunks meet where the last column of one is the first column of the next, and samples
+    // do not depend on where in a row they were generated
+    float edgeA[BENCH_SAMPLES*BENCH_SAMPLES], edgeB[BENCH_SAMPLES*BENCH_SAMPLES];
+    int mismatches = 0;
+    GenTerrainHeights(&generator, -(int)CHUNK_SIZE, 384, BENCH_SAMPLES, BENCH_SAMPLES, edgeA);
+    GenTerrainHeights(&generator, 0, 384, BENCH_SAMPLES, BENCH_SAMPLES, edgeB);
+    for (int z = 0; z < BENCH_SAMPLES; z++) mismatches += (edgeA[z*BENCH_SAMPLES + BENCH_SAMPLES - 1] != edgeB[z*BENCH_SAMPLES]);
+    GenTerrainHeights(&generator, 3, 384, BENCH_SAMPLES - 3, 1, edgeA);
+    for (int x = 0; x < BENCH_SAMPLES - 3; x++) mismatches += (edgeA[x] != edgeB[x + 3]);
+
+    // A worker generating a chunk has about one frame of CPU time before the next is wanted
+    double chunkTime = (heightTime + colorTime)/chunkCount;
+    double frameTime = 1.0/DYNRES_TARGET_FPS;
+    printf("terraingen: %s, %i samples per lane group   heights %6.2f ms/chunk   ground texture %6.2f ms/chunk   %.1f chunks/s on one thread\n",
+           GetTerrainGenBackend(), TERRAIN_GEN_WIDTH, heightTime*1000.0/chunkCount, colorTime*1000.0/chunkCount, 1.0/chunkTime);
+    printf("terraingen: %.2f ms/chunk, %.0f%% of a %.2f ms frame at %i fps\n", chunkTime*1000.0, 100.0*chunkTime/frameTime, frameTime*1000.0, DYNRES_TARGET_FPS);
+    printf("terraingen: %i threads   %.1f chunks/s   %.1f chunks/s per thread   %i edge samples that differ between neighbours\n",
+           threadCount, threadCount*chunkCount/threadedTime, chunkCount/threadedTime, mismatches);
+}
+
+typedef struct MesherJob {
+    const Heightfield *heightfields;
+    int chunkCount;
+    int passes;
+    Arena arena;
+} MesherJob;
+
+// Every level of detail of every chunk, the way the stream workers build them
+static void *GenChunkMeshes(void *arg) {
+    MesherJob *job = (MesherJob *)arg;
+    for (int pass = 0; pass < job->passes; pass++) {
+        for (int i = 0; i < job->chunkCount; i++) {
+            for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+                Mesh mesh = GenHeightfieldMesh(&job->heightfields[i], 1 << lod, CHUNK_SKIRT_DEPTH, &job->arena);
+                benchSink += mesh.vertices[3*mesh.vertexCount - 2];
+            }
+            ResetArena(&job->arena);
+        }
+    }
+    return NULL;
+}
+
+// Ground meshes of a chunk: raylib's GenMeshHeightmap() against the indexed heightfield mesher
+// building into a reused arena, on one thread and on a thread per core. Also counts the
+// arena blocks allocated once warm, and the normals that differ where neighbouring chunks meet.
+static void BenchMesher(void) {
+    TerrainGenerator generator = GetTerrainGenerator(1, CHUNK_SIZE);
+    const int chunkCount = 16;
+    Heightfield heightfields[16];
+    for (int i = 0; i < chunkCount; i++) {
+        heightfields[i] = GenTerrainHeightfield(&generator, (i%4)*(int)CHUNK_SIZE, (i/4)*(int)CHUNK_SIZE, BENCH_SAMPLES, BENCH_SAMPLES, CHUNK_APRON);
+    }
+
+    Image heightMap = GenImagePerlinNoise(BENCH_SAMPLES, BENCH_SAMPLES, 0, 0, 4.0f);
+    Mesh heightmapMesh = GenChunkMesh(heightMap, (Vector3){ CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE });
+    size_t heightmapBytes = (size_t)heightmapMesh.vertexCount*8*sizeof(float);
+    UnloadMeshData(&heightmapMesh);
+    double start = GetMonotonicTime();
+    for (int i = 0; i < chunkCount; i++) {
+        Mesh mesh = GenChunkMesh(heightMap, (Vector3){ CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE });
+        UnloadMeshData(&mesh);
+    }
+    double heightmapTime = (GetMonotonicTime() - start)/chunkCount;
+    UnloadImage(heightMap);
+
+    Mesh mesh = GenHeightfieldMesh(&heightfields[0], 1, CHUNK_SKIRT_DEPTH, NULL);
+    size_t meshBytes = (size_t)mesh.vertexCount*8*sizeof(float) + (size_t)mesh.triangleCount*3*sizeof(unsigned short);
+    UnloadMeshData(&mesh);
+
+    MesherJob job = { heightfields, chunkCount, 1, LoadArena(CHUNK_ARENA_SIZE) };
+    GenChunkMeshes(&job);
+    int warmBlocks = job.arena.blockAllocations;
+    job.passes = 4;
+    start = GetMonotonicTime();
+    GenChunkMeshes(&job);
+    double meshTime = (GetMonotonicTime() - start)/(job.passes*chunkCount);
+    int blockAllocations = job.arena.blockAllocations - warmBlocks;
+    UnloadArena(&job.arena);
+
+#if defined(_SC_NPROCESSORS_ONLN)
+    int threadCount = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    int threadCount = 4;
+#endif
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > 16) threadCount = 16;
+    pthread_t threads[16];
+    MesherJob jobs[16];
+    start = GetMonotonicTime();
+    for (int t = 0; t < threadCount; t++) {
+        jobs[t] = (MesherJob){ heightfields, chunkCount, 4, LoadArena(CHUNK_ARENA_SIZE) };
+        pthread_create(&threads[t], NULL, GenChunkMeshes, &jobs[t]);
+    }
+    for (int t = 0; t < threadCount; t++) pthread_join(threads[t], NULL);
+    double threadedTime = GetMonotonicTime() - start;
+    for (int t = 0; t < threadCount; t++) UnloadArena(&jobs[t].arena);
+
+    // The last column of one chunk and the first column of the next are the same samples, with
+    // the apron their normals are too
+    int mismatches = 0;
+    Mesh left = GenHeightfieldMesh(&heightfields[0], 1, 0.0f, NULL);
+    Mesh right = GenHeightfieldMesh(&heightfields[1], 1, 0.0f, NULL);
+    for (int z = 0; z < BENCH_SAMPLES; z++) {
+        int a = z*BENCH_SAMPLES + BENCH_SAMPLES - 1;
+        int b = z*BENCH_SAMPLES;
+        for (int c = 0; c < 3; c++) mismatches += (left.normals[a*3 + c] != right.normals[b*3 + c]);
+    }
+    UnloadMeshData(&left);
+    UnloadMeshData(&right);
+
+    printf("mesher: GenMeshHeightmap   %8.1f us/chunk   %7zu bytes/chunk, unindexed\n", heightmapTime*1e6, heightmapBytes);
+    printf("mesher: heightfield mesh   %8.1f us/chunk for %i levels of detail   %7zu bytes/chunk at full detail, indexed   x%.1f faster for all levels\n",
+           meshTime*1e6, CHUNK_LOD_COUNT, meshBytes, heightmapTime/meshTime);
+    printf("mesher: %i threads   %.1f chunks/s   %i arena blocks allocated once warm   %i border normal components that differ between neighbours\n",
+           threadCount, threadCount*4*chunkCount/threadedTime, blockAllocations, mismatches);
+
+    for (int i = 0; i < chunkCount; i++) UnloadHeightfield(&heightfields[i]);
+}
+
+typedef struct BenchProps {
+    BenchTerrain *terrain;
+    CollisionGrid grids[BENCH_CHUNKS*BENCH_CHUNKS];
+} BenchProps;
+
+static const Heightfield *GetBenchPropsHeightfield(int chunkX, int chunkZ, void *userData) {
+    return GetBenchHeightfield(chunkX, chunkZ, ((BenchProps *)userData)->terrain);
+}
+
+static const CollisionGrid *GetBenchPropsGrid(int chunkX, int chunkZ, void *userData) {
+    BenchProps *props = (BenchProps *)userData;
+    if ((chunkX < 0) || (chunkZ < 0) || (chunkX >= BENCH_CHUNKS) || (chunkZ >= BENCH_CHUNKS)) return NULL;
+    return &props->grids[chunkX*BENCH_CHUNKS + chunkZ];
+}
+
+// A unit sphere split into rings and slices, indexed
+static Mesh GenRockMesh(int rings, int slices) {
+    Mesh mesh = { 0 };
+    mesh.vertexCount = (rings + 1)*(slices + 1);
+    mesh.triangleCount = 2*rings*slices;
+    mesh.vertices = (float *)RL_MALLOC(mesh.vertexCount*3*sizeof(float));
+    mesh.indices = (unsigned short *)RL_MALLOC(mesh.triangleCount*3*sizeof(unsigned short));
+
+    for (int r = 0; r <= rings; r++) {
+        for (int s = 0; s <= slices; s++) {
+            float polar = PI*r/rings, azimuth = 2.0f*PI*s/slices;
+            float *vertex = &mesh.vertices[(r*(slices + 1) + s)*3];
+            vertex[0] = sinf(polar)*cosf(azimuth);
+            vertex[1] = cosf(polar);
+            vertex[2] = sinf(polar)*sinf(azimuth);
+        }
+    }
+
+    int i = 0;
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < slices; s++) {
+            unsigned short v00 = (unsigned short)(r*(slices + 1) + s), v01 = v00 + 1;
+            unsigned short v10 = v00 + slices + 1, v11 = v10 + 1;
+            mesh.indices[i++] = v00; mesh.indices[i++] = v10; mesh.indices[i++] = v01;
+            mesh.indices[i++] = v01; mesh.indices[i++] = v10; mesh.indices[i++] = v11;
+        }
+    }
+
+    return mesh;
+}
+
+// Player moves against rocks of growing density, through the per chunk grids and against
+// every triangle of the chunks, which is what colliding without an index costs
+static void BenchCollision(void) {
+    BenchProps props = { 0 };
+    props.terrain = LoadBenchTerrain();
+    CollisionWorld world = { GetBenchPropsHeightfield, GetBenchPropsGrid, &props, CHUNK_SIZE };
+    Mesh rock = GenRockMesh(8, 16);
+    const Capsule player = { { 0 }, 2.0f, 0.4f };
+    const float moveLength = 100.0f/60.0f;      // A walking frame at 60 fps
+
+    const int densities[] = { 0, 16, 128, 1024 };
+    for (int d = 0; d < (int)(sizeof(densities)/sizeof(densities[0])); d++) {
+        // Rocks on the middle 2 x 2 chunks, where the player walks, half sunk into the ground
+        int rockCount = densities[d];
+        Model *models = (Model *)malloc((rockCount + 1)*sizeof(Model));
+        Vector3 *positions = (Vector3 *)malloc((rockCount + 1)*sizeof(Vector3));
+        for (int chunk = 0; chunk < BENCH_CHUNKS*BENCH_CHUNKS; chunk++) {
+            int chunkX = chunk/BENCH_CHUNKS, chunkZ = chunk%BENCH_CHUNKS;
+            bool middle = (chunkX >= 1) && (chunkX <= 2) && (chunkZ >= 1) && (chunkZ <= 2);
+            int count = middle? rockCount : 0;
+            for (int i = 0; i < count; i++) {
+                float size = RandomRange(0.5f, 2.0f);
+                models[i] = (Model){ .transform = MatrixScale(size, size, size), .meshCount = 1, .meshes = &rock };
+                positions[i] = (Vector3){ (chunkX + RandomRange(0.0f, 1.0f))*CHUNK_SIZE, 0.0f, (chunkZ + RandomRange(0.0f, 1.0f))*CHUNK_SIZE };
+                GetTerrainHeight(GetBenchHeightfield, props.terrain, CHUNK_SIZE, positions[i].x, positions[i].z, &positions[i].y, NULL);
+                positions[i].y -= 0.3f*size;
+            }
+            props.grids[chunk] = LoadCollisionGrid(models, positions, count, (Vector2){ chunkX*CHUNK_SIZE, chunkZ*CHUNK_SIZE }, CHUNK_SIZE);
+        }
+        free(models);
+        free(positions);
+
+        // The same moves for both
+        const int moveCount = 2000;
+        Capsule *starts = (Capsule *)malloc(moveCount*sizeof(Capsule));
+        Vector3 *moves = (Vector3 *)malloc(moveCount*sizeof(Vector3));
+        for (int i = 0; i < moveCount; i++) {
+            starts[i] = player;
+            starts[i].base = (Vector3){ RandomRange(1.1f, 2.9f)*CHUNK_SIZE, 0.0f, RandomRange(1.1f, 2.9f)*CHUNK_SIZE };
+            GetTerrainHeight(GetBenchHeightfield, props.terrain, CHUNK_SIZE, starts[i].base.x, starts[i].base.z, &starts[i].base.y, NULL);
+            float angle = RandomRange(0.0f, 2.0f*PI);
+            moves[i] = (Vector3){ moveLength*cosf(angle), 0.0f, moveLength*sinf(angle) };
+            float groundHeight = starts[i].base.y;
+            GetTerrainHeight(GetBenchHeightfield, props.terrain, CHUNK_SIZE, starts[i].base.x + moves[i].x, starts[i].base.z + moves[i].z, &groundHeight, NULL);
+            moves[i].y = groundHeight - starts[i].base.y;
+        }
+
+        int hits = 0;
+        double start = GetMonotonicTime();
+        for (int i = 0; i < moveCount; i++) {
+            CapsuleMove move = MoveCapsule(&world, starts[i], moves[i]);
+            hits += move.hitProp;
+            benchSink += move.base.y;
+        }
+        double gridTime = (GetMonotonicTime() - start)/moveCount;
+
+        // One cell holding every triangle of the chunk, fewer moves since each tests them all
+        int triangles = 0;
+        int *cellStarts[BENCH_CHUNKS*BENCH_CHUNKS];
+        int *cellTriangles[BENCH_CHUNKS*BENCH_CHUNKS];
+        for (int chunk = 0; chunk < BENCH_CHUNKS*BENCH_CHUNKS; chunk++) {
+            CollisionGrid *grid = &props.grids[chunk];
+            triangles += grid->triangleCount;
+            cellStarts[chunk] = grid->cellStarts;
+            cellTriangles[chunk] = grid->cellTriangles;
+            grid->cellStarts = (int *)malloc(2*sizeof(int));
+            grid->cellTriangles = (int *)malloc((grid->triangleCount + 1)*sizeof(int));
+            grid->cellStarts[0] = 0;
+            grid->cellStarts[1] = grid->triangleCount;
+            for (int t = 0; t < grid->triangleCount; t++) grid->cellTriangles[t] = t;
+            grid->cellsX = grid->cellsZ = 1;
+            grid->cellSize = CHUNK_SIZE;
+        }
+
+        int linearMoves = (rockCount > 128)? 20 : 200;
+        start = GetMonotonicTime();
+        for (int i = 0; i < linearMoves; i++) benchSink += MoveCapsule(&world, starts[i], moves[i]).base.y;
+        double linearTime = (GetMonotonicTime() - start)/linearMoves;
+
+        printf("collision: %5i rocks/chunk %8i triangles/chunk   grid %8.2f us/move   every triangle %10.2f us/move   %4.1f%% of moves hit a rock\n",
+               rockCount, triangles/4, gridTime*1e6, linearTime*1e6, 100.0f*hits/moveCount);
+
+        for (int chunk = 0; chunk < BENCH_CHUNKS*BENCH_CHUNKS; chunk++) {
+            free(props.grids[chunk].cellStarts);
+            free(props.grids[chunk].cellTriangles);
+            props.grids[chunk].cellStarts = cellStarts[chunk];
+            props.grids[chunk].cellTriangles = cellTriangles[chunk];
+            UnloadCollisionGrid(&props.grids[chunk]);
+        }
+        free(starts);
+        free(moves);
+    }
+
+    UnloadMeshData(&rock);
+    UnloadBenchTerrain(props.terrain);
+}
+
+// A long flight through a chunk cache kept the way the chunk stream keeps it: the ring around
+// the camera is resident, chunks left behind become evictable once they are a chunk past it.
+// The chunks only hold a heightfield, which is enough to show the lookups and whether the
+// entries and the memory stay flat.
+static void BenchChunkCache(void) {
+    const int radius = 4, hysteresis = 1, frames = 20000;
+    const size_t chunkBytes = BENCH_SAMPLES*BENCH_SAMPLES*sizeof(float);
+    ChunkCache cache;
+    InitChunkCache(&cache, 256, 160*chunkBytes);    // Room for the ring, the hysteresis around it and a few more
+
+    int reused = 0, mostEntries = 0;
+    size_t mostBytes = 0;
+    for (int frame = 0; frame < frames; frame++) {
+        // Loops over the same ground now and then, so some chunks come back before they are evicted
+        float t = frame*0.0005f;
+        IVector2 center = { (int)(60.0f*sinf(t)), (int)(40.0f*sinf(2.3f*t)) };
+
+        for (int i = 0; i < cache.entryCount; i++) {
+            ChunkEntry *entry = &cache.entries[i];
+            bool nearby = (abs(entry->chunkID.x - center.x) <= radius + hysteresis) && (abs(entry->chunkID.y - center.y) <= radius + hysteresis);
+            if (!nearby && (entry->state == CHUNK_RESIDENT)) entry->state = CHUNK_EVICTING;
+        }
+        for (int dx = -radius; dx <= radius; dx++) {
+            for (int dz = -radius; dz <= radius; dz++) {
+                IVector2 chunkID = { center.x + dx, center.y + dz };
+                ChunkEntry *entry = GetChunkEntry(&cache, chunkID);
+                if (entry == NULL) {
+                    entry = AddChunkEntry(&cache, chunkID);
+                    if (entry == NULL) continue;
+                    entry->chunk.chunkID = chunkID;
+                    entry->chunk.textureLevel = -1;
+                    entry->chunk.heightfield = (Heightfield){ .samplesX = BENCH_SAMPLES, .samplesZ = BENCH_SAMPLES, .stride = BENCH_SAMPLES };
+                    entry->chunk.heightfield.heights = (float *)RL_CALLOC(BENCH_SAMPLES*BENCH_SAMPLES, sizeof(float));
+                    cache.loadCount++;
+                } else if (entry->state == CHUNK_EVICTING) reused++;
+                entry->state = CHUNK_RESIDENT;
+                entry->lastVisible = frame;
+            }
+        }
+
+        UpdateChunkCacheBytes(&cache);
+        EvictChunks(&cache, (2*radius + 1)*(2*radius + 1));
+        if (cache.entryCount > mostEntries) mostEntries = cache.entryCount;
+        if (cache.cpuBytes + cache.gpuBytes > mostBytes) mostBytes = cache.cpuBytes + cache.gpuBytes;
+    }
+
+    // Lookups of the chunks around the camera, as the ground and collision queries make them
+    const int lookups = 4000000;
+    int found = 0;
+    double start = GetMonotonicTime();
+    for (int i = 0; i < lookups; i++) {
+        IVector2 chunkID = { (int)(60.0f*sinf(frames*0.0005f)) + (i%13) - 6, (int)(40.0f*sinf(2.3f*frames*0.0005f)) + (i/13)%13 - 6 };
+        found += (GetChunkEntry(&cache, chunkID) != NULL);
+    }
+    double lookupTime = (GetMonotonicTime() - start)/lookups;
+    benchSink += (float)found;
+
+    printf("chunkcache: %i frames   %i chunks loaded, %i back before eviction, %i evicted   at most %i entries and %.1f MB after eviction (budget %.1f MB)   %.1f ns/lookup\n",
+           frames, cache.loadCount, reused, cache.evictionCount, mostEntries, mostBytes/1048576.0, cache.budget/1048576.0, lookupTime*1e9);
+
+    UnloadChunkCache(&cache);
+}
+
+typedef struct BenchSuite {
+    const char *name;
+    void (*run)(void);
+} BenchSuite;
+
+static const BenchSuite suites[] = {
+    { "heightfield", BenchHeightfield },
+    { "lod", BenchLod },
+    { "rtin", BenchRtin },
+    { "cull", BenchCull },
+    { "render", BenchRender },
+    { "sky", BenchSky },
+    { "terraingen", BenchTerrainGen },
+    { "mesher", BenchMesher },
+    { "collision", BenchCollision },
+    { "chunkcache", BenchChunkCache },
+};
+
+int main(int argc, char *argv[])
+{
+    SetTraceLogLevel(LOG_WARNING);
+    srand(1234);    // Same points and rays every run
+
+    int suiteCount = sizeof(suites)/sizeof(suites[0]);
+    for (int i = 0; i < suiteCount; i++) {
+        bool selected = (argc < 2);
+        for (int arg = 1; arg < argc; arg++) selected |= (strcmp(argv[arg], suites[i].name) == 0);
+        if (selected) suites[i].run();
+    }
+
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include "profiler.h"
+
+#if defined(ENABLE_PROFILER)
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_MSC_VER)
+    #define THREAD_LOCAL __declspec(thread)
+#else
+    #define THREAD_LOCAL __thread
+#endif
+
+typedef struct ProfileEvent {
+    const char *name;
+    double start;
+    double end;
+    int depth;
+} ProfileEvent;
+
+typedef struct ProfileRing {
+    ProfileEvent events[PROFILER_RING_EVENTS];
+    unsigned int head;                  // Events written so far, only the owning thread writes it
+    unsigned int consumed;              // Events summed into frames so far, main thread only
+    const char *threadName;
+    int threadID;
+    const char *openNames[PROFILER_MAX_DEPTH];  // Zones begun but not ended yet
+    double openStarts[PROFILER_MAX_DEPTH];
+    int depth;
+} ProfileRing;
+
+typedef struct ProfileFrame {
+    double start;
+    double end;
+    long long counters[PROFILE_COUNTER_COUNT];
+    float zoneTimes[PROFILER_MAX_ZONES];    // Seconds in each zone, summed over every thread
+} ProfileFrame;
+
+static ProfileRing *rings[PROFILER_MAX_THREADS];
+static int ringCount;
+static THREAD_LOCAL ProfileRing *threadRing;
+static THREAD_LOCAL bool threadRegistered;
+
+static long long counters[PROFILE_COUNTER_COUNT];
+static const char *counterNames[PROFILE_COUNTER_COUNT] = { "draw calls", "triangles", "upload bytes", "chunk loads", "texture bytes" };
+
+// Main thread only
+static ProfileFrame frames[PROFILER_HISTORY];
+static int frameCount;                  // Frames closed so far
+static double frameStart;
+static const char *zoneNames[PROFILER_MAX_ZONES];
+static int zoneCount;
+
+static ProfileRing *GetThreadRing(void) {
+    if (threadRegistered) return threadRing;
+    threadRegistered = true;
+
+    int index = __atomic_fetch_add(&ringCount, 1, __ATOMIC_RELAXED);
+    if (index >= PROFILER_MAX_THREADS) return NULL;
+
+    ProfileRing *ring = (ProfileRing *)calloc(1, sizeof(ProfileRing));
+    ring->threadID = index + 1;
+    ring->threadName = "thread";
+    __atomic_store_n(&rings[index], ring, __ATOMIC_RELEASE);
+    threadRing = ring;
+    return ring;
+}
+
+void SetProfilerThreadName(const char *name) {
+    ProfileRing *ring = GetThreadRing();
+    if (ring != NULL) ring->threadName = name;
+}
+
+void BeginProfileZone(const char *name) {
+    ProfileRing *ring = GetThreadRing();
+    if (ring == NULL) return;
+    if (ring->depth < PROFILER_MAX_DEPTH) {
+        ring->openNames[ring->depth] = name;
+        ring->openStarts[ring->depth] = GetTime();
+    }
+    ring->depth++;
+}
+
+void EndProfileZone(void) {
+    ProfileRing *ring = GetThreadRing();
+    if ((ring == NULL) || (ring->depth == 0)) return;
+    ring->depth--;
+    if (ring->depth >= PROFILER_MAX_DEPTH) return;
+
+    ProfileEvent event = { ring->openNames[ring->depth], ring->openStarts[ring->depth], GetTime(), ring->depth };
+    unsigned int head = ring->head;
+    ring->events[head%PROFILER_RING_EVENTS] = event;
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+void AddProfileCount(ProfileCounter counter, long long value) {
+    __atomic_fetch_add(&counters[counter], value, __ATOMIC_RELAXED);
+}
+
+// Copy the events of a ring from first on into events, returns how many are left once the
+// ones the writer may have overwritten meanwhile are dropped. *first moves to the oldest
+// event copied.
+static int ReadRing(ProfileRing *ring, unsigned int *first, ProfileEvent *events) {
+    unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (head - *first > PROFILER_RING_EVENTS) *first = head - PROFILER_RING_EVENTS;
+    for (unsigned int i = *first; i != head; i++) events[i - *first] = ring->events[i%PROFILER_RING_EVENTS];
+
+    // The writer may be in the middle of the slot after its head, which holds the oldest event
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    unsigned int newHead = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    unsigned int count = head - *first;
+    unsigned int dropped = 0;
+    if (newHead - *first >= PROFILER_RING_EVENTS) dropped = newHead - *first - PROFILER_RING_EVENTS + 1;
+    if (dropped > count) dropped = count;
+
+    count -= dropped;
+    for (unsigned int i = 0; i < count; i++) events[i] = events[i + dropped];
+    *first += dropped;
+    return (int)count;
+}
+
+static int GetZoneIndex(const char *name) {
+    for (int i = 0; i < zoneCount; i++) {
+        if (zoneNames[i] == name) return i;
+    }
+    if (zoneCount == PROFILER_MAX_ZONES) return -1;
+    zoneNames[zoneCount] = name;
+    return zoneCount++;
+}
+
+void EndProfileFrame(void) {
+    static ProfileEvent events[PROFILER_RING_EVENTS];
+    double now = GetTime();
+    ProfileFrame *frame = &frames[frameCount%PROFILER_HISTORY];
+    *frame = (ProfileFrame){ 0 };
+    frame->start = (frameCount > 0)? frameStart : 0.0;     // The first frame covers loading
+    frame->end = now;
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) frame->counters[c] = __atomic_exchange_n(&counters[c], 0, __ATOMIC_RELAXED);
+
+    // Every zone that ended since the last frame, on any thread, counts towards this one
+    int threads = __atomic_load_n(&ringCount, __ATOMIC_RELAXED);
+    if (threads > PROFILER_MAX_THREADS) threads = PROFILER_MAX_THREADS;
+    for (int t = 0; t < threads; t++) {
+        ProfileRing *ring = __atomic_load_n(&rings[t], __ATOMIC_ACQUIRE);
+        if (ring == NULL) continue;
+        int count = ReadRing(ring, &ring->consumed, events);
+        for (int i = 0; i < count; i++) {
+            int zone = GetZoneIndex(events[i].name);
+            if (zone >= 0) frame->zoneTimes[zone] += (float)(events[i].end - events[i].start);
+        }
+        ring->consumed += count;
+    }
+
+    frameStart = now;
+    frameCount++;
+}
+
+// One row of the overlay: label, average over the frames shown and a bar per frame, scaled
+// to the largest of them
+static void DrawOverlayRow(int x, int y, const char *label, const float *values, int count, const char *unit, float scale, Color color) {
+    const int barWidth = 2, graphHeight = 20, graphX = x + 200;
+    float largest = 0.0f, sum = 0.0f;
+    for (int i = 0; i < count; i++) {
+        largest = (values[i] > largest)? values[i] : largest;
+        sum += values[i];
+    }
+
+    DrawText(TextFormat("%-16s %8.2f %s", label, (count > 0)? sum*scale/count : 0.0f, unit), x, y + 6, 10, RAYWHITE);
+    DrawRectangleLines(graphX - 1, y - 1, PROFILER_OVERLAY_FRAMES*barWidth + 2, graphHeight + 2, GRAY);
+    for (int i = 0; i < count; i++) {
+        int height = (largest > 0.0f)? (int)(graphHeight*values[i]/largest) : 0;
+        DrawRectangle(graphX + i*barWidth, y + graphHeight - height, barWidth, height, color);
+    }
+    DrawText(TextFormat("max %.2f", largest*scale), graphX + PROFILER_OVERLAY_FRAMES*barWidth + 6, y + 6, 10, LIGHTGRAY);
+}
+
+void DrawProfilerOverlay(int x, int y) {
+    int count = (frameCount < PROFILER_OVERLAY_FRAMES)? frameCount : PROFILER_OVERLAY_FRAMES;
+    int rows = 1 + zoneCount + PROFILE_COUNTER_COUNT;
+    const int rowHeight = 24;
+    DrawRectangle(x, y, 200 + PROFILER_OVERLAY_FRAMES*2 + 80, rows*rowHeight + 8, Fade(BLACK, 0.7f));
+    x += 6;
+    y += 6;
+
+    float values[PROFILER_OVERLAY_FRAMES];
+    for (int i = 0; i < count; i++) {
+        const ProfileFrame *frame = &frames[(frameCount - count + i)%PROFILER_HISTORY];
+        values[i] = (float)(frame->end - frame->start);
+    }
+    DrawOverlayRow(x, y, "frame", values, count, "ms", 1000.0f, ORANGE);
+    y += rowHeight;
+
+    for (int zone = 0; zone < zoneCount; zone++) {
+        for (int i = 0; i < count; i++) values[i] = frames[(frameCount - count + i)%PROFILER_HISTORY].zoneTimes[zone];
+        DrawOverlayRow(x, y, zoneNames[zone], values, count, "ms", 1000.0f, LIME);
+        y += rowHeight;
+    }
+
+    for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+        for (int i = 0; i < count; i++) values[i] = (float)frames[(frameCount - count + i)%PROFILER_HISTORY].counters[c];
+        bool bytes = (c == PROFILE_UPLOAD_BYTES) || (c == PROFILE_TEXTURE_BYTES);
+        DrawOverlayRow(x, y, counterNames[c], values, count, bytes? "KB" : "", bytes? 1.0f/1024.0f : 1.0f, SKYBLUE);
+        y += rowHeight;
+    }
+}
+
+bool SaveProfilerTrace(const char *fileName, int frameLimit) {
+    static ProfileEvent events[PROFILER_RING_EVENTS];
+    int count = (frameCount < frameLimit)? frameCount : frameLimit;
+    if (count > PROFILER_HISTORY) count = PROFILER_HISTORY;
+    if (count == 0) return false;
+    double since = frames[(frameCount - count)%PROFILER_HISTORY].start;
+
+    FILE *file = fopen(fileName, "w");
+    if (file == NULL) {
+        TraceLog(LOG_WARNING, "PROFILER: Failed to write %s", fileName);
+        return false;
+    }
+
+    // Timestamps in microseconds, as trace events expect
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Graphics Test\"}}");
+
+    int threads = __atomic_load_n(&ringCount, __ATOMIC_RELAXED);
+    if (threads > PROFILER_MAX_THREADS) threads = PROFILER_MAX_THREADS;
+    for (int t = 0; t < threads; t++) {
+        ProfileRing *ring = __atomic_load_n(&rings[t], __ATOMIC_ACQUIRE);
+        if (ring == NULL) continue;
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%i,\"args\":{\"name\":\"%s %i\"}}", ring->threadID, ring->threadName, ring->threadID);
+
+        unsigned int first = 0;
+        int eventCount = ReadRing(ring, &first, events);
+        for (int i = 0; i < eventCount; i++) {
+            if (events[i].start < since) continue;
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%i,\"ts\":%.3f,\"dur\":%.3f}",
+                    events[i].name, ring->threadID, events[i].start*1e6, (events[i].end - events[i].start)*1e6);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        const ProfileFrame *frame = &frames[(frameCount - count + i)%PROFILER_HISTORY];
+        for (int c = 0; c < PROFILE_COUNTER_COUNT; c++) {
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"value\":%lld}}", counterNames[c], frame->start*1e6, frame->counters[c]);
+        }
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    TraceLog(LOG_INFO, "PROFILER: Saved the last %i frames to %s", count, fileName);
+    return true;
+}
+
+void CloseProfiler(void) {
+    int threads = __atomic_load_n(&ringCount, __ATOMIC_RELAXED);
+    if (threads > PROFILER_MAX_THREADS) threads = PROFILER_MAX_THREADS;
+    for (int t = 0; t < threads; t++) {
+        free(rings[t]);
+        rings[t] = NULL;
+    }
+    ringCount = 0;
+    threadRing = NULL;
+    threadRegistered = false;
+}
+
+#endif // ENABLE_PROFILER
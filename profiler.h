@@ -0,0 +1,77 @@
+/*******************************************************************************************
+*
+*   profiler - Scoped CPU timers, frame counters, an overlay and Chrome trace export
+*
+*   Only built when ENABLE_PROFILER is defined (make PROFILER=1). Otherwise every PROFILE_
+*   macro expands to nothing and profiler.c is empty, so the instrumentation costs nothing.
+*
+*   PROFILE_BEGIN(name) and PROFILE_END() time the code between them on the calling thread.
+*   Names have to be string literals, zones are told apart by the address of their name. Zones
+*   nest up to PROFILER_MAX_DEPTH deep.
+*
+*   Each thread writes its zones into a ring buffer of its own, so recording never takes a
+*   lock: the thread is the only writer and publishes each event by advancing the ring's head
+*   with a release store. The main thread reads the rings without stopping the writers and
+*   drops whatever may have been overwritten while it was reading.
+*
+*   PROFILE_COUNT() adds to one of the frame counters, from any thread. PROFILE_FRAME() closes
+*   the frame on the main thread: it sums the time of every zone over all threads and keeps
+*   it with the counters for the last PROFILER_HISTORY frames. PROFILE_DRAW_OVERLAY() shows
+*   them as rolling histograms, PROFILE_SAVE_TRACE() writes the zones and counters of the last
+*   frames as Chrome trace events, to open in chrome://tracing or ui.perfetto.dev.
+*
+*   The rings use the GCC and Clang __atomic builtins.
+*
+********************************************************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "raylib.h"
+
+#define PROFILER_MAX_THREADS 32         // Threads past this many are not recorded
+#define PROFILER_MAX_DEPTH 16           // Deeper zones are not recorded
+#define PROFILER_MAX_ZONES 32           // Distinct zone names shown in the overlay
+#define PROFILER_RING_EVENTS 16384      // Zones kept per thread
+#define PROFILER_HISTORY 600            // Frames kept for the overlay and the trace
+#define PROFILER_OVERLAY_FRAMES 120     // Frames shown in each overlay histogram
+
+typedef enum {
+    PROFILE_DRAW_CALLS = 0,
+    PROFILE_TRIANGLES,
+    PROFILE_UPLOAD_BYTES,               // Mesh, texture and atlas data sent to the GPU
+    PROFILE_CHUNK_LOADS,                // Chunks uploaded
+    PROFILE_TEXTURE_BYTES,              // Chunk ground textures resident on the GPU, counted once per frame
+    PROFILE_COUNTER_COUNT
+} ProfileCounter;
+
+#if defined(ENABLE_PROFILER)
+    #define PROFILE_THREAD(name)                    SetProfilerThreadName(name)
+    #define PROFILE_BEGIN(name)                     BeginProfileZone(name)
+    #define PROFILE_END()                           EndProfileZone()
+    #define PROFILE_COUNT(counter, value)           AddProfileCount(counter, value)
+    #define PROFILE_FRAME()                         EndProfileFrame()
+    #define PROFILE_DRAW_OVERLAY(x, y)              DrawProfilerOverlay(x, y)
+    #define PROFILE_SAVE_TRACE(fileName, frames)    SaveProfilerTrace(fileName, frames)
+    #define PROFILE_CLOSE()                         CloseProfiler()
+
+void SetProfilerThreadName(const char *name);           // Name the calling thread in traces
+void BeginProfileZone(const char *name);
+void EndProfileZone(void);
+void AddProfileCount(ProfileCounter counter, long long value);
+void EndProfileFrame(void);                             // Main thread only, once per frame
+void DrawProfilerOverlay(int x, int y);                 // Inside BeginDrawing()
+bool SaveProfilerTrace(const char *fileName, int frames);   // Chrome trace event JSON of the last frames
+void CloseProfiler(void);                               // Once no other thread records any more
+#else
+    #define PROFILE_THREAD(name)                    ((void)0)
+    #define PROFILE_BEGIN(name)                     ((void)0)
+    #define PROFILE_END()                           ((void)0)
+    #define PROFILE_COUNT(counter, value)           ((void)0)
+    #define PROFILE_FRAME()                         ((void)0)
+    #define PROFILE_DRAW_OVERLAY(x, y)              ((void)0)
+    #define PROFILE_SAVE_TRACE(fileName, frames)    ((void)0)
+    #define PROFILE_CLOSE()                         ((void)0)
+#endif
+
+#endif // PROFILER_H
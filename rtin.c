@@ -0,0 +1,233 @@
+#include "rtin.h"
+#include "terrainmesh.h"
+#include <float.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cells along a side, 0 unless the heightfield has 2^k + 1 samples on both sides
+static int GetRtinTileSize(const Heightfield *heightfield) {
+    int tileSize = heightfield->samplesX - 1;
+    if ((heightfield->heights == NULL) || (heightfield->samplesZ != heightfield->samplesX)) return 0;
+    if ((tileSize < 1) || ((tileSize & (tileSize - 1)) != 0)) return 0;
+    return tileSize;
+}
+
+static float GetSample(const Heightfield *heightfield, int x, int z) {
+    return heightfield->heights[z*heightfield->stride + x];
+}
+
+float *LoadHeightfieldRtinErrors(const Heightfield *heightfield, Arena *arena) {
+    int tileSize = GetRtinTileSize(heightfield);
+    if (tileSize == 0) return NULL;
+
+    int size = tileSize + 1;
+    int triangleCount = 2*tileSize*tileSize - 2;        // Every triangle of the hierarchy except the two roots
+    int parentCount = triangleCount - tileSize*tileSize;   // Triangles that are split further
+
+    // Hypotenuse end points of each triangle. Triangle i has id i + 2: the lowest bit picks
+    // the root, every following bit picks the left or right half, most significant first.
+    //--------------------------------------------------------------
+    int *coords = (int *)MemAllocArena(arena, triangleCount*4*sizeof(int));
+    for (int i = 0; i < triangleCount; i++) {
+        int id = i + 2;
+        int ax = 0, ay = 0, bx = 0, by = 0, cx = 0, cy = 0;
+        if (id & 1) { bx = by = cx = tileSize; }
+        else { ax = ay = cy = tileSize; }
+
+        while ((id >>= 1) > 1) {
+            int mx = (ax + bx) >> 1;
+            int my = (ay + by) >> 1;
+            if (id & 1) {
+                bx = ax; by = ay;
+                ax = cx; ay = cy;
+            } else {
+                ax = bx; ay = by;
+                bx = cx; by = cy;
+            }
+            cx = mx; cy = my;
+        }
+
+        coords[i*4] = ax; coords[i*4 + 1] = ay;
+        coords[i*4 + 2] = bx; coords[i*4 + 3] = by;
+    }
+
+    // Border samples start at FLT_MAX, which the propagation below hands up to every
+    // triangle above them, so extraction always reaches full resolution along the borders
+    //--------------------------------------------------------------
+    float *errors = (float *)MemAllocArena(arena, size*size*sizeof(float));
+    memset(errors, 0, size*size*sizeof(float));
+    for (int i = 0; i < size; i++) {
+        errors[i] = FLT_MAX;
+        errors[tileSize*size + i] = FLT_MAX;
+        errors[i*size] = FLT_MAX;
+        errors[i*size + tileSize] = FLT_MAX;
+    }
+
+    // Smallest triangles first, so each midpoint can take the largest error of its children
+    //--------------------------------------------------------------
+    for (int i = triangleCount - 1; i >= 0; i--) {
+        int ax = coords[i*4], ay = coords[i*4 + 1];
+        int bx = coords[i*4 + 2], by = coords[i*4 + 3];
+        int mx = (ax + bx) >> 1;
+        int my = (ay + by) >> 1;
+        int cx = mx + my - ay;
+        int cy = my + ax - mx;
+
+        int middle = my*size + mx;
+        float interpolated = 0.5f*(GetSample(heightfield, ax, ay) + GetSample(heightfield, bx, by));
+        float error = fmaxf(errors[middle], fabsf(interpolated - GetSample(heightfield, mx, my)));
+
+        if (i < parentCount) {
+            int left = ((ay + cy) >> 1)*size + ((ax + cx) >> 1);
+            int right = ((by + cy) >> 1)*size + ((bx + cx) >> 1);
+            error = fmaxf(error, fmaxf(errors[left], errors[right]));
+        }
+        errors[middle] = error;
+    }
+
+    MemFreeArena(arena, coords);
+
+    return errors;
+}
+
+void UnloadHeightfieldRtinErrors(float *errors) {
+    RL_FREE(errors);
+}
+
+typedef struct RtinBuilder {
+    const Heightfield *heightfield;
+    const float *errors;
+    float maxError;
+    int size;
+    int *vertexIndex;           // Mesh vertex of each sample, -1 until it is used
+    Mesh mesh;
+} RtinBuilder;
+
+static unsigned short AddRtinVertex(RtinBuilder *builder, int x, int z) {
+    const Heightfield *heightfield = builder->heightfield;
+    int sample = z*builder->size + x;
+    if (builder->vertexIndex[sample] >= 0) return (unsigned short)builder->vertexIndex[sample];
+
+    Mesh *mesh = &builder->mesh;
+    int v = mesh->vertexCount++;
+    Vector3 normal = GetHeightfieldSampleNormal(heightfield, x, z, 1);
+
+    mesh->vertices[v*3] = x*heightfield->cellSizeX;
+    mesh->vertices[v*3 + 1] = GetSample(heightfield, x, z);
+    mesh->vertices[v*3 + 2] = z*heightfield->cellSizeZ;
+    mesh->normals[v*3] = normal.x;
+    mesh->normals[v*3 + 1] = normal.y;
+    mesh->normals[v*3 + 2] = normal.z;
+    mesh->texcoords[v*2] = (float)x/(heightfield->samplesX - 1);
+    mesh->texcoords[v*2 + 1] = (float)z/(heightfield->samplesZ - 1);
+
+    builder->vertexIndex[sample] = v;
+    return (unsigned short)v;
+}
+
+// Split the triangle with hypotenuse a-b and right angle at c while its midpoint error is
+// too large, otherwise emit it
+static void AddRtinTriangle(RtinBuilder *builder, int ax, int az, int bx, int bz, int cx, int cz) {
+    int mx = (ax + bx) >> 1;
+    int mz = (az + bz) >> 1;
+
+    if ((abs(ax - cx) + abs(az - cz) > 1) && (builder->errors[mz*builder->size + mx] > builder->maxError)) {
+        AddRtinTriangle(builder, cx, cz, ax, az, mx, mz);
+        AddRtinTriangle(builder, bx, bz, cx, cz, mx, mz);
+        return;
+    }
+
+    // Half the triangles come out clockwise when seen from above, swap those so every face
+    // points up like the grid meshes
+    if ((bz - az)*(cx - ax) - (bx - ax)*(cz - az) < 0) {
+        int tx = bx, tz = bz;
+        bx = cx; bz = cz;
+        cx = tx; cz = tz;
+    }
+
+    Mesh *mesh = &builder->mesh;
+    int i = mesh->triangleCount*3;
+    mesh->indices[i] = AddRtinVertex(builder, ax, az);
+    mesh->indices[i + 1] = AddRtinVertex(builder, bx, bz);
+    mesh->indices[i + 2] = AddRtinVertex(builder, cx, cz);
+    mesh->triangleCount++;
+}
+
+Mesh GenHeightfieldRtinMesh(const Heightfield *heightfield, const float *errors, float maxError, Arena *arena) {
+    int tileSize = GetRtinTileSize(heightfield);
+    if ((tileSize == 0) || (errors == NULL)) return (Mesh){ 0 };
+
+    int size = tileSize + 1;
+    RtinBuilder builder = { 0 };
+    builder.heightfield = heightfield;
+    builder.errors = errors;
+    builder.maxError = maxError;
+    builder.size = size;
+    builder.vertexIndex = (int *)MemAllocArena(arena, size*size*sizeof(int));
+    memset(builder.vertexIndex, 0xff, size*size*sizeof(int));
+
+    // Sized for the full resolution mesh, trimmed once the real counts are known unless the
+    // memory belongs to an arena
+    int maxVertices = size*size;
+    int maxTriangles = 2*tileSize*tileSize;
+    builder.mesh.vertices = (float *)MemAllocArena(arena, maxVertices*3*sizeof(float));
+    builder.mesh.normals = (float *)MemAllocArena(arena, maxVertices*3*sizeof(float));
+    builder.mesh.texcoords = (float *)MemAllocArena(arena, maxVertices*2*sizeof(float));
+    builder.mesh.indices = (unsigned short *)MemAllocArena(arena, maxTriangles*3*sizeof(unsigned short));
+
+    AddRtinTriangle(&builder, 0, 0, tileSize, tileSize, tileSize, 0);
+    AddRtinTriangle(&builder, tileSize, tileSize, 0, 0, 0, tileSize);
+
+    MemFreeArena(arena, builder.vertexIndex);
+
+    Mesh mesh = builder.mesh;
+    if (arena != NULL) return mesh;
+    mesh.vertices = (float *)RL_REALLOC(mesh.vertices, mesh.vertexCount*3*sizeof(float));
+    mesh.normals = (float *)RL_REALLOC(mesh.normals, mesh.vertexCount*3*sizeof(float));
+    mesh.texcoords = (float *)RL_REALLOC(mesh.texcoords, mesh.vertexCount*2*sizeof(float));
+    mesh.indices = (unsigned short *)RL_REALLOC(mesh.indices, mesh.triangleCount*3*sizeof(unsigned short));
+
+    return mesh;
+}
+
+float GetHeightfieldRtinMeshError(const Heightfield *heightfield, Mesh mesh) {
+    if ((heightfield->heights == NULL) || (mesh.vertices == NULL) || (mesh.indices == NULL)) return 0.0f;
+
+    // Walk the samples under each triangle and compare them against the plane through it
+    float maxError = 0.0f;
+    for (int t = 0; t < mesh.triangleCount; t++) {
+        float px[3], pz[3], ph[3];
+        for (int k = 0; k < 3; k++) {
+            const float *vertex = &mesh.vertices[mesh.indices[t*3 + k]*3];
+            px[k] = vertex[0]/heightfield->cellSizeX;
+            ph[k] = vertex[1];
+            pz[k] = vertex[2]/heightfield->cellSizeZ;
+        }
+
+        float area = (px[1] - px[0])*(pz[2] - pz[0]) - (px[2] - px[0])*(pz[1] - pz[0]);
+        if (fabsf(area) < 1e-6f) continue;
+
+        int x0 = (int)floorf(fminf(px[0], fminf(px[1], px[2])) + 0.5f), x1 = (int)floorf(fmaxf(px[0], fmaxf(px[1], px[2])) + 0.5f);
+        int z0 = (int)floorf(fminf(pz[0], fminf(pz[1], pz[2])) + 0.5f), z1 = (int)floorf(fmaxf(pz[0], fmaxf(pz[1], pz[2])) + 0.5f);
+        if (x0 < 0) x0 = 0;
+        if (z0 < 0) z0 = 0;
+        if (x1 > heightfield->samplesX - 1) x1 = heightfield->samplesX - 1;
+        if (z1 > heightfield->samplesZ - 1) z1 = heightfield->samplesZ - 1;
+
+        for (int z = z0; z <= z1; z++) {
+            for (int x = x0; x <= x1; x++) {
+                float w1 = ((x - px[0])*(pz[2] - pz[0]) - (px[2] - px[0])*(z - pz[0]))/area;
+                float w2 = ((px[1] - px[0])*(z - pz[0]) - (x - px[0])*(pz[1] - pz[0]))/area;
+                float w0 = 1.0f - w1 - w2;
+                if ((w0 < -1e-4f) || (w1 < -1e-4f) || (w2 < -1e-4f)) continue;
+
+                float h = w0*ph[0] + w1*ph[1] + w2*ph[2];
+                float error = fabsf(GetSample(heightfield, x, z) - h);
+                if (error > maxError) maxError = error;
+            }
+        }
+    }
+
+    return maxError;
+}
@@ -0,0 +1,36 @@
+/*******************************************************************************************
+*
+*   rtin - Adaptive ground meshes from a right-triangulated irregular network
+*
+*   A square heightfield of 2^k + 1 samples is covered by two right triangles, and every
+*   triangle can be split in two through the midpoint of its hypotenuse, down to single
+*   cells. LoadHeightfieldRtinErrors() computes, for every sample that is such a midpoint,
+*   the largest vertical error of skipping it or anything below it. GenHeightfieldRtinMesh()
+*   then splits only where that error is above maxError, so flat ground ends up with a few
+*   large triangles and rough ground keeps its full detail. The midpoint errors are measured
+*   along hypotenuses, a sample can land slightly further from the surface across the face of
+*   a triangle, GetHeightfieldRtinMeshError() measures the real distance.
+*
+*   Splits through a shared hypotenuse happen on both sides of it, so the mesh has no
+*   T-junctions. Border samples are always kept: every mesh of every chunk has the same edge
+*   vertices, so neighbours at any error meet exactly and need no skirt.
+*
+*   The diagonals do not follow the heightfield's cell split, so ground queries can differ
+*   from the drawn surface by up to maxError. Nothing is uploaded, so meshes can be built on
+*   worker threads, into an arena the same way as GenHeightfieldMesh().
+*
+********************************************************************************************/
+
+#ifndef RTIN_H
+#define RTIN_H
+
+#include "raylib.h"
+#include "heightfield.h"
+#include "arena.h"
+
+float *LoadHeightfieldRtinErrors(const Heightfield *heightfield, Arena *arena);     // Midpoint errors, NULL unless the heightfield is square with 2^k + 1 samples
+void UnloadHeightfieldRtinErrors(float *errors);                                    // Only for errors loaded without an arena
+Mesh GenHeightfieldRtinMesh(const Heightfield *heightfield, const float *errors, float maxError, Arena *arena);   // Mesh whose vertical error stays under maxError, borders at full resolution
+float GetHeightfieldRtinMeshError(const Heightfield *heightfield, Mesh mesh);   // Largest vertical distance between the samples and the mesh triangles over them
+
+#endif // RTIN_H
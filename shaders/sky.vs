@@ -1,22 +1,17 @@
 #version 330
-precision mediump float;
 
 in vec3 vertexPosition;
-in vec2 vertexTexCoord;
-in vec3 vertexNormal;
-in vec4 vertexColor;
-in vec4 vertexTangent;
-in vec2 vertexTexCoord2;
 
-uniform mat4 matNormal;
 uniform mat4 matView;
 uniform mat4 matProjection;
 
-out vec3 vWorldPosition;
+out vec3 vDirection;
 
 void main()
 {
-	vec4 worldPosition = matNormal * vec4(vertexPosition, 1.0);
-	vWorldPosition = worldPosition.xyz;
-	gl_Position = matProjection * matView * vec4(vertexPosition, 1.0);
+	// The sky is infinitely far away: only the camera rotation applies, and the cube is
+	// pushed onto the far plane so anything drawn before it stays in front
+	vDirection = vertexPosition;
+	vec4 clipPosition = matProjection * mat4(mat3(matView)) * vec4(vertexPosition, 1.0);
+	gl_Position = clipPosition.xyww;
 }
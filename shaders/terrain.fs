@@ -0,0 +1,21 @@
+#version 330
+
+in vec2 fragTexCoord;
+in vec3 fragNormal;
+flat in int fragLayer;
+
+uniform sampler2DArray colorLayers;     // Ground colour, one layer per atlas tile
+uniform vec4 colDiffuse;
+uniform vec3 sunDirection;      // Towards the sun, normalized
+
+const float ambient = 0.45;     // Share of the light that does not depend on the sun, keeps slopes facing away readable
+
+// Output fragment color
+out vec4 finalColor;
+
+void main()
+{
+    float light = ambient + (1.0 - ambient)*max(dot(normalize(fragNormal), sunDirection), 0.0);
+    vec4 color = texture(colorLayers, vec3(fragTexCoord, float(fragLayer)))*colDiffuse;
+    finalColor = vec4(color.rgb*light, color.a);
+}
@@ -0,0 +1,48 @@
+#version 330
+
+// Input vertex attributes, x and z are height sample indices and y is -1 on skirt vertices
+in vec3 vertexPosition;
+in mat4 instanceTransform;      // Translation to the chunk origin
+
+// Input uniform values
+uniform mat4 mvp;
+uniform sampler2D heightAtlas;  // One tile of heights per resident chunk, in world units
+uniform int samples;            // Height samples along a tile edge
+uniform int apron;              // Neighbour samples around each tile, on every side
+uniform int atlasTiles;         // Tiles along an atlas edge, a chunk uses tile chunk ID mod atlasTiles
+uniform float chunkSize;
+uniform float skirtDepth;
+uniform int lodStep;            // Sample step of the grid being drawn
+
+// Output vertex attributes (to fragment shader)
+out vec2 fragTexCoord;
+out vec3 fragNormal;            // World space, chunks are only ever translated
+flat out int fragLayer;         // Colour layer of the chunk
+
+// Sample (0, 0) of the tile is at tileOrigin, the apron around it goes from -apron to samples - 1 + apron
+float GetHeight(ivec2 tileOrigin, ivec2 sample)
+{
+    return texelFetch(heightAtlas, tileOrigin + clamp(sample, ivec2(-apron), ivec2(samples - 1 + apron)), 0).r;
+}
+
+void main()
+{
+    ivec2 chunkID = ivec2(floor(instanceTransform[3].xz/chunkSize + 0.5));
+    ivec2 tile = ((chunkID % atlasTiles) + atlasTiles) % atlasTiles;
+    ivec2 tileOrigin = tile*(samples + 2*apron) + apron;
+    ivec2 sample = ivec2(vertexPosition.xz);
+    float cellSize = chunkSize/float(samples - 1);
+
+    // Smooth normal from the samples lodStep away, clamped to the apron the same as GenHeightfieldMesh()
+    ivec2 low = max(sample - lodStep, ivec2(-apron));
+    ivec2 high = min(sample + lodStep, ivec2(samples - 1 + apron));
+    float slopeX = (GetHeight(tileOrigin, ivec2(high.x, sample.y)) - GetHeight(tileOrigin, ivec2(low.x, sample.y)))/(float(high.x - low.x)*cellSize);
+    float slopeZ = (GetHeight(tileOrigin, ivec2(sample.x, high.y)) - GetHeight(tileOrigin, ivec2(sample.x, low.y)))/(float(high.y - low.y)*cellSize);
+    fragNormal = normalize(vec3(-slopeX, 1.0, -slopeZ));
+
+    fragTexCoord = vec2(sample)/float(samples - 1);
+    fragLayer = tile.y*atlasTiles + tile.x;
+
+    vec3 position = vec3(float(sample.x)*cellSize, GetHeight(tileOrigin, sample) + vertexPosition.y*skirtDepth, float(sample.y)*cellSize);
+    gl_Position = mvp*instanceTransform*vec4(position, 1.0);
+}
@@ -0,0 +1,28 @@
+#version 330
+
+// Upscales the scene render target to the screen. The bilinear fetch softens the image, so
+// it is sharpened against its four neighbours, clamped to their range to avoid halos.
+
+in vec2 fragTexCoord;
+in vec4 fragColor;
+
+uniform sampler2D texture0;
+uniform vec2 texelSize;         // One texel of texture0, in texture coordinates
+uniform float sharpness;        // 0 at native resolution
+
+out vec4 finalColor;
+
+void main()
+{
+	vec3 center = texture(texture0, fragTexCoord).rgb;
+	vec3 north = texture(texture0, fragTexCoord + vec2(0.0, texelSize.y)).rgb;
+	vec3 south = texture(texture0, fragTexCoord - vec2(0.0, texelSize.y)).rgb;
+	vec3 east = texture(texture0, fragTexCoord + vec2(texelSize.x, 0.0)).rgb;
+	vec3 west = texture(texture0, fragTexCoord - vec2(texelSize.x, 0.0)).rgb;
+
+	vec3 minColor = min(center, min(min(north, south), min(east, west)));
+	vec3 maxColor = max(center, max(max(north, south), max(east, west)));
+	vec3 sharpened = center + sharpness*(4.0*center - north - south - east - west);
+
+	finalColor = vec4(clamp(sharpened, minColor, maxColor), 1.0)*fragColor;
+}
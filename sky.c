@@ -0,0 +1,399 @@
+#include "sky.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define SKY_SSE2
+    #include <emmintrin.h>
+#endif
+
+// Whitescale tonemapping, see http://filmicgames.com/archives/75
+#define TONEMAP_A 0.15f     // Shoulder strength
+#define TONEMAP_B 0.50f     // Linear strength
+#define TONEMAP_C 0.10f     // Linear angle
+#define TONEMAP_D 0.20f     // Toe strength
+#define TONEMAP_E 0.02f     // Toe numerator
+#define TONEMAP_F 0.30f     // Toe denominator
+
+static const float skyAmbient[3] = { 0.0f, 0.001f*0.3f, 0.0025f*0.3f };
+
+// Everything in the shader that only depends on the sun and the parameters, worked out once
+// per sky instead of once per pixel
+typedef struct SkyConstants {
+    Vector3 sunDirection;
+    float betaR[3];                 // Rayleigh and Mie scattering coefficients per primary
+    float betaM[3];
+    float sunE;                     // Sun intensity
+    float sunDisc;                  // Sun disc brightness, 0 to leave the disc out
+    float sunDiscCos;
+    float linMix;                   // How much of the in-scattering is lit by the low sun
+    float mieDirectionalG;
+    float rayleighZenithLength;
+    float mieZenithLength;
+    float exposure;
+    float whiteScale;
+    float gamma;
+} SkyConstants;
+
+SkyParams GetDefaultSkyParams(void) {
+    SkyParams params = { 0 };
+    params.turbidity = 4.7f;
+    params.rayleigh = 2.28f;
+    params.mieCoefficient = 0.003f;
+    params.mieDirectionalG = 0.82f;
+    params.luminance = 1.0f;
+    params.inclination = 0.3f;
+    params.azimuth = 0.1979f;
+    params.refractiveIndex = 1.00029f;
+    params.numMolecules = 2.542e25f;
+    params.depolarizationFactor = 0.02f;
+    params.rayleighZenithLength = 8400.0f;
+    params.mieV = 3.936f;
+    params.mieZenithLength = 34000.0f;
+    params.sunIntensityFactor = 1000.0f;
+    params.sunIntensityFalloffSteepness = 1.5f;
+    params.sunAngularDiameterDegrees = 0.00933f;    // Used as radians by the model
+    params.tonemapWeighting = 9.5f;
+    params.primaries = (Vector3){ 6.8e-7f, 5.5e-7f, 4.5e-7f };
+    params.mieKCoefficient = (Vector3){ 0.686f, 0.678f, 0.666f };
+    return params;
+}
+
+Vector3 GetSkySunPosition(SkyParams params) {
+    float theta = PI*(params.inclination - 0.5f);
+    float phi = 2.0f*PI*(params.azimuth - 0.5f);
+    return (Vector3){ SKY_SUN_DISTANCE*cosf(phi), SKY_SUN_DISTANCE*sinf(phi)*sinf(theta), SKY_SUN_DISTANCE*sinf(phi)*cosf(theta) };
+}
+
+static float Uncharted2Tonemap(float w) {
+    return ((w*(TONEMAP_A*w + TONEMAP_C*TONEMAP_B) + TONEMAP_D*TONEMAP_E)/(w*(TONEMAP_A*w + TONEMAP_B) + TONEMAP_D*TONEMAP_F)) - TONEMAP_E/TONEMAP_F;
+}
+
+static float SmoothStep(float edge0, float edge1, float x) {
+    float t = Clamp((x - edge0)/(edge1 - edge0), 0.0f, 1.0f);
+    return t*t*(3.0f - 2.0f*t);
+}
+
+static SkyConstants GetSkyConstants(SkyParams params, bool sunDisc) {
+    SkyConstants k = { 0 };
+    Vector3 sunPosition = GetSkySunPosition(params);
+    k.sunDirection = Vector3Normalize(sunPosition);
+
+    float sunfade = 1.0f - Clamp(1.0f - expf(sunPosition.y/4500.0f), 0.0f, 1.0f);
+    float rayleighCoefficient = params.rayleigh - (1.0f - sunfade);
+    float n2 = params.refractiveIndex*params.refractiveIndex - 1.0f;
+    float mieC = 0.2f*params.turbidity*10e-18f;
+    float lambda[3] = { params.primaries.x, params.primaries.y, params.primaries.z };
+    float mieK[3] = { params.mieKCoefficient.x, params.mieKCoefficient.y, params.mieKCoefficient.z };
+    for (int c = 0; c < 3; c++) {
+        float totalRayleigh = (8.0f*powf(PI, 3.0f)*n2*n2*(6.0f + 3.0f*params.depolarizationFactor))/
+                              (3.0f*params.numMolecules*powf(lambda[c], 4.0f)*(6.0f - 7.0f*params.depolarizationFactor));
+        float totalMie = 0.434f*mieC*PI*powf((2.0f*PI)/lambda[c], params.mieV - 2.0f)*mieK[c];
+        k.betaR[c] = totalRayleigh*rayleighCoefficient;
+        k.betaM[c] = totalMie*params.mieCoefficient;
+    }
+
+    float cutoffAngle = PI/1.95f;   // Earth shadow hack
+    k.sunE = params.sunIntensityFactor*fmaxf(0.0f, 1.0f - expf(-((cutoffAngle - acosf(k.sunDirection.y))/params.sunIntensityFalloffSteepness)));
+    k.sunDisc = sunDisc? k.sunE*19000.0f : 0.0f;
+    k.sunDiscCos = cosf(params.sunAngularDiameterDegrees);
+    k.linMix = Clamp(powf(1.0f - k.sunDirection.y, 5.0f), 0.0f, 1.0f);
+    k.mieDirectionalG = params.mieDirectionalG;
+    k.rayleighZenithLength = params.rayleighZenithLength;
+    k.mieZenithLength = params.mieZenithLength;
+    k.exposure = log2f(2.0f/powf(params.luminance, 4.0f));
+    k.whiteScale = 1.0f/Uncharted2Tonemap(params.tonemapWeighting);
+    k.gamma = 1.0f/(1.2f + 1.2f*sunfade);
+    return k;
+}
+
+// The per pixel part of the original fragment shader
+static Vector3 EvalSkyDirection(const SkyConstants *k, Vector3 direction) {
+    // Optical length, cutoff angle at 90 to avoid singularity
+    float zenithAngle = acosf(fmaxf(0.0f, direction.y));
+    float denom = cosf(zenithAngle) + 0.15f*powf(93.885f - ((zenithAngle*180.0f)/PI), -1.253f);
+    float sR = k->rayleighZenithLength/denom;
+    float sM = k->mieZenithLength/denom;
+
+    // In-scattering phases
+    float cosTheta = Vector3DotProduct(direction, k->sunDirection);
+    float rayleighPhase = (3.0f/(16.0f*PI))*(1.0f + powf(cosTheta*0.5f + 0.5f, 2.0f));
+    float g = k->mieDirectionalG;
+    float miePhase = (1.0f/(4.0f*PI))*((1.0f - g*g)/powf(1.0f - 2.0f*g*cosTheta + g*g, 1.5f));
+    float sundisk = SmoothStep(k->sunDiscCos, k->sunDiscCos + 0.00002f, cosTheta);
+
+    float color[3];
+    for (int c = 0; c < 3; c++) {
+        float Fex = expf(-(k->betaR[c]*sR + k->betaM[c]*sM));     // Combined extinction factor
+        float scatter = k->sunE*((k->betaR[c]*rayleighPhase + k->betaM[c]*miePhase)/(k->betaR[c] + k->betaM[c]));
+        float Lin = powf(scatter*(1.0f - Fex), 1.5f);
+        Lin *= Lerp(1.0f, powf(scatter*Fex, 0.5f), k->linMix);
+
+        // Composition and solar disc
+        float L0 = 0.1f*Fex + k->sunDisc*Fex*sundisk;
+        float texColor = (Lin + L0)*0.04f + skyAmbient[c];
+
+        float curr = Uncharted2Tonemap(k->exposure*texColor);
+        color[c] = powf(curr*k->whiteScale, k->gamma);
+    }
+
+    return (Vector3){ color[0], color[1], color[2] };
+}
+
+#if defined(SKY_SSE2)
+// Four wide exp2, log2 and acos. The exp2 and log2 polynomials are the Cephes single
+// precision ones and acos is Abramowitz and Stegun 4.4.46, all good to a few float ulps.
+static __m128 Exp2Sse(__m128 x) {
+    x = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-126.0f)), _mm_set1_ps(127.0f));
+    __m128i i = _mm_cvtps_epi32(x);                 // Round to nearest, f in [-0.5, 0.5]
+    __m128 f = _mm_sub_ps(x, _mm_cvtepi32_ps(i));
+
+    __m128 p = _mm_set1_ps(1.535336188319500e-4f);
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.339887440266574e-3f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(9.618437357674640e-3f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(5.550332471162809e-2f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(2.402264791363012e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(6.931472028550421e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+    __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23));
+    return _mm_mul_ps(p, scale);
+}
+
+static __m128 Log2Sse(__m128 x) {
+    x = _mm_max_ps(x, _mm_set1_ps(1.17549435e-38f));   // log2(0) comes out as -126, exp2 takes that back to 0
+
+    // x = m*2^e with m in [sqrt(0.5), sqrt(2))
+    __m128i bits = _mm_castps_si128(x);
+    __m128 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(126)));
+    __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f000000)));
+    __m128 small = _mm_cmplt_ps(m, _mm_set1_ps(0.707106781186547524f));
+    e = _mm_sub_ps(e, _mm_and_ps(small, _mm_set1_ps(1.0f)));
+    m = _mm_sub_ps(_mm_add_ps(m, _mm_and_ps(small, m)), _mm_set1_ps(1.0f));
+
+    __m128 z = _mm_mul_ps(m, m);
+    __m128 p = _mm_set1_ps(7.0376836292e-2f);
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.1514610310e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(1.1676998740e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.2420140846e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(1.4249322787e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-1.6668057665e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(2.0000714765e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(-2.4999993993e-1f));
+    p = _mm_add_ps(_mm_mul_ps(p, m), _mm_set1_ps(3.3333331174e-1f));
+    p = _mm_mul_ps(_mm_mul_ps(p, m), z);
+    p = _mm_sub_ps(p, _mm_mul_ps(_mm_set1_ps(0.5f), z));
+
+    __m128 ln = _mm_add_ps(m, p);
+    return _mm_add_ps(_mm_mul_ps(ln, _mm_set1_ps(1.44269504088896341f)), e);
+}
+
+static __m128 PowSse(__m128 x, __m128 y) {
+    return Exp2Sse(_mm_mul_ps(y, Log2Sse(x)));
+}
+
+static __m128 ExpSse(__m128 x) {
+    return Exp2Sse(_mm_mul_ps(x, _mm_set1_ps(1.44269504088896341f)));
+}
+
+// x in [0, 1]
+static __m128 AcosSse(__m128 x) {
+    __m128 p = _mm_set1_ps(-0.0012624911f);
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(0.0066700901f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(-0.0170881256f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(0.0308918810f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(-0.0501743046f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(0.0889789874f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(-0.2145988016f));
+    p = _mm_add_ps(_mm_mul_ps(p, x), _mm_set1_ps(1.5707963050f));
+    return _mm_mul_ps(p, _mm_sqrt_ps(_mm_sub_ps(_mm_set1_ps(1.0f), x)));
+}
+
+static __m128 Uncharted2TonemapSse(__m128 w) {
+    __m128 num = _mm_add_ps(_mm_mul_ps(w, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(TONEMAP_A), w), _mm_set1_ps(TONEMAP_C*TONEMAP_B))), _mm_set1_ps(TONEMAP_D*TONEMAP_E));
+    __m128 den = _mm_add_ps(_mm_mul_ps(w, _mm_add_ps(_mm_mul_ps(_mm_set1_ps(TONEMAP_A), w), _mm_set1_ps(TONEMAP_B))), _mm_set1_ps(TONEMAP_D*TONEMAP_F));
+    return _mm_sub_ps(_mm_div_ps(num, den), _mm_set1_ps(TONEMAP_E/TONEMAP_F));
+}
+
+// EvalSkyDirection() for four directions, in the same order
+static void EvalSkyDirectionsSse(const SkyConstants *k, const Vector3 *directions, Vector3 *colors) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 dx = _mm_set_ps(directions[3].x, directions[2].x, directions[1].x, directions[0].x);
+    __m128 dy = _mm_set_ps(directions[3].y, directions[2].y, directions[1].y, directions[0].y);
+    __m128 dz = _mm_set_ps(directions[3].z, directions[2].z, directions[1].z, directions[0].z);
+
+    // Optical length, cos(acos(x)) is x
+    __m128 mu = _mm_max_ps(zero, dy);
+    __m128 zenithDegrees = _mm_mul_ps(AcosSse(mu), _mm_set1_ps(180.0f/PI));
+    __m128 denom = _mm_add_ps(mu, _mm_mul_ps(_mm_set1_ps(0.15f), PowSse(_mm_sub_ps(_mm_set1_ps(93.885f), zenithDegrees), _mm_set1_ps(-1.253f))));
+    __m128 invDenom = _mm_div_ps(one, denom);
+    __m128 sR = _mm_mul_ps(_mm_set1_ps(k->rayleighZenithLength), invDenom);
+    __m128 sM = _mm_mul_ps(_mm_set1_ps(k->mieZenithLength), invDenom);
+
+    // In-scattering phases
+    __m128 cosTheta = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(k->sunDirection.x)), _mm_mul_ps(dy, _mm_set1_ps(k->sunDirection.y))),
+                                 _mm_mul_ps(dz, _mm_set1_ps(k->sunDirection.z)));
+    __m128 halfCos = _mm_add_ps(_mm_mul_ps(cosTheta, _mm_set1_ps(0.5f)), _mm_set1_ps(0.5f));
+    __m128 rayleighPhase = _mm_mul_ps(_mm_set1_ps(3.0f/(16.0f*PI)), _mm_add_ps(one, _mm_mul_ps(halfCos, halfCos)));
+    float g = k->mieDirectionalG;
+    __m128 hg = _mm_sub_ps(_mm_set1_ps(1.0f + g*g), _mm_mul_ps(_mm_set1_ps(2.0f*g), cosTheta));
+    __m128 miePhase = _mm_div_ps(_mm_set1_ps((1.0f/(4.0f*PI))*(1.0f - g*g)), _mm_mul_ps(hg, _mm_sqrt_ps(hg)));
+
+    __m128 t = _mm_div_ps(_mm_sub_ps(cosTheta, _mm_set1_ps(k->sunDiscCos)), _mm_set1_ps(0.00002f));
+    t = _mm_min_ps(_mm_max_ps(t, zero), one);
+    __m128 sundisk = _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(_mm_set1_ps(3.0f), _mm_add_ps(t, t)));
+
+    float out[3][4];
+    for (int c = 0; c < 3; c++) {
+        __m128 betaR = _mm_set1_ps(k->betaR[c]);
+        __m128 betaM = _mm_set1_ps(k->betaM[c]);
+        __m128 Fex = ExpSse(_mm_sub_ps(zero, _mm_add_ps(_mm_mul_ps(betaR, sR), _mm_mul_ps(betaM, sM))));
+        __m128 scatter = _mm_mul_ps(_mm_set1_ps(k->sunE/(k->betaR[c] + k->betaM[c])), _mm_add_ps(_mm_mul_ps(betaR, rayleighPhase), _mm_mul_ps(betaM, miePhase)));
+
+        // pow(x, 1.5) and pow(x, 0.5) through sqrt, both bases are never negative
+        __m128 lit = _mm_mul_ps(scatter, _mm_sub_ps(one, Fex));
+        __m128 Lin = _mm_mul_ps(lit, _mm_sqrt_ps(lit));
+        __m128 lowSun = _mm_sqrt_ps(_mm_mul_ps(scatter, Fex));
+        Lin = _mm_mul_ps(Lin, _mm_add_ps(one, _mm_mul_ps(_mm_set1_ps(k->linMix), _mm_sub_ps(lowSun, one))));
+
+        __m128 L0 = _mm_mul_ps(Fex, _mm_add_ps(_mm_set1_ps(0.1f), _mm_mul_ps(_mm_set1_ps(k->sunDisc), sundisk)));
+        __m128 texColor = _mm_add_ps(_mm_mul_ps(_mm_add_ps(Lin, L0), _mm_set1_ps(0.04f)), _mm_set1_ps(skyAmbient[c]));
+
+        __m128 curr = Uncharted2TonemapSse(_mm_mul_ps(_mm_set1_ps(k->exposure), texColor));
+        _mm_storeu_ps(out[c], PowSse(_mm_mul_ps(curr, _mm_set1_ps(k->whiteScale)), _mm_set1_ps(k->gamma)));
+    }
+
+    for (int i = 0; i < 4; i++) colors[i] = (Vector3){ out[0][i], out[1][i], out[2][i] };
+}
+#endif
+
+static void EvalSkyDirections(const SkyConstants *k, const Vector3 *directions, Vector3 *colors, int count) {
+    int i = 0;
+#if defined(SKY_SSE2)
+    for (; i + 4 <= count; i += 4) EvalSkyDirectionsSse(k, &directions[i], &colors[i]);
+#endif
+    for (; i < count; i++) colors[i] = EvalSkyDirection(k, directions[i]);
+}
+
+void EvalSkyRadiance(SkyParams params, const Vector3 *directions, Vector3 *colors, int count) {
+    SkyConstants k = GetSkyConstants(params, true);
+    EvalSkyDirections(&k, directions, colors, count);
+}
+
+void EvalSkyRadianceScalar(SkyParams params, const Vector3 *directions, Vector3 *colors, int count) {
+    SkyConstants k = GetSkyConstants(params, true);
+    for (int i = 0; i < count; i++) colors[i] = EvalSkyDirection(&k, directions[i]);
+}
+
+Image GenImageSkyCubemap(SkyParams params, int faceSize) {
+    SkyConstants k = GetSkyConstants(params, false);
+    Color *pixels = (Color *)RL_MALLOC(6*faceSize*faceSize*sizeof(Color));
+    Vector3 *directions = (Vector3 *)RL_MALLOC(faceSize*sizeof(Vector3));
+    Vector3 *colors = (Vector3 *)RL_MALLOC(faceSize*sizeof(Vector3));
+
+    // Faces in OpenGL order, +x -x +y -y +z -z, with the OpenGL face orientations: s runs
+    // along a row and t down the rows, both from -1 to 1
+    for (int face = 0; face < 6; face++) {
+        for (int y = 0; y < faceSize; y++) {
+            float t = 2.0f*(y + 0.5f)/faceSize - 1.0f;
+            for (int x = 0; x < faceSize; x++) {
+                float s = 2.0f*(x + 0.5f)/faceSize - 1.0f;
+                Vector3 direction = { 0 };
+                switch (face) {
+                    case 0: direction = (Vector3){ 1.0f, -t, -s }; break;
+                    case 1: direction = (Vector3){ -1.0f, -t, s }; break;
+                    case 2: direction = (Vector3){ s, 1.0f, t }; break;
+                    case 3: direction = (Vector3){ s, -1.0f, -t }; break;
+                    case 4: direction = (Vector3){ s, -t, 1.0f }; break;
+                    default: direction = (Vector3){ -s, -t, -1.0f }; break;
+                }
+                directions[x] = Vector3Normalize(direction);
+            }
+
+            EvalSkyDirections(&k, directions, colors, faceSize);
+
+            Color *row = &pixels[(face*faceSize + y)*faceSize];
+            for (int x = 0; x < faceSize; x++) {
+                row[x] = (Color){ (unsigned char)(Clamp(colors[x].x, 0.0f, 1.0f)*255.0f + 0.5f),
+                                  (unsigned char)(Clamp(colors[x].y, 0.0f, 1.0f)*255.0f + 0.5f),
+                                  (unsigned char)(Clamp(colors[x].z, 0.0f, 1.0f)*255.0f + 0.5f), 255 };
+            }
+        }
+    }
+
+    RL_FREE(directions);
+    RL_FREE(colors);
+
+    return (Image){ pixels, faceSize, 6*faceSize, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+}
+
+void LoadSkyCache(SkyCache *sky, SkyParams params) {
+    memset(sky, 0, sizeof(SkyCache));
+    sky->params = params;
+    sky->dirty = true;
+
+    sky->box = LoadModelFromMesh(GenMeshCube(1.0f, 1.0f, 1.0f));
+    Shader shader = LoadShader("shaders/sky.vs", "shaders/sky.fs");
+    shader.locs[SHADER_LOC_MAP_CUBEMAP] = GetShaderLocation(shader, "environmentMap");
+    sky->sunDirectionLoc = GetShaderLocation(shader, "sunDirection");
+    sky->sunColorLoc = GetShaderLocation(shader, "sunColor");
+    sky->sunDiscCosLoc = GetShaderLocation(shader, "sunDiscCos");
+    sky->box.materials[0].shader = shader;
+
+    UpdateSkyCache(sky);
+}
+
+void UnloadSkyCache(SkyCache *sky) {
+    // UnloadModel() only frees the material maps, the cubemap and the shader are ours to unload
+    Material *material = &sky->box.materials[0];
+    if (material->maps[MATERIAL_MAP_CUBEMAP].texture.id > 0) UnloadTexture(material->maps[MATERIAL_MAP_CUBEMAP].texture);
+    UnloadShader(material->shader);
+    UnloadModel(sky->box);
+    memset(sky, 0, sizeof(SkyCache));
+}
+
+void SetSkyParams(SkyCache *sky, SkyParams params) {
+    if (memcmp(&sky->params, &params, sizeof(SkyParams)) == 0) return;
+    sky->params = params;
+    sky->dirty = true;
+}
+
+bool UpdateSkyCache(SkyCache *sky) {
+    if (!sky->dirty) return false;
+
+    double start = GetTime();
+    Image faces = GenImageSkyCubemap(sky->params, SKY_CUBEMAP_SIZE);
+    TextureCubemap cubemap = LoadTextureCubemap(faces, CUBEMAP_LAYOUT_LINE_VERTICAL);
+    UnloadImage(faces);
+
+    Material *material = &sky->box.materials[0];
+    if (material->maps[MATERIAL_MAP_CUBEMAP].texture.id > 0) UnloadTexture(material->maps[MATERIAL_MAP_CUBEMAP].texture);
+    material->maps[MATERIAL_MAP_CUBEMAP].texture = cubemap;
+
+    // The sun disc, drawn by the shader at the colour the model gives its centre
+    Vector3 sunDirection = Vector3Normalize(GetSkySunPosition(sky->params));
+    Vector3 sunColor;
+    EvalSkyRadiance(sky->params, &sunDirection, &sunColor, 1);
+    float sunDiscCos = cosf(sky->params.sunAngularDiameterDegrees);
+    SetShaderValue(material->shader, sky->sunDirectionLoc, &sunDirection, SHADER_UNIFORM_VEC3);
+    SetShaderValue(material->shader, sky->sunColorLoc, &sunColor, SHADER_UNIFORM_VEC3);
+    SetShaderValue(material->shader, sky->sunDiscCosLoc, &sunDiscCos, SHADER_UNIFORM_FLOAT);
+
+    sky->dirty = false;
+    TraceLog(LOG_INFO, "SKY: Built %ix%i cubemap in %.2f ms", SKY_CUBEMAP_SIZE, SKY_CUBEMAP_SIZE, (GetTime() - start)*1000.0);
+    return true;
+}
+
+void DrawSky(const SkyCache *sky) {
+    // The shader puts the cube on the far plane, so it only fills pixels nothing else has
+    // drawn to. Seen from inside, so no culling, and it should not write depth.
+    rlDisableBackfaceCulling();
+    rlDisableDepthMask();
+    DrawModel(sky->box, (Vector3){ 0.0f, 0.0f, 0.0f }, 1.0f, WHITE);
+    rlEnableDepthMask();
+    rlEnableBackfaceCulling();
+}
@@ -0,0 +1,73 @@
+/*******************************************************************************************
+*
+*   sky - Preetham daylight sky, cached in a cubemap
+*
+*   The sky only changes when the sun or the atmosphere parameters do, so instead of running
+*   the model for every pixel of every frame it is evaluated on the CPU into a small cubemap
+*   whenever they change, and drawing the sky is one cubemap lookup. The sun disc is far
+*   smaller than a cubemap texel, so it is left out of the cubemap and the sky shader adds
+*   it back with one dot product.
+*
+*   EvalSkyRadiance() is the evaluator, four directions at a time with SSE2 where the
+*   compiler targets it. EvalSkyRadianceScalar() is a line by line port of the original
+*   fragment shader and is what the SSE2 path is checked against (see microbench sky).
+*
+*   Based on "A Practical Analytic Model for Daylight" aka The Preetham Model
+*   http://www.cs.utah.edu/~shirley/papers/sunsky/sunsky.pdf
+*   Original implementation by Simon Wallner, improved by Martin Upitis, three.js
+*   integration by zz85, uniforms and refactoring by Sam Twidale.
+*
+********************************************************************************************/
+
+#ifndef SKY_H
+#define SKY_H
+
+#include "raylib.h"
+
+#define SKY_CUBEMAP_SIZE 128            // Texels along a cubemap face edge
+#define SKY_SUN_DISTANCE 4000.0f        // The sun fade is tuned for the sun at this distance
+
+typedef struct SkyParams {
+    float turbidity;
+    float rayleigh;
+    float mieCoefficient;
+    float mieDirectionalG;
+    float luminance;
+    float inclination;                  // Sun position, 0 to 1 around each axis
+    float azimuth;
+    float refractiveIndex;
+    float numMolecules;
+    float depolarizationFactor;
+    float rayleighZenithLength;
+    float mieV;
+    float mieZenithLength;
+    float sunIntensityFactor;
+    float sunIntensityFalloffSteepness;
+    float sunAngularDiameterDegrees;
+    float tonemapWeighting;
+    Vector3 primaries;
+    Vector3 mieKCoefficient;
+} SkyParams;
+
+typedef struct SkyCache {
+    SkyParams params;                   // Parameters the cubemap is built for
+    bool dirty;                         // params changed since the cubemap was built
+    Model box;                          // Unit cube drawn around the camera, its material holds the shader and the cubemap
+    int sunDirectionLoc;
+    int sunColorLoc;
+    int sunDiscCosLoc;
+} SkyCache;
+
+SkyParams GetDefaultSkyParams(void);
+Vector3 GetSkySunPosition(SkyParams params);                           // Sun position relative to the viewer, SKY_SUN_DISTANCE away
+void EvalSkyRadiance(SkyParams params, const Vector3 *directions, Vector3 *colors, int count);        // Final sky colour for normalized view directions
+void EvalSkyRadianceScalar(SkyParams params, const Vector3 *directions, Vector3 *colors, int count);  // Same, one direction at a time, as the original shader did it
+Image GenImageSkyCubemap(SkyParams params, int faceSize);              // Sky without the sun disc, faces stacked as CUBEMAP_LAYOUT_LINE_VERTICAL
+
+void LoadSkyCache(SkyCache *sky, SkyParams params);
+void UnloadSkyCache(SkyCache *sky);
+void SetSkyParams(SkyCache *sky, SkyParams params);                    // Marks the cubemap for a rebuild when anything changed
+bool UpdateSkyCache(SkyCache *sky);                                    // Rebuild the cubemap if needed (main thread only), true when it was rebuilt
+void DrawSky(const SkyCache *sky);                                     // Draw behind everything already drawn, inside BeginMode3D()
+
+#endif // SKY_H
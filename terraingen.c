@@ -0,0 +1,411 @@
+#include "terraingen.h"
+#include "terrainmesh.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//----------------------------------------------------------------------------------
+// Vector operations, TERRAIN_GEN_WIDTH lanes
+//----------------------------------------------------------------------------------
+#if TERRAIN_GEN_WIDTH == 8
+#include <immintrin.h>
+
+typedef __m256 vfloat;
+typedef __m256i vint;
+
+static inline vfloat VSet(float a) { return _mm256_set1_ps(a); }
+static inline vint VSetI(uint32_t a) { return _mm256_set1_epi32((int)a); }
+static inline vfloat VLanes(void) { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+static inline vfloat VLoad(const float *p) { return _mm256_loadu_ps(p); }
+static inline void VStore(float *p, vfloat a) { _mm256_storeu_ps(p, a); }
+static inline void VStoreI(void *p, vint a) { _mm256_storeu_si256((__m256i *)p, a); }
+static inline vfloat VAdd(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+static inline vfloat VSub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+static inline vfloat VMul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+static inline vfloat VMin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat VMax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat VAbs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline vfloat VFloor(vfloat a) { return _mm256_floor_ps(a); }
+static inline vint VToInt(vfloat a) { return _mm256_cvttps_epi32(a); }
+static inline vint VIAdd(vint a, vint b) { return _mm256_add_epi32(a, b); }
+static inline vint VIMul(vint a, vint b) { return _mm256_mullo_epi32(a, b); }
+static inline vint VIXor(vint a, vint b) { return _mm256_xor_si256(a, b); }
+static inline vint VIAnd(vint a, vint b) { return _mm256_and_si256(a, b); }
+static inline vint VISrl(vint a, int n) { return _mm256_srli_epi32(a, n); }
+static inline vint VISll(vint a, int n) { return _mm256_slli_epi32(a, n); }
+static inline vfloat VXorBits(vfloat a, vint bits) { return _mm256_xor_ps(a, _mm256_castsi256_ps(bits)); }
+
+// Clear the upper halves before returning to SSE code. GCC only does this itself from -O2, and
+// without it every SSE instruction that follows (libm, memcpy) is several times slower.
+static inline void VEnd(void) { _mm256_zeroupper(); }
+
+#elif TERRAIN_GEN_WIDTH == 4
+#include <emmintrin.h>
+
+typedef __m128 vfloat;
+typedef __m128i vint;
+
+static inline vfloat VSet(float a) { return _mm_set1_ps(a); }
+static inline vint VSetI(uint32_t a) { return _mm_set1_epi32((int)a); }
+static inline vfloat VLanes(void) { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+static inline vfloat VLoad(const float *p) { return _mm_loadu_ps(p); }
+static inline void VStore(float *p, vfloat a) { _mm_storeu_ps(p, a); }
+static inline void VStoreI(void *p, vint a) { _mm_storeu_si128((__m128i *)p, a); }
+static inline vfloat VAdd(vfloat a, vfloat b) { return _mm_add_ps(a, b); }
+static inline vfloat VSub(vfloat a, vfloat b) { return _mm_sub_ps(a, b); }
+static inline vfloat VMul(vfloat a, vfloat b) { return _mm_mul_ps(a, b); }
+static inline vfloat VMin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat VMax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat VAbs(vfloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline vint VToInt(vfloat a) { return _mm_cvttps_epi32(a); }
+static inline vint VIAdd(vint a, vint b) { return _mm_add_epi32(a, b); }
+static inline vint VIXor(vint a, vint b) { return _mm_xor_si128(a, b); }
+static inline vint VIAnd(vint a, vint b) { return _mm_and_si128(a, b); }
+static inline vint VISrl(vint a, int n) { return _mm_srli_epi32(a, n); }
+static inline vint VISll(vint a, int n) { return _mm_slli_epi32(a, n); }
+static inline vfloat VXorBits(vfloat a, vint bits) { return _mm_xor_ps(a, _mm_castsi128_ps(bits)); }
+static inline void VEnd(void) { }
+
+// SSE2 has no floor, truncate and step down where that rounded up
+static inline vfloat VFloor(vfloat a) {
+    vfloat t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+}
+
+// SSE2 has no 32 bit multiply, multiply the even and odd lanes as 64 bit and keep the low halves
+static inline vint VIMul(vint a, vint b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+#else
+
+typedef float vfloat;
+typedef uint32_t vint;
+
+static inline vfloat VSet(float a) { return a; }
+static inline vint VSetI(uint32_t a) { return a; }
+static inline vfloat VLanes(void) { return 0.0f; }
+static inline vfloat VLoad(const float *p) { return *p; }
+static inline void VStore(float *p, vfloat a) { *p = a; }
+static inline vfloat VAdd(vfloat a, vfloat b) { return a + b; }
+static inline vfloat VSub(vfloat a, vfloat b) { return a - b; }
+static inline vfloat VMul(vfloat a, vfloat b) { return a*b; }
+static inline vfloat VMin(vfloat a, vfloat b) { return (a < b)? a : b; }    // Same results as minps and maxps
+static inline vfloat VMax(vfloat a, vfloat b) { return (a > b)? a : b; }
+static inline vfloat VAbs(vfloat a) { return fabsf(a); }
+static inline vfloat VFloor(vfloat a) { return floorf(a); }
+static inline vint VToInt(vfloat a) { return (uint32_t)(int32_t)a; }
+static inline vint VIAdd(vint a, vint b) { return a + b; }
+static inline vint VIMul(vint a, vint b) { return a*b; }
+static inline vint VIXor(vint a, vint b) { return a ^ b; }
+static inline vint VIAnd(vint a, vint b) { return a & b; }
+static inline vint VISrl(vint a, int n) { return a >> n; }
+static inline vint VISll(vint a, int n) { return a << n; }
+static inline vfloat VXorBits(vfloat a, vint bits) {
+    uint32_t u;
+    memcpy(&u, &a, sizeof(u));
+    u ^= bits;
+    memcpy(&a, &u, sizeof(a));
+    return a;
+}
+static inline void VEnd(void) { }
+
+#endif
+
+static inline vfloat VLerp(vfloat a, vfloat b, vfloat t) { return VAdd(a, VMul(t, VSub(b, a))); }
+static inline vfloat VClamp01(vfloat a) { return VMin(VMax(a, VSet(0.0f)), VSet(1.0f)); }
+
+// Colour channels from 0 to 255 into TERRAIN_GEN_WIDTH pixels, rounded the same way on every
+// target. The vector targets are all little endian, so r is the low byte of each pixel.
+static inline void VStoreColors(Color *p, vfloat r, vfloat g, vfloat b) {
+#if TERRAIN_GEN_WIDTH == 1
+    *p = (Color){ (unsigned char)(r + 0.5f), (unsigned char)(g + 0.5f), (unsigned char)(b + 0.5f), 255 };
+#else
+    vint red = VToInt(VAdd(r, VSet(0.5f)));
+    vint green = VISll(VToInt(VAdd(g, VSet(0.5f))), 8);
+    vint blue = VISll(VToInt(VAdd(b, VSet(0.5f))), 16);
+    VStoreI(p, VIXor(VIXor(red, green), VIXor(blue, VSetI(0xff000000u))));     // No bits overlap, xor is or
+#endif
+}
+
+static inline vfloat VSmoothStep(float edge0, float edge1, vfloat x) {
+    vfloat t = VClamp01(VMul(VSub(x, VSet(edge0)), VSet(1.0f/(edge1 - edge0))));
+    return VMul(VMul(t, t), VSub(VSet(3.0f), VAdd(t, t)));
+}
+
+//----------------------------------------------------------------------------------
+// Noise
+//----------------------------------------------------------------------------------
+// The release build is -O1, which does not inline a function this size. Calling it costs
+// more than the noise itself once the vectors have to go through the stack.
+#if defined(__GNUC__)
+    #define NOISE_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+    #define NOISE_INLINE static __forceinline
+#else
+    #define NOISE_INLINE static inline
+#endif
+
+#define PRIME_X 0x8da6b343u
+#define PRIME_Z 0xd8163841u
+
+// Dot product of the offset (dx, dz) with the diagonal gradient picked by the top two bits of
+// the hashed lattice point
+NOISE_INLINE vfloat Gradient(vint hash, vfloat dx, vfloat dz) {
+    hash = VIMul(VIXor(hash, VISrl(hash, 16)), VSetI(0x7feb352du));
+    hash = VIMul(VIXor(hash, VISrl(hash, 15)), VSetI(0x846ca68bu));
+    vint signX = VIAnd(hash, VSetI(0x80000000u));
+    vint signZ = VIAnd(VISll(hash, 1), VSetI(0x80000000u));
+    return VAdd(VXorBits(dx, signX), VXorBits(dz, signZ));
+}
+
+// 2D gradient noise, roughly -1 to 1. Lattice points hash their integer coordinates with the
+// seed.
+NOISE_INLINE vfloat Noise(vfloat x, vfloat z, vint seed) {
+    vfloat x0 = VFloor(x), z0 = VFloor(z);
+    vfloat dx = VSub(x, x0), dz = VSub(z, z0);
+    vfloat dx1 = VSub(dx, VSet(1.0f)), dz1 = VSub(dz, VSet(1.0f));
+
+    vint hx0 = VIMul(VToInt(x0), VSetI(PRIME_X));
+    vint hx1 = VIAdd(hx0, VSetI(PRIME_X));
+    vint hz0 = VIMul(VToInt(z0), VSetI(PRIME_Z));
+    vint hz1 = VIXor(VIAdd(hz0, VSetI(PRIME_Z)), seed);
+    hz0 = VIXor(hz0, seed);
+
+    vfloat n00 = Gradient(VIXor(hx0, hz0), dx, dz);
+    vfloat n10 = Gradient(VIXor(hx1, hz0), dx1, dz);
+    vfloat n01 = Gradient(VIXor(hx0, hz1), dx, dz1);
+    vfloat n11 = Gradient(VIXor(hx1, hz1), dx1, dz1);
+
+    // Quintic fade, t^3 (t (6t - 15) + 10)
+    vfloat u = VMul(VMul(VMul(dx, dx), dx), VAdd(VMul(dx, VSub(VMul(dx, VSet(6.0f)), VSet(15.0f))), VSet(10.0f)));
+    vfloat v = VMul(VMul(VMul(dz, dz), dz), VAdd(VMul(dz, VSub(VMul(dz, VSet(6.0f)), VSet(15.0f))), VSet(10.0f)));
+    return VLerp(VLerp(n00, n10, u), VLerp(n01, n11, u), v);
+}
+
+static uint32_t GetOctaveSeed(uint32_t seed, uint32_t stream, uint32_t octave) {
+    uint32_t h = seed*0x9e3779b9u + stream*0x85ebca6bu + octave*0xc2b2ae35u;
+    h ^= h >> 16;
+    return h*0x7feb352du;
+}
+
+// Ground height from 0 to 1 at world positions (x, z)
+NOISE_INLINE vfloat GetHeightVector(uint32_t seed, vfloat x, vfloat z) {
+    vfloat px = VMul(x, VSet(TERRAIN_GEN_FREQUENCY));
+    vfloat pz = VMul(z, VSet(TERRAIN_GEN_FREQUENCY));
+
+    // Domain warp, two low octave fBm fields push the sample position around
+    vfloat warpX = VSet(0.0f), warpZ = VSet(0.0f);
+    vfloat qx = px, qz = pz;
+    float amplitude = 0.5f;
+    for (int octave = 0; octave < TERRAIN_GEN_WARP_OCTAVES; octave++) {
+        warpX = VAdd(warpX, VMul(VSet(amplitude), Noise(VAdd(qx, VSet(5.2f)), VAdd(qz, VSet(1.3f)), VSetI(GetOctaveSeed(seed, 1, octave)))));
+        warpZ = VAdd(warpZ, VMul(VSet(amplitude), Noise(VAdd(qx, VSet(9.7f)), VAdd(qz, VSet(2.8f)), VSetI(GetOctaveSeed(seed, 2, octave)))));
+        vfloat rx = VSub(VMul(qx, VSet(1.6f)), VMul(qz, VSet(1.2f)));     // Double the frequency and rotate, hides the lattice
+        qz = VAdd(VMul(qx, VSet(1.2f)), VMul(qz, VSet(1.6f)));
+        qx = rx;
+        amplitude *= 0.5f;
+    }
+    px = VAdd(px, VMul(warpX, VSet(TERRAIN_GEN_WARP_STRENGTH)));
+    pz = VAdd(pz, VMul(warpZ, VSet(TERRAIN_GEN_WARP_STRENGTH)));
+
+    // The same octaves give rolling fBm and ridged fBm, each ridge octave is weighted by the
+    // one before so ridges stay sharp and valleys stay smooth
+    vfloat rolling = VSet(0.0f), ridged = VSet(0.0f), weight = VSet(1.0f);
+    amplitude = 0.5f;
+    for (int octave = 0; octave < TERRAIN_GEN_OCTAVES; octave++) {
+        vfloat n = Noise(px, pz, VSetI(GetOctaveSeed(seed, 0, octave)));
+        rolling = VAdd(rolling, VMul(VSet(amplitude), n));
+
+        vfloat ridge = VSub(VSet(1.0f), VAbs(n));
+        ridge = VMul(VMul(ridge, ridge), weight);
+        weight = VClamp01(VMul(ridge, VSet(2.0f)));
+        ridged = VAdd(ridged, VMul(VSet(amplitude), ridge));
+
+        vfloat rx = VSub(VMul(px, VSet(1.6f)), VMul(pz, VSet(1.2f)));
+        pz = VAdd(VMul(px, VSet(1.2f)), VMul(pz, VSet(1.6f)));
+        px = rx;
+        amplitude *= 0.5f;
+    }
+
+    // Ridges take over where the rolling ground gets high
+    vfloat height = VAdd(VSet(0.5f), rolling);
+    vfloat mountains = VSmoothStep(0.5f, 0.7f, height);
+    height = VLerp(VMul(height, VSet(0.8f)), VAdd(VSet(0.35f), ridged), mountains);
+    return VClamp01(height);
+}
+
+//----------------------------------------------------------------------------------
+// Module functions
+//----------------------------------------------------------------------------------
+TerrainGenerator GetTerrainGenerator(unsigned int seed, float heightScale) {
+    return (TerrainGenerator){ seed, heightScale };
+}
+
+const char *GetTerrainGenBackend(void) {
+    return (TERRAIN_GEN_WIDTH == 8)? "AVX2" : (TERRAIN_GEN_WIDTH == 4)? "SSE2" : "scalar";
+}
+
+void GenTerrainHeights(const TerrainGenerator *generator, int sampleX, int sampleZ, int countX, int countZ, float *heights) {
+    // Rows are padded to whole vectors so every sample goes through the same lanes, whatever
+    // its position in the row
+    int paddedX = (countX + TERRAIN_GEN_WIDTH - 1)/TERRAIN_GEN_WIDTH*TERRAIN_GEN_WIDTH;
+    float *row = (float *)RL_MALLOC(paddedX*sizeof(float));
+
+    for (int z = 0; z < countZ; z++) {
+        vfloat worldZ = VSet((float)(sampleZ + z));
+        for (int x = 0; x < paddedX; x += TERRAIN_GEN_WIDTH) {
+            vfloat worldX = VAdd(VSet((float)(sampleX + x)), VLanes());     // Whole numbers, exact
+            VStore(&row[x], VMul(GetHeightVector(generator->seed, worldX, worldZ), VSet(generator->heightScale)));
+        }
+        VEnd();
+        memcpy(&heights[z*countX], row, countX*sizeof(float));
+    }
+
+    RL_FREE(row);
+}
+
+Heightfield GenTerrainHeightfield(const TerrainGenerator *generator, int sampleX, int sampleZ, int samplesX, int samplesZ, int apron) {
+    Heightfield heightfield = { 0 };
+    heightfield.samplesX = samplesX;
+    heightfield.samplesZ = samplesZ;
+    heightfield.stride = samplesX + 2*apron;
+    heightfield.apron = apron;
+    heightfield.origin = (Vector3){ (float)sampleX, 0.0f, (float)sampleZ };
+    heightfield.cellSizeX = 1.0f;
+    heightfield.cellSizeZ = 1.0f;
+
+    // The apron is generated like any other sample, it is exactly what the neighbours have
+    float *samples = (float *)RL_MALLOC(heightfield.stride*(samplesZ + 2*apron)*sizeof(float));
+    GenTerrainHeights(generator, sampleX - apron, sampleZ - apron, heightfield.stride, samplesZ + 2*apron, samples);
+    heightfield.heights = samples + apron*heightfield.stride + apron;
+
+    heightfield.minHeight = heightfield.heights[0];
+    heightfield.maxHeight = heightfield.heights[0];
+    for (int z = 0; z < samplesZ; z++) {
+        for (int x = 0; x < samplesX; x++) {
+            heightfield.minHeight = fminf(heightfield.minHeight, heightfield.heights[z*heightfield.stride + x]);
+            heightfield.maxHeight = fmaxf(heightfield.maxHeight, heightfield.heights[z*heightfield.stride + x]);
+        }
+    }
+
+    return heightfield;
+}
+
+Image GenTerrainColorImage(const TerrainGenerator *generator, const Heightfield *heightfield, int texelsPerCell) {
+    int width = (heightfield->samplesX - 1)*texelsPerCell;
+    int height = (heightfield->samplesZ - 1)*texelsPerCell;
+    int paddedWidth = (width + TERRAIN_GEN_WIDTH - 1)/TERRAIN_GEN_WIDTH*TERRAIN_GEN_WIDTH;
+
+    // Colours are worked out on a coarse grid, one point every step texels, and interpolated
+    // out to the texels in between. Never coarser than the heightfield itself.
+    int step = (texelsPerCell < TERRAIN_GEN_COLOR_STEP)? texelsPerCell : TERRAIN_GEN_COLOR_STEP;
+    int coarseWidth = (width - 1)/step + 2;
+    int coarseHeight = (height - 1)/step + 2;
+    int paddedCoarse = (coarseWidth + TERRAIN_GEN_WIDTH - 1)/TERRAIN_GEN_WIDTH*TERRAIN_GEN_WIDTH;
+    float weights[TERRAIN_GEN_COLOR_STEP];
+    for (int s = 0; s < step; s++) weights[s] = (float)s/step;
+
+    // Height and flatness (normal y) of every sample row, interpolated out to every coarse
+    // column. Coarse rows then only need a vertical interpolation between two of these. The
+    // last coarse point can land past the last sample, it takes the edge value.
+    float *rowHeights = (float *)RL_CALLOC(heightfield->samplesZ*paddedCoarse, sizeof(float));
+    float *rowFlatness = (float *)RL_CALLOC(heightfield->samplesZ*paddedCoarse, sizeof(float));
+    float *flatness = (float *)RL_MALLOC(heightfield->samplesX*sizeof(float));
+    for (int z = 0; z < heightfield->samplesZ; z++) {
+        const float *samples = &heightfield->heights[z*heightfield->stride];
+        for (int x = 0; x < heightfield->samplesX; x++) flatness[x] = GetHeightfieldSampleNormal(heightfield, x, z, 1).y;
+
+        for (int k = 0; k < coarseWidth; k++) {
+            float u = fminf((k*step + 0.5f)/texelsPerCell, (float)(heightfield->samplesX - 1));
+            int x0 = ((int)u < heightfield->samplesX - 1)? (int)u : heightfield->samplesX - 2;
+            float fx = u - x0;
+            rowHeights[z*paddedCoarse + k] = (samples[x0] + fx*(samples[x0 + 1] - samples[x0]))/generator->heightScale;
+            rowFlatness[z*paddedCoarse + k] = flatness[x0] + fx*(flatness[x0 + 1] - flatness[x0]);
+        }
+    }
+
+    const float sand[3] = { 0.76f, 0.70f, 0.50f };
+    const float grassLight[3] = { 0.33f, 0.50f, 0.20f };
+    const float grassDark[3] = { 0.18f, 0.32f, 0.12f };
+    const float rock[3] = { 0.46f, 0.43f, 0.40f };
+    const float snow[3] = { 0.95f, 0.95f, 0.97f };
+    uint32_t detailSeed = GetOctaveSeed(generator->seed, 3, 0);
+
+    Color *pixels = (Color *)RL_MALLOC((width*height + TERRAIN_GEN_WIDTH)*sizeof(Color));
+    float *coarse = (float *)RL_MALLOC(3*paddedCoarse*sizeof(float));
+    float *rows = (float *)RL_CALLOC(2*3*paddedWidth, sizeof(float));     // The last two coarse rows, widened to every texel column
+    for (int k = 0; k < coarseHeight; k++) {
+        float v = fminf((k*step + 0.5f)/texelsPerCell, (float)(heightfield->samplesZ - 1));
+        int z0 = ((int)v < heightfield->samplesZ - 1)? (int)v : heightfield->samplesZ - 2;
+        vfloat fz = VSet(v - z0);
+        vfloat worldZ = VSet(heightfield->origin.z + (k*step + 0.5f)/texelsPerCell*heightfield->cellSizeZ);
+        const float *heights0 = &rowHeights[z0*paddedCoarse], *heights1 = &rowHeights[(z0 + 1)*paddedCoarse];
+        const float *flatness0 = &rowFlatness[z0*paddedCoarse], *flatness1 = &rowFlatness[(z0 + 1)*paddedCoarse];
+
+        for (int tx = 0; tx < paddedCoarse; tx += TERRAIN_GEN_WIDTH) {
+            vfloat h = VLerp(VLoad(&heights0[tx]), VLoad(&heights1[tx]), fz);
+            vfloat flat = VLerp(VLoad(&flatness0[tx]), VLoad(&flatness1[tx]), fz);
+            vfloat u = VMul(VAdd(VMul(VAdd(VSet((float)tx), VLanes()), VSet((float)step)), VSet(0.5f)), VSet(1.0f/texelsPerCell));
+            vfloat worldX = VAdd(VSet(heightfield->origin.x), VMul(u, VSet(heightfield->cellSizeX)));
+
+            // Detail noise, 0 to 1, breaks up the bands between the ground types
+            vfloat detail = VAdd(VMul(Noise(VMul(worldX, VSet(0.07f)), VMul(worldZ, VSet(0.07f)), VSetI(detailSeed)), VSet(0.3f)),
+                                 VMul(Noise(VMul(worldX, VSet(0.29f)), VMul(worldZ, VSet(0.29f)), VSetI(detailSeed ^ 0x5bd1e995u)), VSet(0.2f)));
+            detail = VClamp01(VAdd(detail, VSet(0.5f)));
+            vfloat jitter = VMul(VSub(detail, VSet(0.5f)), VSet(0.08f));
+
+            vfloat grassWeight = VSmoothStep(0.16f, 0.22f, VAdd(h, jitter));
+            vfloat rockWeight = VMax(VSub(VSet(1.0f), VSmoothStep(0.72f, 0.86f, flat)), VSmoothStep(0.62f, 0.72f, VAdd(h, jitter)));
+            vfloat snowWeight = VMul(VSmoothStep(0.78f, 0.84f, VAdd(h, jitter)), VSmoothStep(0.75f, 0.9f, flat));
+            vfloat shade = VAdd(VSet(0.9f), VMul(detail, VSet(0.2f)));
+
+            for (int c = 0; c < 3; c++) {
+                vfloat grass = VLerp(VSet(grassLight[c]), VSet(grassDark[c]), detail);
+                vfloat color = VLerp(VSet(sand[c]), grass, grassWeight);
+                color = VLerp(color, VSet(rock[c]), rockWeight);
+                color = VLerp(color, VSet(snow[c]), snowWeight);
+                VStore(&coarse[c*paddedCoarse + tx], VMul(VClamp01(VMul(color, shade)), VSet(255.0f)));
+            }
+        }
+        VEnd();
+
+        // Widen the coarse row to every texel column
+        float *row = &rows[(k%2)*3*paddedWidth];
+        for (int c = 0; c < 3; c++) {
+            const float *points = &coarse[c*paddedCoarse];
+            float *texels = &row[c*paddedWidth];
+            for (int x = 0; x*step < width; x++) {
+                float a = points[x], b = points[x + 1];
+                int count = (width - x*step < step)? width - x*step : step;
+                for (int s = 0; s < count; s++) texels[x*step + s] = a + weights[s]*(b - a);
+            }
+        }
+        if (k == 0) continue;
+
+        // Texel rows from the coarse row above down to this one. The last vector of a row can
+        // run past its end into the next row, which is written after it, or the slack at the end.
+        const float *above = &rows[((k - 1)%2)*3*paddedWidth];
+        for (int ty = (k - 1)*step; (ty < k*step) && (ty < height); ty++) {
+            vfloat fy = VSet(weights[ty - (k - 1)*step]);
+            Color *pixelRow = &pixels[ty*width];
+            for (int tx = 0; tx < width; tx += TERRAIN_GEN_WIDTH) {
+                VStoreColors(&pixelRow[tx], VLerp(VLoad(&above[tx]), VLoad(&row[tx]), fy),
+                             VLerp(VLoad(&above[paddedWidth + tx]), VLoad(&row[paddedWidth + tx]), fy),
+                             VLerp(VLoad(&above[2*paddedWidth + tx]), VLoad(&row[2*paddedWidth + tx]), fy));
+            }
+            VEnd();
+        }
+    }
+
+    RL_FREE(rows);
+    RL_FREE(coarse);
+    RL_FREE(flatness);
+    RL_FREE(rowHeights);
+    RL_FREE(rowFlatness);
+
+    return (Image){ pixels, width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************************
+*
+*   terraingen - Procedural terrain heights and ground colours
+*
+*   Heights are fractal gradient noise: a domain warp bends the sample position, then one set
+*   of octaves gives both rolling fBm and ridged fBm, and the ridges take over where the
+*   rolling ground gets high. Everything is a function of the seed and the world position of
+*   a sample only, so any chunk can be generated on its own, in any order, on any thread, and
+*   neighbouring chunks get identical samples along their shared edge. The world has no edge.
+*
+*   Ground colours come from the height and slope, interpolated from a generated heightfield,
+*   with some detail noise on top. They are worked out every TERRAIN_GEN_COLOR_STEP texels, at
+*   most once per sample, and interpolated in between. The height and slope are interpolated
+*   anyway and the finest detail noise is over three samples across, so little is lost.
+*
+*   The kernels run TERRAIN_GEN_WIDTH samples at a time: 8 with AVX2, 4 with SSE2, 1 on other
+*   targets. They only use exact float operations (no fused multiply-add, no approximations),
+*   so every build gives the same terrain for a seed.
+*
+********************************************************************************************/
+
+#ifndef TERRAINGEN_H
+#define TERRAINGEN_H
+
+#include "raylib.h"
+#include "heightfield.h"
+
+#define TERRAIN_GEN_FREQUENCY (1.0f/512.0f)     // Base noise frequency, cycles per world unit
+#define TERRAIN_GEN_OCTAVES 6
+#define TERRAIN_GEN_WARP_OCTAVES 3
+#define TERRAIN_GEN_WARP_STRENGTH 0.35f         // Domain warp offset, in base noise periods
+#define TERRAIN_GEN_COLOR_STEP 4                // Ground colours are worked out every this many texels and interpolated between
+
+#if defined(TERRAIN_GEN_SCALAR)                 // Define to build the scalar kernels on any target
+    #define TERRAIN_GEN_WIDTH 1
+#elif defined(__AVX2__)
+    #define TERRAIN_GEN_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define TERRAIN_GEN_WIDTH 4
+#else
+    #define TERRAIN_GEN_WIDTH 1
+#endif
+
+typedef struct TerrainGenerator {
+    unsigned int seed;
+    float heightScale;                  // Heights span 0 to heightScale
+} TerrainGenerator;
+
+TerrainGenerator GetTerrainGenerator(unsigned int seed, float heightScale);
+void GenTerrainHeights(const TerrainGenerator *generator, int sampleX, int sampleZ, int countX, int countZ, float *heights);    // Heights at integer world positions, countX per row
+Heightfield GenTerrainHeightfield(const TerrainGenerator *generator, int sampleX, int sampleZ, int samplesX, int samplesZ, int apron);    // Heightfield with one world unit between samples
+Image GenTerrainColorImage(const TerrainGenerator *generator, const Heightfield *heightfield, int texelsPerCell);              // Ground colours over the heightfield, RGBA8
+const char *GetTerrainGenBackend(void);                                                                                      // "AVX2", "SSE2" or "scalar"
+
+#endif // TERRAINGEN_H
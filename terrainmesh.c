@@ -0,0 +1,231 @@
+#include "terrainmesh.h"
+#include "raymath.h"
+#include <math.h>
+#include <stdlib.h>
+
+// Sample indices used at a given step: every step-th sample, plus the last one so the mesh
+// always reaches the far edge even when the sample count does not divide evenly
+static int *LoadStepSamples(int samples, int step, int *count, Arena *arena) {
+    int *indices = (int *)MemAllocArena(arena, (samples/step + 2)*sizeof(int));
+    *count = 0;
+    for (int i = 0; i < samples - 1; i += step) indices[(*count)++] = i;
+    indices[(*count)++] = samples - 1;
+    return indices;
+}
+
+static float GetSample(const Heightfield *heightfield, int x, int z) {
+    return heightfield->heights[z*heightfield->stride + x];
+}
+
+// Samples step away from x on either side, clamped to the heightfield and its apron
+static void GetNormalSamples(int x, int step, int samples, int apron, int *x0, int *x1) {
+    *x0 = (x - step < -apron)? -apron : x - step;
+    *x1 = (x + step > samples - 1 + apron)? samples - 1 + apron : x + step;
+}
+
+Vector3 GetHeightfieldSampleNormal(const Heightfield *heightfield, int x, int z, int step) {
+    int x0, x1, z0, z1;
+    GetNormalSamples(x, step, heightfield->samplesX, heightfield->apron, &x0, &x1);
+    GetNormalSamples(z, step, heightfield->samplesZ, heightfield->apron, &z0, &z1);
+
+    float slopeX = (GetSample(heightfield, x1, z) - GetSample(heightfield, x0, z))/((x1 - x0)*heightfield->cellSizeX);
+    float slopeZ = (GetSample(heightfield, x, z1) - GetSample(heightfield, x, z0))/((z1 - z0)*heightfield->cellSizeZ);
+    return Vector3Normalize((Vector3){ -slopeX, 1.0f, -slopeZ });
+}
+
+Mesh GenHeightfieldMesh(const Heightfield *heightfield, int step, float skirtDepth, Arena *arena) {
+    Mesh mesh = { 0 };
+    if (heightfield->heights == NULL) return mesh;
+
+    int countX, countZ;
+    int *samplesX = LoadStepSamples(heightfield->samplesX, step, &countX, arena);
+    int *samplesZ = LoadStepSamples(heightfield->samplesZ, step, &countZ, arena);
+
+    bool skirt = (skirtDepth > 0.0f);
+    int gridVertices = countX*countZ;
+    mesh.vertexCount = gridVertices + (skirt? 2*(countX + countZ) : 0);
+    mesh.triangleCount = 2*(countX - 1)*(countZ - 1) + (skirt? 4*((countX - 1) + (countZ - 1)) : 0);
+
+    mesh.vertices = (float *)MemAllocArena(arena, mesh.vertexCount*3*sizeof(float));
+    mesh.normals = (float *)MemAllocArena(arena, mesh.vertexCount*3*sizeof(float));
+    mesh.texcoords = (float *)MemAllocArena(arena, mesh.vertexCount*2*sizeof(float));
+    mesh.indices = (unsigned short *)MemAllocArena(arena, mesh.triangleCount*3*sizeof(unsigned short));
+
+    // The samples either side of each column used for its normal, and the distance between
+    // them, are the same on every row
+    int *normalX0 = (int *)MemAllocArena(arena, countX*sizeof(int));
+    int *normalX1 = (int *)MemAllocArena(arena, countX*sizeof(int));
+    float *normalScaleX = (float *)MemAllocArena(arena, countX*sizeof(float));
+    for (int ix = 0; ix < countX; ix++) {
+        GetNormalSamples(samplesX[ix], step, heightfield->samplesX, heightfield->apron, &normalX0[ix], &normalX1[ix]);
+        normalScaleX[ix] = 1.0f/((normalX1[ix] - normalX0[ix])*heightfield->cellSizeX);
+    }
+
+    // Grid vertices, a row at a time with no branches in the inner loops
+    //--------------------------------------------------------------
+    for (int iz = 0; iz < countZ; iz++) {
+        int z = samplesZ[iz];
+        int z0, z1;
+        GetNormalSamples(z, step, heightfield->samplesZ, heightfield->apron, &z0, &z1);
+        const float *row = heightfield->heights + z*heightfield->stride;
+        const float *row0 = heightfield->heights + z0*heightfield->stride;
+        const float *row1 = heightfield->heights + z1*heightfield->stride;
+        float normalScaleZ = 1.0f/((z1 - z0)*heightfield->cellSizeZ);
+        float positionZ = z*heightfield->cellSizeZ;
+        float texcoordZ = (float)z/(heightfield->samplesZ - 1);
+
+        float *vertices = &mesh.vertices[iz*countX*3];
+        float *normals = &mesh.normals[iz*countX*3];
+        float *texcoords = &mesh.texcoords[iz*countX*2];
+        for (int ix = 0; ix < countX; ix++) {
+            int x = samplesX[ix];
+            vertices[ix*3] = x*heightfield->cellSizeX;
+            vertices[ix*3 + 1] = row[x];
+            vertices[ix*3 + 2] = positionZ;
+            texcoords[ix*2] = (float)x/(heightfield->samplesX - 1);
+            texcoords[ix*2 + 1] = texcoordZ;
+        }
+        for (int ix = 0; ix < countX; ix++) {
+            int x = samplesX[ix];
+            float slopeX = (row[normalX1[ix]] - row[normalX0[ix]])*normalScaleX[ix];
+            float slopeZ = (row1[x] - row0[x])*normalScaleZ;
+            float length = 1.0f/sqrtf(slopeX*slopeX + 1.0f + slopeZ*slopeZ);
+            normals[ix*3] = -slopeX*length;
+            normals[ix*3 + 1] = length;
+            normals[ix*3 + 2] = -slopeZ*length;
+        }
+    }
+
+    // Grid triangles, (x,z) (x,z+1) (x+1,z) and (x+1,z) (x,z+1) (x+1,z+1)
+    //--------------------------------------------------------------
+    int i = 0;
+    for (int iz = 0; iz < countZ - 1; iz++) {
+        for (int ix = 0; ix < countX - 1; ix++) {
+            unsigned short v00 = (unsigned short)(iz*countX + ix);
+            unsigned short v10 = v00 + 1;
+            unsigned short v01 = v00 + countX;
+            unsigned short v11 = v01 + 1;
+
+            mesh.indices[i++] = v00; mesh.indices[i++] = v01; mesh.indices[i++] = v10;
+            mesh.indices[i++] = v10; mesh.indices[i++] = v01; mesh.indices[i++] = v11;
+        }
+    }
+
+    // Skirts, a copy of each border row lowered by skirtDepth. The winding of each edge is
+    // picked so the skirt faces out of the chunk.
+    //--------------------------------------------------------------
+    if (skirt) {
+        int edgeStart[4] = { 0, countX*(countZ - 1), 0, countX - 1 };      // First grid vertex of the z=0, z=max, x=0 and x=max edges
+        int edgeStride[4] = { 1, 1, countX, countX };                       // Grid vertices between two edge vertices
+        int edgeCount[4] = { countX, countX, countZ, countZ };
+        bool edgeFlip[4] = { false, true, true, false };                    // Winding needed to face outwards
+
+        int skirtVertex = gridVertices;
+        for (int edge = 0; edge < 4; edge++) {
+            int firstSkirtVertex = skirtVertex;
+            for (int e = 0; e < edgeCount[edge]; e++) {
+                int top = edgeStart[edge] + e*edgeStride[edge];
+                for (int c = 0; c < 3; c++) {
+                    mesh.vertices[skirtVertex*3 + c] = mesh.vertices[top*3 + c];
+                    mesh.normals[skirtVertex*3 + c] = mesh.normals[top*3 + c];
+                }
+                mesh.vertices[skirtVertex*3 + 1] -= skirtDepth;
+                mesh.texcoords[skirtVertex*2] = mesh.texcoords[top*2];
+                mesh.texcoords[skirtVertex*2 + 1] = mesh.texcoords[top*2 + 1];
+                skirtVertex++;
+            }
+
+            for (int e = 0; e < edgeCount[edge] - 1; e++) {
+                unsigned short t0 = (unsigned short)(edgeStart[edge] + e*edgeStride[edge]);
+                unsigned short t1 = (unsigned short)(t0 + edgeStride[edge]);
+                unsigned short b0 = (unsigned short)(firstSkirtVertex + e);
+                unsigned short b1 = b0 + 1;
+
+                if (edgeFlip[edge]) {
+                    mesh.indices[i++] = t0; mesh.indices[i++] = b0; mesh.indices[i++] = t1;
+                    mesh.indices[i++] = t1; mesh.indices[i++] = b0; mesh.indices[i++] = b1;
+                } else {
+                    mesh.indices[i++] = t0; mesh.indices[i++] = t1; mesh.indices[i++] = b0;
+                    mesh.indices[i++] = t1; mesh.indices[i++] = b1; mesh.indices[i++] = b0;
+                }
+            }
+        }
+    }
+
+    MemFreeArena(arena, normalX0);
+    MemFreeArena(arena, normalX1);
+    MemFreeArena(arena, normalScaleX);
+    MemFreeArena(arena, samplesX);
+    MemFreeArena(arena, samplesZ);
+
+    return mesh;
+}
+
+Mesh GenTerrainGridMesh(int samples, int step) {
+    // A flat heightfield with unit cells gives vertices at the sample indices, and a skirt one
+    // unit deep marks the skirt vertices
+    Heightfield flat = { 0 };
+    flat.samplesX = samples;
+    flat.samplesZ = samples;
+    flat.stride = samples;
+    flat.heights = (float *)RL_CALLOC(samples*samples, sizeof(float));
+    flat.cellSizeX = 1.0f;
+    flat.cellSizeZ = 1.0f;
+
+    Mesh mesh = GenHeightfieldMesh(&flat, step, 1.0f, NULL);
+    RL_FREE(flat.heights);
+
+    // The shader derives normals and texcoords from the heights
+    RL_FREE(mesh.normals);
+    RL_FREE(mesh.texcoords);
+    mesh.normals = NULL;
+    mesh.texcoords = NULL;
+
+    return mesh;
+}
+
+float GetHeightfieldMeshError(const Heightfield *heightfield, int step) {
+    if ((heightfield->heights == NULL) || (step <= 1)) return 0.0f;
+
+    int countX, countZ;
+    int *samplesX = LoadStepSamples(heightfield->samplesX, step, &countX, NULL);
+    int *samplesZ = LoadStepSamples(heightfield->samplesZ, step, &countZ, NULL);
+
+    // Compare every sample against the triangle of the coarse cell it falls in
+    float maxError = 0.0f;
+    for (int iz = 0; iz < countZ - 1; iz++) {
+        for (int ix = 0; ix < countX - 1; ix++) {
+            int x0 = samplesX[ix], x1 = samplesX[ix + 1];
+            int z0 = samplesZ[iz], z1 = samplesZ[iz + 1];
+            float h00 = GetSample(heightfield, x0, z0), h10 = GetSample(heightfield, x1, z0);
+            float h01 = GetSample(heightfield, x0, z1), h11 = GetSample(heightfield, x1, z1);
+
+            for (int z = z0; z <= z1; z++) {
+                for (int x = x0; x <= x1; x++) {
+                    float tx = (float)(x - x0)/(x1 - x0);
+                    float tz = (float)(z - z0)/(z1 - z0);
+                    float h = (tx + tz <= 1.0f)? h00 + tx*(h10 - h00) + tz*(h01 - h00)
+                                               : h11 + (1.0f - tx)*(h01 - h11) + (1.0f - tz)*(h10 - h11);
+                    float error = fabsf(GetSample(heightfield, x, z) - h);
+                    if (error > maxError) maxError = error;
+                }
+            }
+        }
+    }
+
+    RL_FREE(samplesX);
+    RL_FREE(samplesZ);
+
+    return maxError;
+}
+
+void UnloadMeshData(Mesh *mesh) {
+    RL_FREE(mesh->vertices);
+    RL_FREE(mesh->normals);
+    RL_FREE(mesh->texcoords);
+    RL_FREE(mesh->indices);
+    mesh->vertices = NULL;
+    mesh->normals = NULL;
+    mesh->texcoords = NULL;
+    mesh->indices = NULL;
+}
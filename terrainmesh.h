@@ -0,0 +1,43 @@
+/*******************************************************************************************
+*
+*   terrainmesh - Ground meshes built from a heightfield
+*
+*   GenHeightfieldMesh() builds an indexed grid mesh that uses every step-th height sample,
+*   so one heightfield gives a full resolution mesh and any number of coarser levels of
+*   detail. Every grid cell is split along the same diagonal the heightfield queries use.
+*
+*   Neighbouring chunks drawn at different levels do not share their edge vertices, which
+*   leaves cracks along the seam. Each mesh gets a skirt to hide them: a strip hanging
+*   straight down from every border edge, deep enough to cover the height difference between
+*   any two levels.
+*
+*   Normals are central differences between the samples step away on either side. Along the
+*   border they reach into the heightfield's apron when it has one, so neighbouring chunks
+*   built with the same step get the same normals on their shared edge and the seam does not
+*   show in the lighting.
+*
+*   Mesh vertices are relative to the heightfield origin. Nothing is uploaded, so meshes can
+*   be built on worker threads. Given an arena, every array of the mesh and every temporary
+*   comes out of it: the mesh is then only valid until the arena is reset, and must not be
+*   passed to UnloadMeshData().
+*
+*   GenTerrainGridMesh() builds the same grid with no heights at all, for terrain whose
+*   heights are fetched in the vertex shader (see terrainrender.h). One such grid per level
+*   of detail is shared by every chunk.
+*
+********************************************************************************************/
+
+#ifndef TERRAINMESH_H
+#define TERRAINMESH_H
+
+#include "raylib.h"
+#include "heightfield.h"
+#include "arena.h"
+
+Mesh GenHeightfieldMesh(const Heightfield *heightfield, int step, float skirtDepth, Arena *arena);   // Grid mesh over every step-th sample, skirtDepth 0 for no skirt, arena NULL to allocate each array
+Mesh GenTerrainGridMesh(int samples, int step);                                       // Vertices at (sample x, 0, sample z), skirt vertices at y = -1
+float GetHeightfieldMeshError(const Heightfield *heightfield, int step);                // Largest vertical distance between the samples and the step mesh
+Vector3 GetHeightfieldSampleNormal(const Heightfield *heightfield, int x, int z, int step);  // Smooth normal from the samples step away, clamped to the heightfield and its apron
+void UnloadMeshData(Mesh *mesh);                                                        // Free the CPU arrays of a mesh that was never uploaded
+
+#endif // TERRAINMESH_H
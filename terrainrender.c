@@ -0,0 +1,244 @@
+#include "terrainrender.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include "external/glad.h"     // rlgl has no texture arrays, the colour layers are made with OpenGL directly
+#include "profiler.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int FloorMod(int a, int n) {
+    int r = a % n;
+    return (r < 0)? r + n : r;
+}
+
+static int ClampInt(int value, int min, int max) {
+    return (value < min)? min : (value > max)? max : value;
+}
+
+void LoadTerrainRenderer(TerrainRenderer *renderer, int atlasTiles) {
+    *renderer = (TerrainRenderer){ 0 };
+    renderer->atlasTiles = atlasTiles;
+
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        renderer->grids[lod] = GenTerrainGridMesh(TERRAIN_TILE_SAMPLES, 1 << lod);
+        UploadMesh(&renderer->grids[lod], false);
+    }
+
+    renderer->shader = LoadShader("shaders/terrain.vs", "shaders/terrain.fs");
+#if (RAYLIB_VERSION_MAJOR > 5) || ((RAYLIB_VERSION_MAJOR == 5) && (RAYLIB_VERSION_MINOR >= 5))
+    renderer->shader.locs[SHADER_LOC_VERTEX_INSTANCE_TX] = GetShaderLocationAttrib(renderer->shader, "instanceTransform");
+#else
+    renderer->shader.locs[SHADER_LOC_MATRIX_MODEL] = GetShaderLocationAttrib(renderer->shader, "instanceTransform");
+#endif
+    renderer->shader.locs[SHADER_LOC_MAP_HEIGHT] = GetShaderLocation(renderer->shader, "heightAtlas");
+    renderer->lodStepLoc = GetShaderLocation(renderer->shader, "lodStep");
+
+    renderer->sunDirectionLoc = GetShaderLocation(renderer->shader, "sunDirection");
+
+    int colorSlot = TERRAIN_COLOR_SLOT;
+    int samples = TERRAIN_TILE_SAMPLES;
+    int apron = CHUNK_APRON;
+    float chunkSize = CHUNK_SIZE;
+    float skirtDepth = CHUNK_SKIRT_DEPTH;
+    SetShaderValue(renderer->shader, GetShaderLocation(renderer->shader, "samples"), &samples, SHADER_UNIFORM_INT);
+    SetShaderValue(renderer->shader, GetShaderLocation(renderer->shader, "apron"), &apron, SHADER_UNIFORM_INT);
+    SetShaderValue(renderer->shader, GetShaderLocation(renderer->shader, "atlasTiles"), &atlasTiles, SHADER_UNIFORM_INT);
+    SetShaderValue(renderer->shader, GetShaderLocation(renderer->shader, "chunkSize"), &chunkSize, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(renderer->shader, GetShaderLocation(renderer->shader, "skirtDepth"), &skirtDepth, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(renderer->shader, GetShaderLocation(renderer->shader, "colorLayers"), &colorSlot, SHADER_UNIFORM_INT);
+
+    // Heights start at 0, tiles are only read once their chunk has been uploaded
+    Image heights = { 0 };
+    heights.width = atlasTiles*TERRAIN_TILE_STRIDE;
+    heights.height = atlasTiles*TERRAIN_TILE_STRIDE;
+    heights.mipmaps = 1;
+    heights.format = PIXELFORMAT_UNCOMPRESSED_R32;
+    heights.data = RL_CALLOC(heights.width*heights.height, sizeof(float));
+    renderer->heightAtlas = LoadTextureFromImage(heights);
+    UnloadImage(heights);
+
+    renderer->material = LoadMaterialDefault();
+    renderer->material.shader = renderer->shader;
+    renderer->material.maps[MATERIAL_MAP_HEIGHT].texture = renderer->heightAtlas;
+
+    renderer->tileChunks = (IVector2 *)calloc(atlasTiles*atlasTiles, sizeof(IVector2));
+    renderer->tileLoaded = (bool *)calloc(atlasTiles*atlasTiles, sizeof(bool));
+    renderer->tileHeights = (float *)malloc(TERRAIN_TILE_STRIDE*TERRAIN_TILE_STRIDE*sizeof(float));
+    SetTerrainSunDirection(renderer, (Vector3){ 0.0f, 1.0f, 0.0f });
+
+    renderer->instanceCapacity = atlasTiles*atlasTiles;
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        renderer->instances[lod] = (Matrix *)malloc(renderer->instanceCapacity*sizeof(Matrix));
+    }
+}
+
+void UnloadTerrainRenderer(TerrainRenderer *renderer) {
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        UnloadMesh(renderer->grids[lod]);
+        free(renderer->instances[lod]);
+    }
+    free(renderer->tileChunks);
+    free(renderer->tileLoaded);
+    free(renderer->tileHeights);
+    UnloadTexture(renderer->heightAtlas);
+    if (renderer->colorLayers.id > 0) glDeleteTextures(1, &renderer->colorLayers.id);
+
+    // UnloadMaterial() would unload the height atlas again and the default texture with it
+    RL_FREE(renderer->material.maps);
+    UnloadShader(renderer->shader);
+    *renderer = (TerrainRenderer){ 0 };
+}
+
+static int GetFullMipmapCount(int width, int height) {
+    int mipmaps = 1;
+    while (((width > height)? width : height) >> mipmaps) mipmaps++;
+    return mipmaps;
+}
+
+// One layer per tile, each with a whole mip chain of its own. Filtering never leaves a layer,
+// so unlike a single atlas no tile bleeds into the unrelated chunk stored next to it.
+static void LoadColorLayers(TerrainRenderer *renderer, int format) {
+    Texture2D *layers = &renderer->colorLayers;
+    layers->width = TERRAIN_TILE_TEXELS;
+    layers->height = TERRAIN_TILE_TEXELS;
+    layers->mipmaps = GetFullMipmapCount(TERRAIN_TILE_TEXELS, TERRAIN_TILE_TEXELS);
+    layers->format = format;
+
+    unsigned int glInternalFormat, glFormat, glType;
+    rlGetGlTextureFormats(format, &glInternalFormat, &glFormat, &glType);
+    glGenTextures(1, &layers->id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, layers->id);
+    for (int level = 0; level < layers->mipmaps; level++) {
+        int size = (TERRAIN_TILE_TEXELS >> level > 0)? TERRAIN_TILE_TEXELS >> level : 1;
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, glInternalFormat, size, size, renderer->atlasTiles*renderer->atlasTiles, 0, glFormat, glType, NULL);
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, layers->mipmaps - 1);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+static int GetTileIndex(const TerrainRenderer *renderer, IVector2 chunkID) {
+    return FloorMod(chunkID.y, renderer->atlasTiles)*renderer->atlasTiles + FloorMod(chunkID.x, renderer->atlasTiles);
+}
+
+bool IsTerrainTileLoaded(const TerrainRenderer *renderer, IVector2 chunkID) {
+    int index = GetTileIndex(renderer, chunkID);
+    return renderer->tileLoaded[index] && (renderer->tileChunks[index].x == chunkID.x) && (renderer->tileChunks[index].y == chunkID.y);
+}
+
+void UploadTerrainTile(TerrainRenderer *renderer, const Chunk *chunk) {
+    const Heightfield *heightfield = &chunk->heightfield;
+    if (heightfield->heights == NULL) return;
+
+    IVector2 tile = { FloorMod(chunk->chunkID.x, renderer->atlasTiles), FloorMod(chunk->chunkID.y, renderer->atlasTiles) };
+    int index = GetTileIndex(renderer, chunk->chunkID);
+    renderer->tileChunks[index] = chunk->chunkID;
+    renderer->tileLoaded[index] = true;
+    PROFILE_COUNT(PROFILE_UPLOAD_BYTES, TERRAIN_TILE_STRIDE*TERRAIN_TILE_STRIDE*sizeof(float));
+
+    // Tiles carry a ring of CHUNK_APRON neighbour samples, so normals along the border come out
+    // as GenHeightfieldMesh() gives them. Chunks with a full tile of samples are copied with
+    // their apron, the edge samples repeat where a heightfield has a narrower one. Chunks on the
+    // far edge of the map have one sample less, resample their ground onto the tile grid.
+    const int samples = TERRAIN_TILE_SAMPLES;
+    const int apron = CHUNK_APRON;
+    const int stride = TERRAIN_TILE_STRIDE;
+    bool fullTile = (heightfield->samplesX == samples) && (heightfield->samplesZ == samples);
+    float cellSize = CHUNK_SIZE/(samples - 1);
+    for (int z = -apron; z < samples + apron; z++) {
+        for (int x = -apron; x < samples + apron; x++) {
+            float *height = &renderer->tileHeights[(z + apron)*stride + x + apron];
+            if (fullTile) {
+                int sampleX = ClampInt(x, -heightfield->apron, samples - 1 + heightfield->apron);
+                int sampleZ = ClampInt(z, -heightfield->apron, samples - 1 + heightfield->apron);
+                *height = heightfield->heights[sampleZ*heightfield->stride + sampleX];
+            } else {
+                float px = fminf(heightfield->origin.x + ClampInt(x, 0, samples - 1)*cellSize, heightfield->origin.x + (heightfield->samplesX - 1)*heightfield->cellSizeX);
+                float pz = fminf(heightfield->origin.z + ClampInt(z, 0, samples - 1)*cellSize, heightfield->origin.z + (heightfield->samplesZ - 1)*heightfield->cellSizeZ);
+                *height = 0.0f;
+                GetHeightfieldHeight(heightfield, px, pz, height, NULL);
+            }
+        }
+    }
+    Rectangle heightRec = { (float)tile.x*stride, (float)tile.y*stride, (float)stride, (float)stride };
+    UpdateTextureRec(renderer->heightAtlas, heightRec, renderer->tileHeights);
+
+    if (chunk->texture.data == NULL) return;
+
+    if (renderer->colorLayers.id == 0) LoadColorLayers(renderer, chunk->texture.format);
+
+    // Chunk textures come with their mip chain from the worker, the layer takes all of it
+    Texture2D *layers = &renderer->colorLayers;
+    Image color = chunk->texture;
+    bool converted = (color.format != layers->format) || (color.width != layers->width) || (color.height != layers->height) || (color.mipmaps < layers->mipmaps);
+    if (converted) {
+        color.mipmaps = 1;
+        color = ImageCopy(color);
+        ImageFormat(&color, layers->format);
+        ImageResize(&color, layers->width, layers->height);
+        ImageMipmaps(&color);
+    }
+
+    unsigned int glInternalFormat, glFormat, glType;
+    rlGetGlTextureFormats(layers->format, &glInternalFormat, &glFormat, &glType);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, layers->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    const unsigned char *levelData = (const unsigned char *)color.data;
+    for (int level = 0; level < layers->mipmaps; level++) {
+        int size = (layers->width >> level > 0)? layers->width >> level : 1;
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, index, size, size, 1, glFormat, glType, levelData);
+        levelData += GetPixelDataSize(size, size, layers->format);
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    PROFILE_COUNT(PROFILE_UPLOAD_BYTES, (long long)(levelData - (const unsigned char *)color.data));
+    if (converted) UnloadImage(color);
+}
+
+void SetTerrainSunDirection(TerrainRenderer *renderer, Vector3 direction) {
+    direction = Vector3Normalize(direction);
+    SetShaderValue(renderer->shader, renderer->sunDirectionLoc, &direction, SHADER_UNIFORM_VEC3);
+}
+
+void QueueTerrainChunk(TerrainRenderer *renderer, const Chunk *chunk, int lodLevel) {
+    if ((chunk->heightfield.heights == NULL) || !IsTerrainTileLoaded(renderer, chunk->chunkID)) return;
+    if (lodLevel >= CHUNK_LOD_COUNT) lodLevel = CHUNK_LOD_COUNT - 1;
+    if (renderer->instanceCount[lodLevel] == renderer->instanceCapacity) return;    // Never more chunks than tiles
+
+    Vector3 origin = chunk->heightfield.origin;
+    renderer->instances[lodLevel][renderer->instanceCount[lodLevel]++] = MatrixTranslate(origin.x, origin.y, origin.z);
+}
+
+int FlushTerrainRenderer(TerrainRenderer *renderer) {
+    // DrawMeshInstanced() only binds material maps as 2D textures, so the colour layers go on a
+    // texture unit past all of them
+    glActiveTexture(GL_TEXTURE0 + TERRAIN_COLOR_SLOT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, renderer->colorLayers.id);
+    glActiveTexture(GL_TEXTURE0);
+
+    int drawCalls = 0;
+    for (int lod = 0; lod < CHUNK_LOD_COUNT; lod++) {
+        if (renderer->instanceCount[lod] == 0) continue;
+
+        int step = 1 << lod;
+        SetShaderValue(renderer->shader, renderer->lodStepLoc, &step, SHADER_UNIFORM_INT);
+        DrawMeshInstanced(renderer->grids[lod], renderer->material, renderer->instances[lod], renderer->instanceCount[lod]);
+        renderer->instanceCount[lod] = 0;
+        drawCalls++;
+    }
+
+    glActiveTexture(GL_TEXTURE0 + TERRAIN_COLOR_SLOT);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glActiveTexture(GL_TEXTURE0);
+    return drawCalls;
+}
+
+size_t GetTerrainTileBytes(const TerrainRenderer *renderer) {
+    int colorFormat = (renderer->colorLayers.id > 0)? renderer->colorLayers.format : PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    size_t heightBytes = TERRAIN_TILE_STRIDE*TERRAIN_TILE_STRIDE*sizeof(float);
+    size_t colorBytes = GetPixelDataSize(TERRAIN_TILE_TEXELS, TERRAIN_TILE_TEXELS, colorFormat)*4/3;     // Plus a third for the layer's mipmaps
+    return heightBytes + colorBytes;
+}
@@ -0,0 +1,68 @@
+/*******************************************************************************************
+*
+*   terrainrender - Instanced terrain drawing from height and colour atlases
+*
+*   Instead of a vertex buffer per chunk, every chunk is drawn with one of CHUNK_LOD_COUNT
+*   shared grid meshes (GenTerrainGridMesh). shaders/terrain.vs fetches its heights and works
+*   out its normals, shaders/terrain.fs lights the ground with them. Each resident chunk only
+*   owns a tile of the height atlas and a layer of the colour texture array, with the whole
+*   mip chain its worker built, so all chunks drawn at the same level of detail share one
+*   material and go out in a single DrawMeshInstanced() call.
+*
+*   The atlas has atlasTiles x atlasTiles tiles and a chunk uses tile (chunk ID mod atlasTiles),
+*   so the shader finds a chunk's tile and layer from its origin alone. Heights are only ever
+*   fetched, never filtered, so tiles can sit edge to edge. Each one keeps a CHUNK_APRON ring
+*   of samples from the chunk's neighbours, so normals along its border match the ones
+*   GenHeightfieldMesh() gives and chunks meet without a shading seam. Colours are filtered,
+*   which is why they live in layers of their own: neither bilinear taps nor coarser mip
+*   levels can reach another chunk's colours. Chunks atlasTiles apart share a tile: the
+*   renderer keeps track of which chunk each tile holds and only draws that one. The chunk
+*   stream keeps its ring of chunks no wider than the atlas, so every chunk in it has a tile
+*   to itself.
+*
+*   rlgl has no texture arrays, so the colour layers are made and bound with OpenGL directly.
+*
+*   All of it needs the OpenGL context, so main thread only.
+*
+********************************************************************************************/
+
+#ifndef TERRAINRENDER_H
+#define TERRAINRENDER_H
+
+#include "raylib.h"
+#include "chunk.h"
+
+#define TERRAIN_TILE_SAMPLES (int)(CHUNK_SIZE + 1)                 // Heights along a tile edge
+#define TERRAIN_TILE_STRIDE (TERRAIN_TILE_SAMPLES + 2*CHUNK_APRON)  // Heights along a tile edge in the atlas, apron included
+#define TERRAIN_TILE_TEXELS (int)(CHUNK_SIZE*CHUNK_TEX_SCALE)       // Colour texels along a layer edge
+#define TERRAIN_COLOR_SLOT 12                                       // Texture unit of the colour layers, past every material map
+
+typedef struct TerrainRenderer {
+    int atlasTiles;
+    Mesh grids[CHUNK_LOD_COUNT];        // Shared grid for each level of detail
+    Shader shader;
+    Material material;                  // Height map is the height atlas
+    Texture2D heightAtlas;              // R32 heights, TERRAIN_TILE_STRIDE per tile
+    Texture2D colorLayers;              // GL_TEXTURE_2D_ARRAY, one layer per tile, created with the pixel format of the first chunk texture
+    IVector2 *tileChunks;               // Chunk whose data each tile holds
+    bool *tileLoaded;                   // Tiles that hold any chunk yet
+    float *tileHeights;                 // Scratch for the heights of one tile, apron included
+    int lodStepLoc;
+    int sunDirectionLoc;
+
+    // Chunks queued for the next FlushTerrainRenderer(), per level of detail
+    Matrix *instances[CHUNK_LOD_COUNT];
+    int instanceCount[CHUNK_LOD_COUNT];
+    int instanceCapacity;
+} TerrainRenderer;
+
+void LoadTerrainRenderer(TerrainRenderer *renderer, int atlasTiles);
+void UnloadTerrainRenderer(TerrainRenderer *renderer);
+void UploadTerrainTile(TerrainRenderer *renderer, const Chunk *chunk);     // Copy a chunk's heights and colour mip chain into its tile, taking it from any other chunk
+bool IsTerrainTileLoaded(const TerrainRenderer *renderer, IVector2 chunkID);   // The chunk's tiles hold its data
+void SetTerrainSunDirection(TerrainRenderer *renderer, Vector3 direction);     // Towards the sun, the ground is lit from there
+void QueueTerrainChunk(TerrainRenderer *renderer, const Chunk *chunk, int lodLevel);
+int FlushTerrainRenderer(TerrainRenderer *renderer);       // Draw every queued chunk, returns the number of draw calls
+size_t GetTerrainTileBytes(const TerrainRenderer *renderer);     // GPU memory each chunk uses in the atlas and the colour layers
+
+#endif // TERRAINRENDER_H
@@ -0,0 +1,52 @@
+#include "tilecache.h"
+#include "timer.h"
+
+static void InitTileSource(TileSource *source, const char *fileName) {
+    *source = (TileSource){ 0 };
+    source->fileName = fileName;
+    pthread_mutex_init(&source->lock, NULL);
+}
+
+void InitTileCache(TileCache *cache, const char *heightMapFileName, const char *textureFileName) {
+    InitTileSource(&cache->heightMap, heightMapFileName);
+    InitTileSource(&cache->texture, textureFileName);
+}
+
+static void UnloadTileSource(TileSource *source) {
+    if (source->loaded) UnloadImage(source->image);
+    source->image = (Image){ 0 };
+    source->loaded = false;
+    pthread_mutex_destroy(&source->lock);
+}
+
+void UnloadTileCache(TileCache *cache) {
+    UnloadTileSource(&cache->heightMap);
+    UnloadTileSource(&cache->texture);
+}
+
+static void DecodeTileSource(TileSource *source) {
+    double start = GetMonotonicTime();
+    source->image = LoadImage(source->fileName);
+    source->decodeTime = GetMonotonicTime() - start;
+    source->loaded = true;  // Also set on failure so a missing file is only reported once
+
+    if (source->image.data != NULL) {
+        TraceLog(LOG_INFO, "TILECACHE: Decoded %s (%ix%i) in %.3f s", source->fileName, source->image.width, source->image.height, source->decodeTime);
+    }
+}
+
+Image LoadTileRegion(TileSource *source, Rectangle rec) {
+    pthread_mutex_lock(&source->lock);
+    if (!source->loaded) DecodeTileSource(source);
+    pthread_mutex_unlock(&source->lock);
+    if (source->image.data == NULL) return (Image){ 0 };    // Decoded pixels are never modified, no lock needed from here
+
+    // ImageFromImage() does not clip, so keep the region inside the source
+    if (rec.x < 0) { rec.width += rec.x; rec.x = 0; }
+    if (rec.y < 0) { rec.height += rec.y; rec.y = 0; }
+    if (rec.x + rec.width  > source->image.width)  rec.width  = source->image.width  - rec.x;
+    if (rec.y + rec.height > source->image.height) rec.height = source->image.height - rec.y;
+    if ((rec.width <= 0) || (rec.height <= 0)) return (Image){ 0 };
+
+    return ImageFromImage(source->image, rec);
+}
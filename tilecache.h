@@ -0,0 +1,39 @@
+/*******************************************************************************************
+*
+*   tilecache - Shared source images for chunk loading
+*
+*   The heightmap and terrain texture are large PNGs that every chunk takes a small crop of.
+*   Instead of decoding the whole file once per chunk, each file is decoded the first time a
+*   region of it is requested and the decoded pixels are kept for the rest of the cache's life.
+*   Chunk regions are then copied straight out of the decoded image, so the cost of loading a
+*   chunk scales with the size of its crop rather than with the size of the source file.
+*
+*   LoadTileRegion() may be called from several worker threads at once; the first caller
+*   decodes the source while the others wait for it.
+*
+********************************************************************************************/
+
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include "raylib.h"
+#include <pthread.h>
+
+typedef struct TileSource {
+    const char *fileName;       // Path of the source image, decoded on first use
+    Image image;                // Decoded pixels, only valid once loaded is true
+    bool loaded;                // Has the source been decoded (or failed to decode)
+    double decodeTime;          // Seconds spent decoding the source
+    pthread_mutex_t lock;       // Guards the decode
+} TileSource;
+
+typedef struct TileCache {
+    TileSource heightMap;       // Greyscale heightmap, one pixel per heightmap sample
+    TileSource texture;         // Terrain colour texture, CHUNK_TEX_SCALE pixels per sample
+} TileCache;
+
+void InitTileCache(TileCache *cache, const char *heightMapFileName, const char *textureFileName);  // Set up a cache, nothing is decoded yet
+void UnloadTileCache(TileCache *cache);                                                           // Free every decoded source image
+Image LoadTileRegion(TileSource *source, Rectangle rec);                                          // Copy a region of a source image, decoding it if needed
+
+#endif // TILECACHE_H
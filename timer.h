@@ -0,0 +1,17 @@
+/*******************************************************************************************
+*
+*   timer - Monotonic wall clock that works without a window
+*
+*   raylib's GetTime() reads the GLFW clock, which stays at 0 until InitWindow() has run, so
+*   the tools that never open a window (microbench, bake) time themselves with this instead.
+*   Kept apart from everything else because the Windows implementation needs windows.h, which
+*   clashes with raylib.h.
+*
+********************************************************************************************/
+
+#ifndef TIMER_H
+#define TIMER_H
+
+double GetMonotonicTime(void);      // Seconds since an arbitrary start, only differences are meaningful
+
+#endif // TIMER_H